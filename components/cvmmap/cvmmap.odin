@@ -1,11 +1,15 @@
 package cvmmap
+import "../reactor"
 import zmq "../../lib/odin-zeromq"
+import "base:intrinsics"
 import "base:runtime"
 import "core:c"
 import "core:fmt"
 import "core:log"
+import "core:mem"
 import "core:os"
 import "core:strings"
+import "core:sys/linux"
 import "core:sys/posix"
 import "core:thread"
 
@@ -20,6 +24,14 @@ SHM_PAYLOAD_OFFSET :: 256
 // CV-MMAP\0
 CV_MMAP_MAGIC_LEN :: 8
 CV_MMAP_MAGIC_STR :: "CV-MMAP"
+// the last byte of the magic is the layout version; 0 (the terminator) for
+// the single image layout, so older clients still see "CV-MMAP"
+CV_MMAP_VERSION_OFFSET :: CV_MMAP_MAGIC_LEN - 1
+CV_MMAP_VERSION_SINGLE :: 0
+CV_MMAP_VERSION_RING :: 2
+RING_SLOT_HEADER_SIZE :: 64
+// mappings at least this large ask for transparent hugepages
+HUGEPAGE_MIN_SIZE :: 2 * 1024 * 1024
 
 // same as OpenCV's definitions
 Depth :: enum u8 {
@@ -41,6 +53,8 @@ PixelFormat :: enum u8 {
 	GRAY,
 	YUV,
 	YUYV,
+	NV12,
+	I420,
 }
 
 FrameInfo :: struct #packed {
@@ -58,21 +72,97 @@ FrameMetadata :: struct {
 	info:        FrameInfo,
 }
 
+// ring layout: the header after the magic
+//
+// frame `seq` (from 1) is written into slot `seq % n_slots`, at
+// `SHM_PAYLOAD_OFFSET + slot * slot_stride`, and `write_seq` is set to `seq`
+// once it is complete. The slots of `write_seq + 2 - n_slots` to `write_seq`
+// can be read while the producer writes the next one.
+RingHeader :: struct {
+	n_slots:     u32,
+	// bytes from a slot to the next, header included
+	slot_stride: u32,
+	write_seq:   u64,
+}
+
+// at the start of every slot, followed by the image at `RING_SLOT_HEADER_SIZE`
+RingSlotHeader :: struct {
+	// `2 * seq` once frame `seq` is complete; odd while a frame is written
+	seq:      u64,
+	metadata: FrameMetadata,
+}
+
 SyncMessage :: struct #packed {
-	magic:       u8,
-	frame_index: u32,
-	label:       [NAME_MAX_LEN]u8,
+	magic:        u8,
+	frame_index:  u32,
+	label:        [NAME_MAX_LEN]u8,
+	// `now_ns` of the producer when the frame was complete; 0 if the producer
+	// predates it (a message of `SYNC_MESSAGE_V1_SIZE`)
+	timestamp_ns: u64,
+}
+SYNC_MESSAGE_V1_SIZE :: offset_of(SyncMessage, timestamp_ns)
+
+// when the frame being delivered was announced, on the clock of `now_ns`;
+// valid in `on_frame`. With the ring layout, the frames before the newest
+// one delivered for the same announcement were published earlier.
+FrameTiming :: struct {
+	// 0 if the producer sends no timestamp
+	published_ns: u64,
+	received_ns:  u64,
 }
 
+// `buffer` is the frame in the shared memory and is only valid during the
+// call: the producer rewrites it (the slot `n_slots` frames later with the
+// ring layout, on the next frame otherwise), and a remap moves it. Whatever
+// is kept of it must be copied.
 OnFrame_Proc :: proc(metadata: FrameMetadata, buffer: []u8, user_data: rawptr)
+// called after `on_frame` when the producer overwrote the frame while it was
+// being read; what `on_frame` made of it should be discarded
+OnTorn_Proc :: proc(metadata: FrameMetadata, user_data: rawptr)
+
+// how the frame index in the shared memory is checked around `on_frame`
+//
+// the index is read before and after the callback and compared with the one
+// the `SyncMessage` announced, like the sequence of a seqlock. A mismatch
+// before means the frame was already replaced (stale); one after means it
+// was replaced while being read (torn). It can only catch overwrites whose
+// header update is visible by the time of the second read.
+Consistency :: enum {
+	// no checks, as before
+	Off,
+	// count stale and torn frames, and call `on_torn`; deliver all of them
+	Detect,
+	// skip stale frames; call `on_torn` for torn ones
+	Drop,
+	// read the frame now in the shared memory again, up to `max_retries`
+	// times, then as `Drop`
+	Retry,
+}
+
+// counters of the reactor thread; see `consistency_stats`
+ConsistencyStats :: struct {
+	delivered: u64,
+	stale:     u64,
+	torn:      u64,
+	retried:   u64,
+	dropped:   u64,
+	// ring frames overwritten before they could be read
+	overrun:   u64,
+	// the segment grew (e.g. a larger resolution) or was replaced by a
+	// restarted producer, and was mapped again
+	remapped:  u64,
+}
 
 SharedBuffer :: struct {
 	// mmaped shared memory with size
 	_shm:     []u8,
-	// image buffer
+	// image buffer; the slots with `CV_MMAP_VERSION_RING`
 	image:    []u8,
 	// metadata region
 	metadata: []u8,
+	version:  u8,
+	// nil unless `CV_MMAP_VERSION_RING`
+	ring:     ^RingHeader,
 }
 
 CvMmapClient :: struct {
@@ -84,14 +174,28 @@ CvMmapClient :: struct {
 	_zmq_sock:         ^zmq.Socket,
 	_shm_fd:           Maybe(posix.FD),
 	_shared_buffer:    Maybe(SharedBuffer),
+	// the mapping before the last remap, unmapped at the next one (or `stop`)
+	// rather than right away, so that a pointer kept a frame too long reads a
+	// stale frame instead of faulting
+	_retired_shm:      []u8,
 	_has_init:         bool,
 	// task
-	_polling_task:     Maybe(^Thread),
+	_reactor:          ^reactor.Reactor,
+	_is_owned_reactor: bool,
 	_is_running:       bool,
 	// callbacks
 	// used in `on_frame` callback
 	user_data:         rawptr,
 	on_frame:          OnFrame_Proc,
+	on_torn:           OnTorn_Proc,
+	// set before `start`
+	consistency:       Consistency,
+	max_retries:       int,
+	_stats:            ConsistencyStats,
+	// the next ring frame to read; 0 before the first
+	_cursor:           u64,
+	// of the frame in `on_frame`, for the reactor thread only
+	timing:            FrameTiming,
 }
 
 // Refactored error types using tagged unions
@@ -133,11 +237,15 @@ create :: proc(instance_name: string, zmq_ctx: ^zmq.Context = nil) -> ^CvMmapCli
 	client._shared_buffer = nil
 	client._has_init = false
 
-	client._polling_task = nil
+	client._reactor = nil
+	client._is_owned_reactor = false
 	client._is_running = false
 
 	client.user_data = nil
 	client.on_frame = nil
+	client.on_torn = nil
+	client.consistency = .Off
+	client.max_retries = 1
 	return client
 }
 
@@ -168,12 +276,6 @@ init :: proc(self: ^CvMmapClient) -> (err: CvMmapError) {
 	if code != 0 {
 		return ZmqError{code, "setsockopt_bool"}
 	}
-	// ensure recv() wakes up periodically so we can exit cleanly
-	code = cast(int)zmq.setsockopt_int(self._zmq_sock, zmq.RCVTIMEO, 100) // 100 ms
-	if code != 0 {
-		return ZmqError{code, "setsockopt_int(RCVTIMEO)"}
-	}
-
 	// http://api.zeromq.org/4-2:zmq-connect
 	code = cast(int)zmq.connect(self._zmq_sock, zmq_addr_c)
 	if code != 0 {
@@ -215,6 +317,105 @@ _get_sync_msg_get_label :: proc(msg: ^SyncMessage) -> string {
 	return string(cstring(raw_data(msg.label[:])))
 }
 
+// map `size` bytes of `fd` and fault them in now, so that the first frames
+// do not take a page fault every 4 KiB. Large mappings ask for transparent
+// hugepages first, used if the kernel allows them for shared memory
+// (`transparent_hugepage/shmem_enabled`); prefaulting 4 KiB pages with
+// `MAP_POPULATE` would come too early for that.
+@(private)
+_map_shared :: proc(fd: posix.FD, size: int, is_writable: bool) -> (rawptr, linux.Errno) {
+	prot: linux.Mem_Protection = {.READ, .WRITE} if is_writable else {.READ}
+	ptr, errno := linux.mmap(0, uint(size), prot, {.SHARED}, linux.Fd(fd), 0)
+	if errno != .NONE {
+		return nil, errno
+	}
+	// both are advice; the mapping works without them
+	if size >= HUGEPAGE_MIN_SIZE {
+		linux.madvise(ptr, uint(size), .HUGEPAGE)
+	}
+	populate: linux.MAdvice = .POPULATE_WRITE if is_writable else .POPULATE_READ
+	if linux.madvise(ptr, uint(size), populate) != .NONE {
+		// before Linux 5.14; read ahead at least
+		linux.madvise(ptr, uint(size), .WILLNEED)
+	}
+	return ptr, .NONE
+}
+
+// whether the producer grew the segment past the mapping, i.e. the frames
+// are no longer within it
+@(private)
+_needs_remap :: proc(shared_buffer: ^SharedBuffer) -> bool {
+	switch shared_buffer.version {
+	case CV_MMAP_VERSION_RING:
+		ring := shared_buffer.ring
+		n_slots := intrinsics.atomic_load_explicit(&ring.n_slots, .Relaxed)
+		slot_stride := intrinsics.atomic_load_explicit(&ring.slot_stride, .Relaxed)
+		return int(n_slots) * int(slot_stride) > len(shared_buffer.image)
+	case:
+		size := intrinsics.atomic_load_explicit(&_metadata(shared_buffer).info.buffer_size, .Relaxed)
+		return int(size) > len(shared_buffer.image)
+	}
+}
+
+// whether the segment was unlinked, i.e. the producer was started again and
+// created a new one under the same name; the held one no longer changes
+@(private)
+_is_replaced :: proc(fd: posix.FD) -> bool {
+	stat: posix.stat_t
+	return posix.fstat(fd, &stat) == .OK && stat.st_nlink == 0
+}
+
+// map the segment again: the held one with its current size when it grew,
+// or the one now under its name when `is_replaced`. The old mapping is kept
+// on failure, and retired otherwise (see `_retired_shm`).
+@(private)
+_remap :: proc(client: ^CvMmapClient, is_replaced: bool) -> CvMmapError {
+	start := now_ns()
+	old := client._shared_buffer.?
+	fd := client._shm_fd.?
+	if is_replaced {
+		shm_name_c := strings.clone_to_cstring(client._shm_name)
+		defer delete(shm_name_c)
+		new_fd := posix.shm_open(shm_name_c, {}, {})
+		if new_fd == -1 {
+			return ShmError{cast(int)posix.get_errno(), "shm_open"}
+		}
+		shared_buffer, err := _get_shared_buffer(new_fd)
+		if err != nil {
+			posix.close(new_fd)
+			return err
+		}
+		posix.close(fd)
+		client._shm_fd = new_fd
+		client._shared_buffer = shared_buffer
+		// the new producer counts from 1, and the frames it published
+		// before this one are overrun rather than skipped
+		client._cursor = 1
+	} else {
+		shared_buffer, err := _get_shared_buffer(fd)
+		if err != nil {
+			return err
+		}
+		// the sequence goes on: the cursor is kept, and the frames of the
+		// slots before the resize are counted as overrun by `_deliver_ring`
+		client._shared_buffer = shared_buffer
+	}
+	if client._retired_shm != nil {
+		posix.munmap(raw_data(client._retired_shm), len(client._retired_shm))
+	}
+	client._retired_shm = old._shm
+	_count(&client._stats.remapped)
+	log.infof(
+		"%s %s; %d -> %d bytes in %.1f us",
+		client._shm_name,
+		"reopened" if is_replaced else "remapped",
+		len(old._shm),
+		len(client._shared_buffer.?._shm),
+		f64(now_ns() - start) / 1e3,
+	)
+	return nil
+}
+
 @(private)
 _get_shared_buffer :: proc(fd: posix.FD) -> (SharedBuffer, CvMmapError) {
 	image_buffer: SharedBuffer
@@ -223,21 +424,24 @@ _get_shared_buffer :: proc(fd: posix.FD) -> (SharedBuffer, CvMmapError) {
 	if ok != .OK {
 		return image_buffer, ShmError{cast(int)posix.get_errno(), "fstat"}
 	}
-	shm_ptr := posix.mmap(nil, cast(c.size_t)stat.st_size, {.READ}, {.SHARED}, fd, 0)
-	if shm_ptr == nil || shm_ptr == BAD_MMAP_ADDR {
-		return image_buffer, ShmError{cast(int)posix.get_errno(), "mmap"}
+	shm_ptr, errno := _map_shared(fd, int(stat.st_size), false)
+	if errno != .NONE {
+		return image_buffer, ShmError{int(errno), "mmap"}
 	}
 	image_buffer._shm = (cast([^]u8)shm_ptr)[:stat.st_size]
 	// memory layout:
 	// 0 - SHM_PAYLOAD_OFFSET: metadata
-	//    - 8: magic
-	//    - rest: metadata_rel:
+	//    - 7: magic
+	//    - 1: version
+	//    - rest: metadata_rel (`CV_MMAP_VERSION_SINGLE`):
 	//      - 4: frame_index
 	//      - rest: frame_info
-	// SHM_PAYLOAD_OFFSET - end: image
+	//    - rest: `RingHeader` (`CV_MMAP_VERSION_RING`)
+	// SHM_PAYLOAD_OFFSET - end: image, or `n_slots` slots of `slot_stride`
 	image_buffer.image = image_buffer._shm[SHM_PAYLOAD_OFFSET:]
 	image_buffer.metadata = image_buffer._shm[:SHM_PAYLOAD_OFFSET]
-	cv_mmap_magic := string(cstring(raw_data(image_buffer.metadata[:CV_MMAP_MAGIC_LEN])))
+	// the version byte is not part of the magic
+	cv_mmap_magic := string(image_buffer.metadata[:CV_MMAP_VERSION_OFFSET])
 	assert(
 		cv_mmap_magic == CV_MMAP_MAGIC_STR,
 		fmt.tprintf(
@@ -246,98 +450,264 @@ _get_shared_buffer :: proc(fd: posix.FD) -> (SharedBuffer, CvMmapError) {
 			cv_mmap_magic,
 		),
 	)
+	image_buffer.version = image_buffer.metadata[CV_MMAP_VERSION_OFFSET]
+	switch image_buffer.version {
+	case CV_MMAP_VERSION_SINGLE:
+	case CV_MMAP_VERSION_RING:
+		ring := cast(^RingHeader)(raw_data(image_buffer.metadata[CV_MMAP_MAGIC_LEN:]))
+		required := int(ring.n_slots) * int(ring.slot_stride)
+		if ring.n_slots < 2 || ring.slot_stride <= RING_SLOT_HEADER_SIZE || len(image_buffer.image) < required {
+			posix.munmap(shm_ptr, cast(c.size_t)stat.st_size)
+			return image_buffer, ShmError{0, "invalid ring header"}
+		}
+		image_buffer.ring = ring
+	case:
+		posix.munmap(shm_ptr, cast(c.size_t)stat.st_size)
+		return image_buffer, ShmError{0, "unsupported cv-mmap layout version"}
+	}
 	return image_buffer, nil
 }
 
+// slot of frame `seq` in the ring layout, header included
+@(private)
+_ring_slot :: proc(shared_buffer: ^SharedBuffer, seq: u64, n_slots: u32, slot_stride: u32) -> []u8 {
+	offset := int(seq % u64(n_slots)) * int(slot_stride)
+	return shared_buffer.image[offset:][:slot_stride]
+}
+
 @(private)
 _metadata :: proc(image_buffer_state: ^SharedBuffer) -> ^FrameMetadata {
 	return cast(^FrameMetadata)(raw_data(image_buffer_state.metadata[CV_MMAP_MAGIC_LEN:]))
 }
 
+// nanoseconds of `CLOCK_MONOTONIC`, shared by the producer and the client
+now_ns :: proc() -> u64 {
+	ts: posix.timespec
+	posix.clock_gettime(.MONOTONIC, &ts)
+	return u64(ts.tv_sec) * 1_000_000_000 + u64(ts.tv_nsec)
+}
+
+// the counters so far; may be called from any thread
+consistency_stats :: proc(self: ^CvMmapClient) -> (stats: ConsistencyStats) {
+	stats.delivered = intrinsics.atomic_load_explicit(&self._stats.delivered, .Relaxed)
+	stats.stale = intrinsics.atomic_load_explicit(&self._stats.stale, .Relaxed)
+	stats.torn = intrinsics.atomic_load_explicit(&self._stats.torn, .Relaxed)
+	stats.retried = intrinsics.atomic_load_explicit(&self._stats.retried, .Relaxed)
+	stats.dropped = intrinsics.atomic_load_explicit(&self._stats.dropped, .Relaxed)
+	stats.overrun = intrinsics.atomic_load_explicit(&self._stats.overrun, .Relaxed)
+	stats.remapped = intrinsics.atomic_load_explicit(&self._stats.remapped, .Relaxed)
+	return
+}
+
+@(private)
+_count :: #force_inline proc(counter: ^u64) {
+	intrinsics.atomic_add_explicit(counter, 1, .Relaxed)
+}
+
+// call `on_frame` with every ring frame from the cursor to the newest, in
+// place; frames overwritten before or while being read are counted as
+// overrun or torn (`client.consistency` only applies to the single image
+// layout, slots are always checked)
 @(private)
-_polling_task :: proc(t: ^Thread) {
-	client := cast(^CvMmapClient)t.data
-
-	recv_sync_msg :: proc(skt: ^zmq.Socket) -> (SyncMessage, bool) {
-		sync_msg := SyncMessage{}
-		msg := zmq.Message{}
-		// http://wiki.zeromq.org/results:10gbe-tests
-		// https://zguide.zeromq.org/docs/chapter2/#Messaging-Patterns
-		// 
-		//  We will use these often, but `zmq_recv()` is bad at dealing with
-		//  arbitrary message sizes: it truncates messages to whatever buffer size
-		//  you provide. So there's a second API that works with `zmq_msg_t`
-		//  structures, with a richer but more difficult API
-		data, ok := zmq.recv_msg_bytes(&msg, skt)
-		defer zmq.msg_close(&msg)
-		if !ok {
-			return sync_msg, false
+_deliver_ring :: proc(client: ^CvMmapClient, shared_buffer: ^SharedBuffer) {
+	ring := shared_buffer.ring
+	newest := intrinsics.atomic_load_explicit(&ring.write_seq, .Acquire)
+	if newest == 0 {
+		return
+	}
+	if client._cursor == 0 || client._cursor > newest + 1 {
+		// the first frame, or the producer restarted
+		client._cursor = newest
+	}
+	// read once, as the producer rewrites them when it resizes the ring (the
+	// stride is 0 meanwhile); a layout past the mapping is left for the remap
+	// of the next message
+	n_slots := u64(intrinsics.atomic_load_explicit(&ring.n_slots, .Relaxed))
+	slot_stride := intrinsics.atomic_load_explicit(&ring.slot_stride, .Relaxed)
+	if n_slots < 2 || slot_stride <= RING_SLOT_HEADER_SIZE || int(n_slots) * int(slot_stride) > len(shared_buffer.image) {
+		return
+	}
+	// the slot of `newest + 1 - n_slots` may be being written already
+	oldest := newest + 2 - n_slots if newest + 2 > n_slots else 1
+	if client._cursor < oldest {
+		intrinsics.atomic_add_explicit(&client._stats.overrun, oldest - client._cursor, .Relaxed)
+		client._cursor = oldest
+	}
+	for ; client._cursor <= newest; client._cursor += 1 {
+		seq := client._cursor
+		slot := _ring_slot(shared_buffer, seq, u32(n_slots), slot_stride)
+		header := cast(^RingSlotHeader)raw_data(slot)
+		if intrinsics.atomic_load_explicit(&header.seq, .Acquire) != 2 * seq {
+			_count(&client._stats.overrun)
+			continue
 		}
-		if l := len(data); l < size_of(SyncMessage) {
-			log.errorf("invalid message size={}; required size={}", l, size_of(SyncMessage))
-			return sync_msg, false
+		metadata := header.metadata
+		size := min(int(metadata.info.buffer_size), len(slot) - RING_SLOT_HEADER_SIZE)
+		if client.on_frame != nil {
+			client.on_frame(metadata, slot[RING_SLOT_HEADER_SIZE:][:size], client.user_data)
 		}
-		sync_msg = (cast(^SyncMessage)(raw_data(data)))^
-		if sync_msg.magic != FRAME_TOPIC_MAGIC {
-			log.errorf("invalid magic={}", sync_msg.magic)
-			return sync_msg, false
+		intrinsics.atomic_thread_fence(.Acquire)
+		if intrinsics.atomic_load_explicit(&header.seq, .Relaxed) != 2 * seq {
+			_count(&client._stats.torn)
+			if client.on_torn != nil {
+				client.on_torn(metadata, client.user_data)
+			}
+			continue
 		}
-		return sync_msg, true
+		_count(&client._stats.delivered)
 	}
+}
+
+// the image of `metadata` in the single image layout; the mapping may still
+// be larger than a frame of a lower resolution
+@(private)
+_image_of :: proc(shared_buffer: ^SharedBuffer, metadata: FrameMetadata) -> []u8 {
+	return shared_buffer.image[:min(int(metadata.info.buffer_size), len(shared_buffer.image))]
+}
 
-	on_initial_frame :: proc(client: ^CvMmapClient) -> bool {
-		ok: bool = ---
-		assert(client._shm_fd != nil, "`nil` shm_fd")
-		sync_msg: SyncMessage
-		sync_msg, ok = recv_sync_msg(client._zmq_sock)
-		if !ok {
-			return false
+// call `on_frame` with the frame announced as `frame_index`, checked as set
+// by `client.consistency`
+@(private)
+_deliver :: proc(client: ^CvMmapClient, frame_index: u32) {
+	assert(client._shared_buffer != nil, "`nil` image buffer")
+	shared_buffer := &client._shared_buffer.?
+	if shared_buffer.version == CV_MMAP_VERSION_RING {
+		_deliver_ring(client, shared_buffer)
+		return
+	}
+	if client.on_frame == nil {
+		return
+	}
+	meta_ptr := _metadata(shared_buffer)
+	if client.consistency == .Off {
+		metadata := meta_ptr^
+		client.on_frame(metadata, _image_of(shared_buffer, metadata), client.user_data)
+		_count(&client._stats.delivered)
+		return
+	}
+
+	expected := frame_index
+	for attempt := 0; ; attempt += 1 {
+		can_retry := client.consistency == .Retry && attempt < client.max_retries
+		// the payload is read after this, and before the second load
+		before := intrinsics.atomic_load_explicit(&meta_ptr.frame_index, .Acquire)
+		if before != expected {
+			_count(&client._stats.stale)
+			if can_retry {
+				// the newest frame instead
+				_count(&client._stats.retried)
+				expected = before
+				continue
+			}
+			if client.consistency != .Detect {
+				_count(&client._stats.dropped)
+				return
+			}
+		}
+		metadata := meta_ptr^
+		client.on_frame(metadata, _image_of(shared_buffer, metadata), client.user_data)
+		intrinsics.atomic_thread_fence(.Acquire)
+		after := intrinsics.atomic_load_explicit(&meta_ptr.frame_index, .Relaxed)
+		if after == before {
+			_count(&client._stats.delivered)
+			return
+		}
+		_count(&client._stats.torn)
+		if can_retry {
+			_count(&client._stats.retried)
+			expected = after
+			continue
+		}
+		if client.consistency != .Detect {
+			_count(&client._stats.dropped)
+		}
+		if client.on_torn != nil {
+			client.on_torn(metadata, client.user_data)
 		}
+		return
+	}
+}
+
+@(private)
+_recv_sync_msg :: proc(skt: ^zmq.Socket) -> (SyncMessage, bool) {
+	sync_msg := SyncMessage{}
+	msg := zmq.Message{}
+	// http://wiki.zeromq.org/results:10gbe-tests
+	// https://zguide.zeromq.org/docs/chapter2/#Messaging-Patterns
+	// 
+	//  We will use these often, but `zmq_recv()` is bad at dealing with
+	//  arbitrary message sizes: it truncates messages to whatever buffer size
+	//  you provide. So there's a second API that works with `zmq_msg_t`
+	//  structures, with a richer but more difficult API
+	data, ok := zmq.recv_msg_bytes(&msg, skt)
+	defer zmq.msg_close(&msg)
+	if !ok {
+		return sync_msg, false
+	}
+	// older producers send no timestamp
+	if l := len(data); l < SYNC_MESSAGE_V1_SIZE {
+		log.errorf("invalid message size={}; required size={}", l, SYNC_MESSAGE_V1_SIZE)
+		return sync_msg, false
+	}
+	mem.copy(&sync_msg, raw_data(data), min(len(data), size_of(SyncMessage)))
+	if sync_msg.magic != FRAME_TOPIC_MAGIC {
+		log.errorf("invalid magic={}", sync_msg.magic)
+		return sync_msg, false
+	}
+	return sync_msg, true
+}
+
+// one sync message, called by the reactor once the socket is readable
+@(private)
+_on_readable :: proc(skt: ^zmq.Socket, user_data: rawptr) {
+	client := cast(^CvMmapClient)user_data
+	sync_msg, ok := _recv_sync_msg(skt)
+	if !ok {
+		return
+	}
+	received_ns := now_ns()
+	if client._shared_buffer == nil {
+		// the producer has created the shared memory by its first message
 		fd: FD
 		fd, ok = client._shm_fd.?
 		assert(ok, "`nil` shm_fd")
-
+		map_start := now_ns()
 		image_buffer, err := _get_shared_buffer(fd)
 		if err != nil {
 			log.errorf("failed to get image buffer; err={}", err)
-			return false
+			return
 		}
 		client._shared_buffer = image_buffer
-		if (client.on_frame != nil) {
-			meta_ptr := _metadata(&image_buffer)
-			client.on_frame(meta_ptr^, image_buffer.image, client.user_data)
-		}
-		return true
-	}
-
-	for client._is_running {
-		if client._shared_buffer == nil {
-			ok := on_initial_frame(client)
-			if !ok {
-				continue
-			}
-		}
-		ok: bool = ---
-		sync_msg: SyncMessage
-		sync_msg, ok = recv_sync_msg(client._zmq_sock)
-		if !ok {
-			continue
-		}
+		log.infof("%s mapped; %d bytes in %.1f us", client._shm_name, len(image_buffer._shm), f64(now_ns() - map_start) / 1e3)
+	} else {
 		label := _get_sync_msg_get_label(&sync_msg)
 		if label != client._instance_name {
 			log.errorf("invalid label={}; expected={}", label, client._instance_name)
-			continue
+			return
 		}
-		if (client.on_frame != nil) {
-			assert(client._shared_buffer != nil, "`nil` image buffer")
-			meta_ptr := _metadata(&client._shared_buffer.?)
-			client.on_frame(meta_ptr^, client._shared_buffer.?.image, client.user_data)
+		is_replaced := _is_replaced(client._shm_fd.?)
+		if is_replaced || _needs_remap(&client._shared_buffer.?) {
+			if err := _remap(client, is_replaced); err != nil {
+				log.errorf("failed to remap image buffer; err={}", err)
+				return
+			}
 		}
 	}
+	client.timing = FrameTiming{sync_msg.timestamp_ns, received_ns}
+	_deliver(client, sync_msg.frame_index)
 }
 
-// start the polling thread, initialize memory mapping
-start :: proc(self: ^CvMmapClient, init_context := context) -> (err: CvMmapError) {
+// receive frames on `shared`, or on a reactor of its own if `nil`
+//
+// a shared reactor is started by the caller after every `start` (sockets
+// are added while it is stopped), and stopped before any `stop`
+start :: proc(
+	self: ^CvMmapClient,
+	shared: ^reactor.Reactor = nil,
+	init_context := context,
+) -> (
+	err: CvMmapError,
+) {
 	if !self._has_init {
 		return StateError.NeverInitialized
 	}
@@ -345,14 +715,16 @@ start :: proc(self: ^CvMmapClient, init_context := context) -> (err: CvMmapError
 		return StateError.AlreadyRunning
 	}
 	self._is_running = true
-	self._polling_task = thread.create(_polling_task)
-	self._polling_task.?.data = self
-	self._polling_task.?.init_context = init_context
-	thread.start(self._polling_task.?)
+	self._is_owned_reactor = shared == nil
+	self._reactor = shared if shared != nil else reactor.create()
+	reactor.add(self._reactor, self._zmq_sock, _on_readable, self)
+	if self._is_owned_reactor {
+		reactor.start(self._reactor, init_context)
+	}
 	return nil
 }
 
-// join the polling thread, destroy the thread and unmap the shared memory
+// stop receiving, close the socket and unmap the shared memory
 stop :: proc(self: ^CvMmapClient) {
 	if !self._has_init {
 		return
@@ -361,11 +733,14 @@ stop :: proc(self: ^CvMmapClient) {
 		return
 	}
 	self._is_running = false
-	if task, ok := self._polling_task.?; ok {
-		thread.join(task)
-		thread.destroy(task)
+	if self._is_owned_reactor {
+		reactor.destroy(self._reactor)
+	} else {
+		assert(!reactor.is_running(self._reactor), "the shared reactor is stopped before the client")
+		reactor.remove(self._reactor, self._zmq_sock)
 	}
-	// close the socket now that the polling thread is gone
+	self._reactor = nil
+	// close the socket now that no thread polls it
 	if self._zmq_sock != nil {
 		zmq.close(self._zmq_sock)
 		self._zmq_sock = nil
@@ -375,6 +750,10 @@ stop :: proc(self: ^CvMmapClient) {
 		assert(res != .FAIL, "munmap failed")
 		self._shared_buffer = nil
 	}
+	if self._retired_shm != nil {
+		posix.munmap(raw_data(self._retired_shm), len(self._retired_shm))
+		self._retired_shm = nil
+	}
 	if self._shm_fd != nil {
 		posix.close(self._shm_fd.?)
 		self._shm_fd = nil
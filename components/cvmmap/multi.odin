@@ -0,0 +1,123 @@
+package cvmmap
+import "../reactor"
+import zmq "../../lib/odin-zeromq"
+
+// many cv-mmap instances (i.e. cameras) received on one ZMQ context and one
+// reactor thread, instead of a context and a thread each
+//
+// every instance keeps its own SUB socket and mapping: they are distinct
+// shared memory objects, and one socket connected to every producer would
+// conflate the frames of all of them into one
+//
+// a proper life cycle:
+// multi_create -> multi_init -> setting callbacks -> multi_start ->
+// multi_stop -> multi_destroy
+MultiClient :: struct {
+	clients:           []^CvMmapClient,
+	_instances:        []MultiInstance,
+	_zmq_ctx:          ^zmq.Context,
+	_is_owned_zmq_ctx: bool,
+	_reactor:          ^reactor.Reactor,
+	_is_running:       bool,
+	// callbacks
+	user_data:         rawptr,
+	// on the reactor thread, or its worker; `index` into `clients`. `buffer`
+	// is only valid during the call, as with `OnFrame_Proc`
+	on_frame:          OnInstanceFrame_Proc,
+}
+
+OnInstanceFrame_Proc :: proc(index: int, metadata: FrameMetadata, buffer: []u8, user_data: rawptr)
+
+// `user_data` of every client
+@(private)
+MultiInstance :: struct {
+	multi: ^MultiClient,
+	index: int,
+}
+
+// will create a new ZMQ context if not provided; see `reactor.create` for
+// `is_dispatch_to_worker`
+multi_create :: proc(
+	instance_names: []string,
+	zmq_ctx: ^zmq.Context = nil,
+	is_dispatch_to_worker := false,
+) -> ^MultiClient {
+	self := new(MultiClient)
+	self._zmq_ctx = zmq_ctx if zmq_ctx != nil else zmq.ctx_new()
+	self._is_owned_zmq_ctx = zmq_ctx == nil
+	self._reactor = reactor.create(is_dispatch_to_worker)
+	self.clients = make([]^CvMmapClient, len(instance_names))
+	self._instances = make([]MultiInstance, len(instance_names))
+	for name, i in instance_names {
+		self._instances[i] = MultiInstance{self, i}
+		client := create(name, self._zmq_ctx)
+		client.on_frame = _multi_on_frame
+		client.user_data = &self._instances[i]
+		self.clients[i] = client
+	}
+	return self
+}
+
+multi_destroy :: proc(self: ^MultiClient) {
+	multi_stop(self)
+	for client in self.clients {
+		destroy(client)
+	}
+	reactor.destroy(self._reactor)
+	if self._is_owned_zmq_ctx {
+		zmq.ctx_term(self._zmq_ctx)
+	}
+	delete(self.clients)
+	delete(self._instances)
+	free(self)
+}
+
+// initialize every instance; stops at the first one failing, whose index is
+// returned along with its error
+multi_init :: proc(self: ^MultiClient) -> (index: int, err: CvMmapError) {
+	for client, i in self.clients {
+		if err = init(client); err != nil {
+			return i, err
+		}
+	}
+	return -1, nil
+}
+
+@(private)
+_multi_on_frame :: proc(metadata: FrameMetadata, buffer: []u8, user_data: rawptr) {
+	instance := cast(^MultiInstance)user_data
+	multi := instance.multi
+	if multi.on_frame != nil {
+		multi.on_frame(instance.index, metadata, buffer, multi.user_data)
+	}
+}
+
+// `consistency`, `max_retries` and `on_torn` of `clients` may be set before
+multi_start :: proc(self: ^MultiClient, init_context := context) -> (index: int, err: CvMmapError) {
+	if self._is_running {
+		return -1, StateError.AlreadyRunning
+	}
+	for client, i in self.clients {
+		if err = start(client, self._reactor, init_context); err != nil {
+			// the reactor is not running yet
+			for started in self.clients[:i] {
+				stop(started)
+			}
+			return i, err
+		}
+	}
+	reactor.start(self._reactor, init_context)
+	self._is_running = true
+	return -1, nil
+}
+
+multi_stop :: proc(self: ^MultiClient) {
+	if !self._is_running {
+		return
+	}
+	self._is_running = false
+	reactor.stop(self._reactor)
+	for client in self.clients {
+		stop(client)
+	}
+}
@@ -0,0 +1,238 @@
+package cvmmap
+import zmq "../../lib/odin-zeromq"
+import "base:intrinsics"
+import "core:fmt"
+import "core:strings"
+import "core:sys/posix"
+
+// the producer side of the protocol, as a local stand-in for a camera
+//
+// creates `cvmmap_<instance_name>` and publishes `SyncMessage`s on
+// `ipc:///tmp/cvmmap_<instance_name>`, in the single image layout
+// (`n_slots == 0`) or the ring layout
+//
+// a frame is written with `begin_frame`, filling the returned image, then
+// `publish_frame`
+Producer :: struct {
+	_instance_name:    string,
+	_shm_name:         string,
+	_zmq_addr:         string,
+	_zmq_ctx:          ^zmq.Context,
+	_is_owned_zmq_ctx: bool,
+	_zmq_sock:         ^zmq.Socket,
+	_shm_fd:           posix.FD,
+	_shm:              []u8,
+	_info:             FrameInfo,
+	_n_slots:          int,
+	_slot_stride:      int,
+	// the frame being written; 0 between frames
+	_seq:              u64,
+	_frame_index:      u32,
+}
+
+PAGE_SIZE :: 4096
+
+@(private)
+_round_up :: proc(n: int, to: int) -> int {
+	return (n + to - 1) / to * to
+}
+
+// `info.buffer_size` is the size of one image; `n_slots` is 0 or at least 2
+producer_create :: proc(
+	instance_name: string,
+	info: FrameInfo,
+	n_slots: int = 0,
+	zmq_ctx: ^zmq.Context = nil,
+) -> (
+	producer: ^Producer,
+	err: CvMmapError,
+) {
+	assert(n_slots == 0 || n_slots >= 2, "n_slots must be 0 or at least 2")
+	ctx := zmq_ctx if zmq_ctx != nil else zmq.ctx_new()
+	self := new(Producer)
+	self._instance_name = strings.clone(instance_name)
+	self._shm_name = fmt.aprintf("cvmmap_%s", instance_name)
+	self._zmq_addr = fmt.aprintf("ipc:///tmp/cvmmap_%s", instance_name)
+	self._zmq_ctx = ctx
+	self._is_owned_zmq_ctx = zmq_ctx == nil
+	self._zmq_sock = zmq.socket(ctx, zmq.PUB)
+	self._shm_fd = -1
+	self._info = info
+	self._n_slots = n_slots
+	defer if err != nil {
+		producer_destroy(self)
+		producer = nil
+	}
+
+	size: int
+	size, self._slot_stride = _segment_size(info, n_slots)
+
+	shm_name_c := strings.clone_to_cstring(self._shm_name)
+	defer delete(shm_name_c)
+	self._shm_fd = posix.shm_open(shm_name_c, {.CREAT, .RDWR}, {.IRUSR, .IWUSR, .IRGRP, .IROTH})
+	if self._shm_fd == -1 {
+		return self, ShmError{cast(int)posix.get_errno(), "shm_open"}
+	}
+	if posix.ftruncate(self._shm_fd, posix.off_t(size)) != .OK {
+		return self, ShmError{cast(int)posix.get_errno(), "ftruncate"}
+	}
+	shm_ptr, errno := _map_shared(self._shm_fd, size, true)
+	if errno != .NONE {
+		return self, ShmError{int(errno), "mmap"}
+	}
+	self._shm = (cast([^]u8)shm_ptr)[:size]
+
+	copy(self._shm[:CV_MMAP_VERSION_OFFSET], CV_MMAP_MAGIC_STR)
+	if n_slots == 0 {
+		self._shm[CV_MMAP_VERSION_OFFSET] = CV_MMAP_VERSION_SINGLE
+		_producer_metadata(self)^ = FrameMetadata{0, info}
+	} else {
+		self._shm[CV_MMAP_VERSION_OFFSET] = CV_MMAP_VERSION_RING
+		ring := _producer_ring(self)
+		ring^ = RingHeader{u32(n_slots), u32(self._slot_stride), 0}
+		_reset_slots(self)
+	}
+
+	zmq_addr_c := strings.clone_to_cstring(self._zmq_addr)
+	defer delete(zmq_addr_c)
+	if code := cast(int)zmq.bind(self._zmq_sock, zmq_addr_c); code != 0 {
+		return self, ZmqError{code, "bind"}
+	}
+	return self, nil
+}
+
+producer_destroy :: proc(self: ^Producer) {
+	if self._zmq_sock != nil {
+		zmq.close(self._zmq_sock)
+	}
+	if self._is_owned_zmq_ctx {
+		zmq.ctx_term(self._zmq_ctx)
+	}
+	if self._shm != nil {
+		posix.munmap(raw_data(self._shm), len(self._shm))
+	}
+	if self._shm_fd != -1 {
+		posix.close(self._shm_fd)
+		shm_name_c := strings.clone_to_cstring(self._shm_name)
+		posix.shm_unlink(shm_name_c)
+		delete(shm_name_c)
+	}
+	delete(self._instance_name)
+	delete(self._shm_name)
+	delete(self._zmq_addr)
+	free(self)
+}
+
+// the segment size, and the slot stride of the ring layout
+@(private)
+_segment_size :: proc(info: FrameInfo, n_slots: int) -> (size: int, slot_stride: int) {
+	if n_slots == 0 {
+		return SHM_PAYLOAD_OFFSET + int(info.buffer_size), 0
+	}
+	// every image page aligned
+	slot_stride = _round_up(RING_SLOT_HEADER_SIZE + int(info.buffer_size), PAGE_SIZE)
+	return SHM_PAYLOAD_OFFSET + n_slots * slot_stride, slot_stride
+}
+
+@(private)
+_reset_slots :: proc(self: ^Producer) {
+	for i in 0 ..< self._n_slots {
+		header := cast(^RingSlotHeader)raw_data(self._shm[SHM_PAYLOAD_OFFSET + i * self._slot_stride:])
+		header^ = RingSlotHeader{0, FrameMetadata{0, self._info}}
+	}
+}
+
+// change the frame geometry between frames, e.g. to another resolution
+//
+// the segment only grows: clients notice a frame past their mapping and map
+// it again, and a client still on the old mapping never reads past the end
+// of the segment (`SIGBUS`). A ring starts over with empty slots.
+producer_resize :: proc(self: ^Producer, info: FrameInfo) -> CvMmapError {
+	assert(self._seq == 0, "`producer_resize` while writing a frame")
+	size, slot_stride := _segment_size(info, self._n_slots)
+	if size > len(self._shm) {
+		if posix.ftruncate(self._shm_fd, posix.off_t(size)) != .OK {
+			return ShmError{cast(int)posix.get_errno(), "ftruncate"}
+		}
+		shm_ptr, errno := _map_shared(self._shm_fd, size, true)
+		if errno != .NONE {
+			return ShmError{int(errno), "mmap"}
+		}
+		posix.munmap(raw_data(self._shm), len(self._shm))
+		self._shm = (cast([^]u8)shm_ptr)[:size]
+	}
+	self._info = info
+	if self._n_slots == 0 {
+		metadata := _producer_metadata(self)
+		metadata.info = info
+		return nil
+	}
+	ring := _producer_ring(self)
+	// no slot is valid until the stride is, which is published last
+	intrinsics.atomic_store_explicit(&ring.slot_stride, 0, .Release)
+	self._slot_stride = slot_stride
+	_reset_slots(self)
+	intrinsics.atomic_store_explicit(&ring.slot_stride, u32(slot_stride), .Release)
+	return nil
+}
+
+@(private)
+_producer_metadata :: proc(self: ^Producer) -> ^FrameMetadata {
+	return cast(^FrameMetadata)raw_data(self._shm[CV_MMAP_MAGIC_LEN:])
+}
+
+@(private)
+_producer_ring :: proc(self: ^Producer) -> ^RingHeader {
+	return cast(^RingHeader)raw_data(self._shm[CV_MMAP_MAGIC_LEN:])
+}
+
+@(private)
+_producer_slot :: proc(self: ^Producer, seq: u64) -> ^RingSlotHeader {
+	offset := SHM_PAYLOAD_OFFSET + int(seq % u64(self._n_slots)) * self._slot_stride
+	return cast(^RingSlotHeader)raw_data(self._shm[offset:])
+}
+
+// the image to write frame `frame_index` into, until `publish_frame`
+//
+// in the single image layout, this is the image clients may still be
+// reading; its frame index is updated first, so that they can tell
+begin_frame :: proc(self: ^Producer, frame_index: u32) -> []u8 {
+	assert(self._seq == 0, "`begin_frame` twice without `publish_frame`")
+	self._frame_index = frame_index
+	size := int(self._info.buffer_size)
+	if self._n_slots == 0 {
+		self._seq = 1
+		intrinsics.atomic_store_explicit(&_producer_metadata(self).frame_index, frame_index, .Release)
+		return self._shm[SHM_PAYLOAD_OFFSET:][:size]
+	}
+	ring := _producer_ring(self)
+	self._seq = intrinsics.atomic_load_explicit(&ring.write_seq, .Relaxed) + 1
+	header := _producer_slot(self, self._seq)
+	// odd: being written
+	intrinsics.atomic_store_explicit(&header.seq, 2 * self._seq - 1, .Relaxed)
+	intrinsics.atomic_thread_fence(.Release)
+	header.metadata = FrameMetadata{frame_index, self._info}
+	return (cast([^]u8)header)[RING_SLOT_HEADER_SIZE:][:size]
+}
+
+// mark the frame of `begin_frame` complete and announce it
+publish_frame :: proc(self: ^Producer) -> CvMmapError {
+	assert(self._seq != 0, "`publish_frame` without `begin_frame`")
+	if self._n_slots != 0 {
+		header := _producer_slot(self, self._seq)
+		intrinsics.atomic_store_explicit(&header.seq, 2 * self._seq, .Release)
+		intrinsics.atomic_store_explicit(&_producer_ring(self).write_seq, self._seq, .Release)
+	}
+	self._seq = 0
+
+	msg := SyncMessage {
+		magic        = FRAME_TOPIC_MAGIC,
+		frame_index  = self._frame_index,
+		timestamp_ns = now_ns(),
+	}
+	copy(msg.label[:NAME_MAX_LEN - 1], self._instance_name)
+	if code := cast(int)zmq.send(self._zmq_sock, &msg, size_of(SyncMessage), 0); code < 0 {
+		return ZmqError{code, "send"}
+	}
+	return nil
+}
@@ -0,0 +1,302 @@
+package cvmmap
+import "core:fmt"
+import "core:slice"
+import "core:strings"
+import "core:sys/posix"
+import "core:testing"
+
+// a `Producer` and the ring delivery of a client, driven frame by frame on
+// one thread: `_deliver_ring` is called where the reactor would call it
+// after a sync message, so what is overrun, torn or delivered is exact
+//
+//   odin test components/cvmmap
+
+@(private = "file")
+TEST_INFO :: FrameInfo {
+	width        = 16,
+	height       = 8,
+	channels     = 3,
+	depth        = .U8,
+	buffer_size  = 16 * 8 * 3,
+	pixel_format = .BGR,
+}
+
+@(private = "file")
+RingTest :: struct {
+	producer:  ^Producer,
+	client:    CvMmapClient,
+	// frame indices `on_frame` was called with, in order
+	frames:    [dynamic]u32,
+	// frames whose image was not filled with their index
+	corrupted: int,
+	torn:      int,
+	// publish this many frames from within the next `on_frame`, i.e. while
+	// its slot is read
+	lap:       int,
+	next:      u32,
+}
+
+// every byte of frame `frame_index` is `u8(frame_index)`
+@(private = "file")
+_publish :: proc(t: ^testing.T, rt: ^RingTest) {
+	rt.next += 1
+	image := begin_frame(rt.producer, rt.next)
+	slice.fill(image, u8(rt.next))
+	testing.expect_value(t, publish_frame(rt.producer), nil)
+}
+
+@(private = "file")
+_on_frame :: proc(metadata: FrameMetadata, buffer: []u8, user_data: rawptr) {
+	rt := cast(^RingTest)user_data
+	append(&rt.frames, metadata.frame_index)
+	if lap := rt.lap; lap > 0 {
+		rt.lap = 0
+		for _ in 0 ..< lap {
+			rt.next += 1
+			image := begin_frame(rt.producer, rt.next)
+			slice.fill(image, u8(rt.next))
+			publish_frame(rt.producer)
+		}
+		return
+	}
+	if len(buffer) != int(TEST_INFO.buffer_size) || buffer[0] != u8(metadata.frame_index) || buffer[len(buffer) - 1] != u8(metadata.frame_index) {
+		rt.corrupted += 1
+	}
+}
+
+@(private = "file")
+_on_torn :: proc(metadata: FrameMetadata, user_data: rawptr) {
+	rt := cast(^RingTest)user_data
+	rt.torn += 1
+}
+
+// a producer of `n_slots`, and a client mapping its segment as `_on_readable`
+// would on the first message
+@(private = "file")
+_ring_test_init :: proc(t: ^testing.T, rt: ^RingTest, name: string, n_slots: int) -> bool {
+	err: CvMmapError
+	rt.producer, err = producer_create(name, TEST_INFO, n_slots)
+	if !testing.expect_value(t, err, nil) {
+		return false
+	}
+	return _ring_test_map(t, rt)
+}
+
+@(private = "file")
+_ring_test_map :: proc(t: ^testing.T, rt: ^RingTest) -> bool {
+	shared_buffer, err := _get_shared_buffer(rt.producer._shm_fd)
+	if !testing.expect_value(t, err, nil) {
+		return false
+	}
+	rt.client._shared_buffer = shared_buffer
+	rt.client.on_frame = _on_frame
+	rt.client.on_torn = _on_torn
+	rt.client.user_data = rt
+	return true
+}
+
+@(private = "file")
+_ring_test_unmap :: proc(rt: ^RingTest) {
+	if shared_buffer, ok := rt.client._shared_buffer.?; ok {
+		posix.munmap(raw_data(shared_buffer._shm), len(shared_buffer._shm))
+		rt.client._shared_buffer = nil
+	}
+}
+
+@(private = "file")
+_ring_test_destroy :: proc(rt: ^RingTest) {
+	_ring_test_unmap(rt)
+	if rt.producer != nil {
+		producer_destroy(rt.producer)
+	}
+	delete(rt.frames)
+}
+
+@(private = "file")
+_deliver_now :: proc(rt: ^RingTest) {
+	_deliver_ring(&rt.client, &rt.client._shared_buffer.?)
+}
+
+// frames the client was too slow for are counted, and the ones still in the
+// ring are delivered in order
+@(test)
+test_ring_overrun :: proc(t: ^testing.T) {
+	for n_slots in 2 ..= 3 {
+		rt: RingTest
+		defer _ring_test_destroy(&rt)
+		if !_ring_test_init(t, &rt, fmt.tprintf("test_overrun_%d", n_slots), n_slots) {
+			return
+		}
+		// the first delivery starts at the newest frame
+		for _ in 0 ..< 3 {
+			_publish(t, &rt)
+		}
+		_deliver_now(&rt)
+		testing.expect(t, slice.equal(rt.frames[:], []u32{3}), fmt.tprintf("n_slots=%d: frames=%v", n_slots, rt.frames))
+		testing.expect_value(t, consistency_stats(&rt.client).overrun, 0)
+
+		// 4 to 10 while the client is away; the slot after the newest may be
+		// being written, so `n_slots - 1` are left
+		clear(&rt.frames)
+		for _ in 0 ..< 7 {
+			_publish(t, &rt)
+		}
+		_deliver_now(&rt)
+		newest := []u32{9, 10}
+		expected := newest[3 - n_slots:]
+		testing.expect(t, slice.equal(rt.frames[:], expected), fmt.tprintf("n_slots=%d: frames=%v", n_slots, rt.frames))
+		testing.expect_value(t, consistency_stats(&rt.client).overrun, u64(8 - n_slots))
+
+		// caught up again
+		clear(&rt.frames)
+		_publish(t, &rt)
+		_deliver_now(&rt)
+		testing.expect(t, slice.equal(rt.frames[:], []u32{11}), fmt.tprintf("n_slots=%d: frames=%v", n_slots, rt.frames))
+
+		stats := consistency_stats(&rt.client)
+		testing.expect_value(t, stats.overrun, u64(8 - n_slots))
+		testing.expect_value(t, stats.delivered, u64(1 + (n_slots - 1) + 1))
+		testing.expect_value(t, stats.torn, 0)
+		testing.expect_value(t, rt.corrupted, 0)
+	}
+}
+
+// the producer wraps around onto the slot `on_frame` is reading: the frame
+// is torn, not delivered, and the frames published meanwhile follow
+@(test)
+test_ring_lapped_during_on_frame :: proc(t: ^testing.T) {
+	for n_slots in 2 ..= 3 {
+		rt: RingTest
+		defer _ring_test_destroy(&rt)
+		if !_ring_test_init(t, &rt, fmt.tprintf("test_lapped_%d", n_slots), n_slots) {
+			return
+		}
+		_publish(t, &rt)
+		_publish(t, &rt)
+		// frame 2 is read while 3 to `2 + n_slots` are published, the last
+		// one into its slot
+		rt.lap = n_slots
+		_deliver_now(&rt)
+		testing.expect(t, slice.equal(rt.frames[:], []u32{2}), fmt.tprintf("n_slots=%d: frames=%v", n_slots, rt.frames))
+		testing.expect_value(t, rt.torn, 1)
+		stats := consistency_stats(&rt.client)
+		testing.expect_value(t, stats.torn, 1)
+		testing.expect_value(t, stats.delivered, 0)
+
+		// 3 is in the slot being written next, i.e. overrun; the rest follow
+		clear(&rt.frames)
+		_deliver_now(&rt)
+		published := []u32{4, 5}
+		expected := published[:n_slots - 1]
+		testing.expect(t, slice.equal(rt.frames[:], expected), fmt.tprintf("n_slots=%d: frames=%v", n_slots, rt.frames))
+		stats = consistency_stats(&rt.client)
+		testing.expect_value(t, stats.overrun, 1)
+		testing.expect_value(t, stats.delivered, u64(n_slots - 1))
+		testing.expect_value(t, stats.torn, 1)
+		testing.expect_value(t, rt.corrupted, 0)
+	}
+}
+
+// a producer started again counts from 1: the cursor, far past its newest
+// frame, starts over at it instead of waiting for the old sequence
+@(test)
+test_ring_producer_restart :: proc(t: ^testing.T) {
+	for n_slots in 2 ..= 3 {
+		rt: RingTest
+		defer _ring_test_destroy(&rt)
+		name := fmt.tprintf("test_restart_%d", n_slots)
+		if !_ring_test_init(t, &rt, name, n_slots) {
+			return
+		}
+		for _ in 0 ..< 10 {
+			_publish(t, &rt)
+			_deliver_now(&rt)
+		}
+		testing.expect_value(t, len(rt.frames), 10)
+		testing.expect_value(t, rt.client._cursor, 11)
+
+		_ring_test_unmap(&rt)
+		producer_destroy(rt.producer)
+		rt.producer = nil
+		err: CvMmapError
+		rt.producer, err = producer_create(name, TEST_INFO, n_slots)
+		if !testing.expect_value(t, err, nil) || !_ring_test_map(t, &rt) {
+			return
+		}
+		clear(&rt.frames)
+		rt.next = 100
+		_publish(t, &rt)
+		_publish(t, &rt)
+		_deliver_now(&rt)
+		testing.expect(t, slice.equal(rt.frames[:], []u32{102}), fmt.tprintf("n_slots=%d: frames=%v", n_slots, rt.frames))
+		testing.expect_value(t, rt.client._cursor, 3)
+
+		stats := consistency_stats(&rt.client)
+		testing.expect_value(t, stats.delivered, 11)
+		testing.expect_value(t, stats.overrun, 0)
+		testing.expect_value(t, stats.torn, 0)
+		testing.expect_value(t, rt.corrupted, 0)
+	}
+}
+
+// a producer started again under the same name creates a new segment: the
+// client notices the old one was unlinked, opens the new one, and counts the
+// frames it missed of the new sequence as overrun
+@(test)
+test_ring_segment_replaced :: proc(t: ^testing.T) {
+	for n_slots in 2 ..= 3 {
+		rt: RingTest
+		defer _ring_test_destroy(&rt)
+		name := fmt.tprintf("test_replaced_%d", n_slots)
+		if !_ring_test_init(t, &rt, name, n_slots) {
+			return
+		}
+		// what `init` would have opened
+		rt.client._shm_name = fmt.tprintf("cvmmap_%s", name)
+		shm_name_c := strings.clone_to_cstring(rt.client._shm_name, context.temp_allocator)
+		fd := posix.shm_open(shm_name_c, {}, {})
+		if !testing.expect(t, fd != -1, "shm_open") {
+			return
+		}
+		rt.client._shm_fd = fd
+		defer {
+			posix.close(rt.client._shm_fd.?)
+			if rt.client._retired_shm != nil {
+				posix.munmap(raw_data(rt.client._retired_shm), len(rt.client._retired_shm))
+			}
+		}
+		for _ in 0 ..< 3 {
+			_publish(t, &rt)
+			_deliver_now(&rt)
+		}
+		testing.expect(t, !_is_replaced(rt.client._shm_fd.?), "replaced before the restart")
+
+		producer_destroy(rt.producer)
+		rt.producer = nil
+		err: CvMmapError
+		rt.producer, err = producer_create(name, TEST_INFO, n_slots)
+		if !testing.expect_value(t, err, nil) {
+			return
+		}
+		testing.expect(t, _is_replaced(rt.client._shm_fd.?), "not replaced after the restart")
+		clear(&rt.frames)
+		rt.next = 100
+		for _ in 0 ..< 5 {
+			_publish(t, &rt)
+		}
+		if !testing.expect_value(t, _remap(&rt.client, true), nil) {
+			return
+		}
+		testing.expect(t, !_is_replaced(rt.client._shm_fd.?), "replaced after reopening")
+		_deliver_now(&rt)
+		published := []u32{104, 105}
+		expected := published[3 - n_slots:]
+		testing.expect(t, slice.equal(rt.frames[:], expected), fmt.tprintf("n_slots=%d: frames=%v", n_slots, rt.frames))
+
+		stats := consistency_stats(&rt.client)
+		testing.expect_value(t, stats.remapped, 1)
+		testing.expect_value(t, stats.overrun, u64(6 - n_slots))
+		testing.expect_value(t, stats.delivered, u64(3 + n_slots - 1))
+		testing.expect_value(t, rt.corrupted, 0)
+	}
+}
@@ -0,0 +1,249 @@
+package reactor
+import zmq "../../lib/odin-zeromq"
+import "base:intrinsics"
+import "core:c"
+import "core:log"
+import "core:sync"
+import "core:sys/posix"
+import "core:thread"
+
+// one thread waiting on any number of ZMQ sockets with `zmq_poll`, instead
+// of a thread per socket blocking in `recv` with a timeout
+//
+// an eventfd is polled along with the sockets, so that `stop` wakes the
+// thread at once. Handlers run on the reactor thread, or with
+// `is_dispatch_to_worker` on a single worker thread, in which case the
+// socket is left out of the poll until its handler returns, so that only
+// the worker touches it meanwhile. The worker runs the handlers one at a
+// time, in the order they became ready: a slow handler delays every socket
+// queued behind it, though none is polled (or read) twice meanwhile.
+//
+// sockets are added and removed while stopped; life cycle:
+// create -> add -> start -> stop -> (remove) -> destroy
+Reactor :: struct {
+	_handlers:              [dynamic]Handler,
+	// of the poll thread: the eventfd and the armed sockets, built before
+	// every poll; `_polled[k]` is the handler of `_items[k + 1]`
+	_items:                 [dynamic]Poll_Item,
+	_polled:                [dynamic]int,
+	_wake_fd:               posix.FD,
+	_is_dispatch_to_worker: bool,
+	_is_running:            bool,
+	_thread:                Maybe(^thread.Thread),
+	// worker dispatch
+	_worker:                Maybe(^thread.Thread),
+	_mutex:                 sync.Mutex,
+	_cond:                  sync.Cond,
+	// indices into `_handlers`, each queued at most once as it is disarmed
+	_queue:                 [dynamic]int,
+}
+
+// called when `socket` has a message; should receive at most what it
+// handles, the reactor calls it again while the socket stays readable
+Handler_Proc :: proc(socket: ^zmq.Socket, user_data: rawptr)
+
+@(private)
+Handler :: struct {
+	socket:    ^zmq.Socket,
+	on_ready:  Handler_Proc,
+	user_data: rawptr,
+	// cleared while queued for the worker
+	is_armed:  bool,
+}
+
+// `zmq_pollitem_t`
+@(private)
+Poll_Item :: struct {
+	socket:  rawptr,
+	fd:      c.int,
+	events:  c.short,
+	revents: c.short,
+}
+
+@(private)
+ZMQ_POLLIN :: 1
+@(private)
+EFD_NONBLOCK :: 0o4000
+@(private)
+EFD_CLOEXEC :: 0o2000000
+
+foreign import libzmq "system:zmq"
+foreign import libc "system:c"
+
+@(private, default_calling_convention = "c")
+foreign libzmq {
+	zmq_poll :: proc(items: [^]Poll_Item, nitems: c.int, timeout: c.long) -> c.int ---
+}
+
+@(private, default_calling_convention = "c")
+foreign libc {
+	eventfd :: proc(initval: c.uint, flags: c.int) -> c.int ---
+}
+
+create :: proc(is_dispatch_to_worker := false) -> ^Reactor {
+	self := new(Reactor)
+	self._wake_fd = posix.FD(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC))
+	assert(self._wake_fd != -1, "eventfd failed")
+	self._is_dispatch_to_worker = is_dispatch_to_worker
+	return self
+}
+
+destroy :: proc(self: ^Reactor) {
+	stop(self)
+	posix.close(self._wake_fd)
+	delete(self._items)
+	delete(self._polled)
+	delete(self._handlers)
+	delete(self._queue)
+	free(self)
+}
+
+// poll `socket` once started; the socket stays owned by the caller, and must
+// outlive `stop`
+add :: proc(self: ^Reactor, socket: ^zmq.Socket, on_ready: Handler_Proc, user_data: rawptr) {
+	assert(!self._is_running, "sockets are added while the reactor is stopped")
+	append(&self._handlers, Handler{socket, on_ready, user_data, true})
+}
+
+// stop polling `socket`, while stopped
+remove :: proc(self: ^Reactor, socket: ^zmq.Socket) {
+	assert(!self._is_running, "sockets are removed while the reactor is stopped")
+	for handler, i in self._handlers {
+		if handler.socket == socket {
+			ordered_remove(&self._handlers, i)
+			return
+		}
+	}
+}
+
+is_running :: proc(self: ^Reactor) -> bool {
+	return intrinsics.atomic_load(&self._is_running)
+}
+
+@(private)
+_wake :: proc(self: ^Reactor) {
+	one: u64 = 1
+	posix.write(self._wake_fd, &one, size_of(one))
+}
+
+@(private)
+_drain_wake :: proc(self: ^Reactor) {
+	count: u64
+	posix.read(self._wake_fd, &count, size_of(count))
+}
+
+@(private)
+_poll_task :: proc(t: ^thread.Thread) {
+	self := cast(^Reactor)t.data
+	for intrinsics.atomic_load(&self._is_running) {
+		// a socket queued for the worker is left out rather than polled with
+		// no events, as `zmq_poll` reads `ZMQ_EVENTS` of every socket given,
+		// which must not race with the `recv` of the worker
+		clear(&self._items)
+		clear(&self._polled)
+		append(&self._items, Poll_Item{nil, c.int(self._wake_fd), ZMQ_POLLIN, 0})
+		for &handler, i in self._handlers {
+			if intrinsics.atomic_load(&handler.is_armed) {
+				append(&self._items, Poll_Item{cast(rawptr)handler.socket, 0, ZMQ_POLLIN, 0})
+				append(&self._polled, i)
+			}
+		}
+		n := zmq_poll(raw_data(self._items), c.int(len(self._items)), -1)
+		if n < 0 {
+			errno := posix.get_errno()
+			if errno == .EINTR {
+				continue
+			}
+			log.errorf("zmq_poll failed; errno={}", errno)
+			break
+		}
+		if self._items[0].revents & ZMQ_POLLIN != 0 {
+			_drain_wake(self)
+		}
+		for i, k in self._polled {
+			if self._items[k + 1].revents & ZMQ_POLLIN == 0 {
+				continue
+			}
+			handler := &self._handlers[i]
+			if !self._is_dispatch_to_worker {
+				handler.on_ready(handler.socket, handler.user_data)
+				continue
+			}
+			intrinsics.atomic_store(&handler.is_armed, false)
+			if sync.mutex_guard(&self._mutex) {
+				append(&self._queue, i)
+			}
+			sync.cond_signal(&self._cond)
+		}
+	}
+}
+
+@(private)
+_worker_task :: proc(t: ^thread.Thread) {
+	self := cast(^Reactor)t.data
+	for {
+		index := -1
+		if sync.mutex_guard(&self._mutex) {
+			for len(self._queue) == 0 && intrinsics.atomic_load(&self._is_running) {
+				sync.cond_wait(&self._cond, &self._mutex)
+			}
+			if len(self._queue) == 0 {
+				return
+			}
+			index = pop_front(&self._queue)
+		}
+		handler := &self._handlers[index]
+		handler.on_ready(handler.socket, handler.user_data)
+		// poll it again
+		intrinsics.atomic_store(&handler.is_armed, true)
+		_wake(self)
+	}
+}
+
+start :: proc(self: ^Reactor, init_context := context) {
+	if self._is_running {
+		return
+	}
+	for &handler in self._handlers {
+		handler.is_armed = true
+	}
+	clear(&self._queue)
+	self._is_running = true
+	if self._is_dispatch_to_worker {
+		worker := thread.create(_worker_task)
+		worker.data = self
+		worker.init_context = init_context
+		thread.start(worker)
+		self._worker = worker
+	}
+	task := thread.create(_poll_task)
+	task.data = self
+	task.init_context = init_context
+	thread.start(task)
+	self._thread = task
+}
+
+// returns once the threads are gone, without waiting for a timeout; a
+// handler running meanwhile is finished first
+stop :: proc(self: ^Reactor) {
+	if !intrinsics.atomic_load(&self._is_running) {
+		return
+	}
+	intrinsics.atomic_store(&self._is_running, false)
+	_wake(self)
+	if task, ok := self._thread.?; ok {
+		thread.join(task)
+		thread.destroy(task)
+		self._thread = nil
+	}
+	if worker, ok := self._worker.?; ok {
+		if sync.mutex_guard(&self._mutex) {
+			// pending handlers are dropped
+			clear(&self._queue)
+		}
+		sync.cond_broadcast(&self._cond)
+		thread.join(worker)
+		thread.destroy(worker)
+		self._worker = nil
+	}
+}
@@ -0,0 +1,611 @@
+package record
+import "../cvmmap"
+import "core:c"
+import "core:log"
+import "core:mem"
+import "core:slice"
+import "core:strings"
+import "core:sync"
+import "core:sys/linux"
+import "core:sys/posix"
+import "core:thread"
+
+// what a client received, i.e. frames and pose messages in the order they
+// arrived, appended to one file and read back through a mapping of it
+//
+// file layout, native endian (as the structs below):
+// - `FileHeader`, padded to `HEADER_SIZE`; rewritten by `recorder_close`
+// - the records, each a `RecordHeader` followed by its payload, 8 byte
+//   aligned, up to `FileHeader.data_end`
+// - an `IndexEntry` per record from `FileHeader.index_offset`, 0 for a
+//   recording cut short, whose records are found by scanning instead
+//
+// a frame turns out torn only after `on_frame` copied it; `retract_frame`
+// then appends a `.Torn` record, and the reader leaves out both.
+//
+// records are copied into chunks of `chunk_size`, which a writer thread
+// appends with `O_DIRECT`: sequential, aligned and past the page cache, as
+// nothing reads them back while recording. File systems refusing it (e.g.
+// tmpfs) get plain writes. A full disk or a slow one stalls `append_*` once
+// every chunk is queued, see `RecorderStats.stalled_ns`.
+MAGIC :: "CV-REC"
+// 2 adds `.Torn`; version 1 files are read as well
+VERSION :: 2
+HEADER_SIZE :: 4096
+// `O_DIRECT` offsets, sizes and buffers are multiples of the logical block
+// size of the device, which a page covers
+ALIGNMENT :: 4096
+RECORD_ALIGNMENT :: 8
+DEFAULT_CHUNK_SIZE :: 8 * 1024 * 1024
+DEFAULT_N_CHUNKS :: 4
+
+FileHeader :: struct {
+	// `MAGIC`, zero padded
+	magic:        [8]u8,
+	version:      u32,
+	_reserved:    u32,
+	// the end of the last record
+	data_end:     u64,
+	// 0 until the recording is closed
+	index_offset: u64,
+	n_records:    u64,
+}
+
+RecordKind :: enum u32 {
+	None  = 0,
+	// the image as delivered to `on_frame`
+	Frame = 1,
+	// a pose message as received, in either wire version
+	Pose  = 2,
+	// the last frame recorded with this frame index was torn; no payload
+	Torn  = 3,
+}
+
+RecordHeader :: struct {
+	kind:        RecordKind,
+	// of the payload
+	size:        u32,
+	// `cvmmap.now_ns` when received
+	received_ns: u64,
+	// only the frame index for a pose message; of the torn frame for `.Torn`
+	metadata:    cvmmap.FrameMetadata,
+}
+
+IndexEntry :: struct {
+	// of the `RecordHeader`, from the start of the file
+	offset:      u64,
+	received_ns: u64,
+	frame_index: u32,
+	kind:        RecordKind,
+}
+
+Error :: union {
+	IoError,
+	FormatError,
+}
+
+IoError :: struct {
+	errno: int,
+	what:  string,
+}
+
+FormatError :: enum {
+	BadMagic,
+	UnsupportedVersion,
+	Truncated,
+}
+
+RecorderStats :: struct {
+	frames:     u64,
+	poses:      u64,
+	// frames retracted again, see `retract_frame`
+	torn:       u64,
+	// appended so far, headers included
+	bytes:      u64,
+	// waiting for a free chunk, i.e. the disk being slower than the stream
+	stalled_ns: u64,
+	is_direct:  bool,
+}
+
+@(private)
+Chunk :: struct {
+	data: []u8,
+	len:  int,
+}
+
+// appends from any thread; create -> append_* -> recorder_close
+Recorder :: struct {
+	_fd:           posix.FD,
+	_is_direct:    bool,
+	_chunks:       []Chunk,
+	// appending
+	_append_mutex: sync.Mutex,
+	// the chunk being filled, -1 if none
+	_current:      int,
+	// where the next record starts in the file
+	_end:          u64,
+	_index:        [dynamic]IndexEntry,
+	_stats:        RecorderStats,
+	// the writer
+	_mutex:        sync.Mutex,
+	_cond:         sync.Cond,
+	_free:         [dynamic]int,
+	// full chunks, in file order
+	_queue:        [dynamic]int,
+	_is_running:   bool,
+	_thread:       Maybe(^thread.Thread),
+	// the file offset of the next chunk, only touched by the writer thread
+	_written:      u64,
+	// the first failed write; appending fails from then on
+	_error:        Error,
+}
+
+@(private)
+_round_up :: proc(n: int, to: int) -> int {
+	return (n + to - 1) / to * to
+}
+
+@(private)
+_file_header :: proc(data_end: u64, index_offset: u64, n_records: u64) -> FileHeader {
+	header := FileHeader {
+		version      = VERSION,
+		data_end     = data_end,
+		index_offset = index_offset,
+		n_records    = n_records,
+	}
+	copy(header.magic[:], MAGIC)
+	return header
+}
+
+// truncates `path`; `chunk_size` is a multiple of `ALIGNMENT`
+recorder_create :: proc(
+	path: string,
+	chunk_size := DEFAULT_CHUNK_SIZE,
+	n_chunks := DEFAULT_N_CHUNKS,
+	init_context := context,
+) -> (
+	self: ^Recorder,
+	err: Error,
+) {
+	assert(chunk_size >= HEADER_SIZE && chunk_size % ALIGNMENT == 0, "chunk_size must be a multiple of ALIGNMENT")
+	assert(n_chunks >= 2, "n_chunks must be at least 2")
+	path_c := strings.clone_to_cstring(path)
+	defer delete(path_c)
+	mode := transmute(linux.Mode)u32(0o644)
+	flags: linux.Open_Flags = {.WRONLY, .CREAT, .TRUNC, .CLOEXEC}
+	fd, errno := linux.open(path_c, flags + {.DIRECT}, mode)
+	is_direct := errno == .NONE
+	if errno == .EINVAL {
+		fd, errno = linux.open(path_c, flags, mode)
+	}
+	if errno != .NONE {
+		return nil, IoError{int(errno), "open"}
+	}
+	self = new(Recorder)
+	self._fd = posix.FD(fd)
+	self._is_direct = is_direct
+	self._stats.is_direct = is_direct
+	self._chunks = make([]Chunk, n_chunks)
+	for &chunk, i in self._chunks {
+		data, alloc_err := mem.alloc_bytes(chunk_size, ALIGNMENT)
+		assert(alloc_err == nil, "failed to allocate a recording chunk")
+		chunk.data = data
+		append(&self._free, i)
+	}
+	self._index = make([dynamic]IndexEntry, 0, 1 << 16)
+	// a header without an index until `recorder_close`, which is what a
+	// recording cut short is left with
+	self._current = pop(&self._free)
+	first := &self._chunks[self._current]
+	header := _file_header(0, 0, 0)
+	mem.copy(raw_data(first.data), &header, size_of(header))
+	first.len = HEADER_SIZE
+	self._end = HEADER_SIZE
+
+	self._is_running = true
+	writer := thread.create(_writer_task)
+	writer.data = self
+	writer.init_context = init_context
+	thread.start(writer)
+	self._thread = writer
+	log.infof("recording to %s (O_DIRECT: %v)", path, is_direct)
+	return self, nil
+}
+
+@(private)
+_write_at :: proc(self: ^Recorder, data: []u8, offset: u64) -> Error {
+	rest := data
+	at := offset
+	for len(rest) > 0 {
+		n := posix.pwrite(self._fd, raw_data(rest), c.size_t(len(rest)), posix.off_t(at))
+		if n < 0 {
+			errno := posix.get_errno()
+			if errno == .EINTR {
+				continue
+			}
+			return IoError{int(errno), "pwrite"}
+		}
+		rest = rest[n:]
+		at += u64(n)
+	}
+	return nil
+}
+
+@(private)
+_writer_task :: proc(t: ^thread.Thread) {
+	self := cast(^Recorder)t.data
+	for {
+		index := -1
+		if sync.mutex_guard(&self._mutex) {
+			for len(self._queue) == 0 && self._is_running {
+				sync.cond_wait(&self._cond, &self._mutex)
+			}
+			if len(self._queue) == 0 {
+				return
+			}
+			index = pop_front(&self._queue)
+		}
+		chunk := &self._chunks[index]
+		err := _write_at(self, chunk.data[:chunk.len], self._written)
+		self._written += u64(chunk.len)
+		if sync.mutex_guard(&self._mutex) {
+			if err != nil && self._error == nil {
+				log.errorf("recording failed: %v", err)
+				self._error = err
+			}
+			chunk.len = 0
+			append(&self._free, index)
+		}
+		sync.cond_broadcast(&self._cond)
+	}
+}
+
+// a free chunk, waiting for the writer if there is none
+@(private)
+_take_chunk :: proc(self: ^Recorder) -> (index: int) {
+	if sync.mutex_guard(&self._mutex) {
+		if len(self._free) == 0 {
+			start := cvmmap.now_ns()
+			for len(self._free) == 0 {
+				sync.cond_wait(&self._cond, &self._mutex)
+			}
+			self._stats.stalled_ns += cvmmap.now_ns() - start
+		}
+		index = pop(&self._free)
+	}
+	return
+}
+
+@(private)
+_submit :: proc(self: ^Recorder, index: int) {
+	if sync.mutex_guard(&self._mutex) {
+		append(&self._queue, index)
+	}
+	sync.cond_broadcast(&self._cond)
+}
+
+@(private)
+_put :: proc(self: ^Recorder, data: []u8) {
+	rest := data
+	for len(rest) > 0 {
+		if self._current == -1 {
+			self._current = _take_chunk(self)
+		}
+		chunk := &self._chunks[self._current]
+		n := copy(chunk.data[chunk.len:], rest)
+		chunk.len += n
+		rest = rest[n:]
+		self._end += u64(n)
+		if chunk.len == len(chunk.data) {
+			_submit(self, self._current)
+			self._current = -1
+		}
+	}
+}
+
+@(private)
+_append :: proc(self: ^Recorder, header: RecordHeader, payload: []u8) -> (err: Error) {
+	if sync.mutex_guard(&self._mutex) {
+		err = self._error
+	}
+	if err != nil {
+		return
+	}
+	if sync.mutex_guard(&self._append_mutex) {
+		header := header
+		append(&self._index, IndexEntry{self._end, header.received_ns, header.metadata.frame_index, header.kind})
+		_put(self, mem.ptr_to_bytes(&header))
+		_put(self, payload)
+		size := size_of(RecordHeader) + len(payload)
+		zeros: [RECORD_ALIGNMENT]u8
+		_put(self, zeros[:_round_up(size, RECORD_ALIGNMENT) - size])
+		self._stats.bytes += u64(size)
+		switch header.kind {
+		case .Frame:
+			self._stats.frames += 1
+		case .Pose:
+			self._stats.poses += 1
+		case .Torn:
+			self._stats.torn += 1
+		case .None:
+		}
+	}
+	return
+}
+
+// `metadata` and the image of a frame, as delivered to `on_frame`; copied
+append_frame :: proc(self: ^Recorder, metadata: cvmmap.FrameMetadata, image: []u8) -> Error {
+	return _append(self, RecordHeader{.Frame, u32(len(image)), cvmmap.now_ns(), metadata}, image)
+}
+
+// the frame of `metadata` appended last was torn, i.e. `on_torn` followed its
+// `on_frame`: it is left out when read back
+retract_frame :: proc(self: ^Recorder, metadata: cvmmap.FrameMetadata) -> Error {
+	return _append(self, RecordHeader{.Torn, 0, cvmmap.now_ns(), metadata}, nil)
+}
+
+// a pose message as received, for frame `frame_index`; copied
+append_pose :: proc(self: ^Recorder, frame_index: u32, message: []u8) -> Error {
+	metadata := cvmmap.FrameMetadata {
+		frame_index = frame_index,
+	}
+	return _append(self, RecordHeader{.Pose, u32(len(message)), cvmmap.now_ns(), metadata}, message)
+}
+
+// from any thread
+recorder_stats :: proc(self: ^Recorder) -> (stats: RecorderStats) {
+	if sync.mutex_guard(&self._append_mutex) {
+		stats = self._stats
+	}
+	return
+}
+
+@(private)
+_stop_writer :: proc(self: ^Recorder) {
+	if sync.mutex_guard(&self._mutex) {
+		self._is_running = false
+	}
+	sync.cond_broadcast(&self._cond)
+	if writer, ok := self._thread.?; ok {
+		// the queue is written out first
+		thread.join(writer)
+		thread.destroy(writer)
+		self._thread = nil
+	}
+}
+
+// flush the chunks, then write the index and the final header; nothing may
+// be appended meanwhile. The recorder is freed either way.
+recorder_close :: proc(self: ^Recorder) -> (err: Error) {
+	defer _recorder_free(self)
+	data_end := self._end
+	// the last chunk, zero padded to what `O_DIRECT` takes
+	if self._current != -1 {
+		chunk := &self._chunks[self._current]
+		padded := _round_up(chunk.len, ALIGNMENT)
+		mem.zero_slice(chunk.data[chunk.len:padded])
+		chunk.len = padded
+		_submit(self, self._current)
+		self._current = -1
+	}
+	_stop_writer(self)
+	if self._error != nil {
+		return self._error
+	}
+	// i.e. `data_end` rounded up
+	index_offset := self._written
+	index_bytes := slice.to_bytes(self._index[:])
+	buffer := self._chunks[0].data
+	at := index_offset
+	rest := index_bytes
+	for len(rest) > 0 {
+		n := copy(buffer, rest)
+		padded := _round_up(n, ALIGNMENT)
+		mem.zero_slice(buffer[n:padded])
+		_write_at(self, buffer[:padded], at) or_return
+		rest = rest[n:]
+		at += u64(padded)
+	}
+	header := _file_header(data_end, index_offset, u64(len(self._index)))
+	mem.zero_slice(buffer[:HEADER_SIZE])
+	mem.copy(raw_data(buffer), &header, size_of(header))
+	_write_at(self, buffer[:HEADER_SIZE], 0) or_return
+	// without the padding of the index
+	if posix.ftruncate(self._fd, posix.off_t(index_offset + u64(len(index_bytes)))) != .OK {
+		return IoError{cast(int)posix.get_errno(), "ftruncate"}
+	}
+	if posix.fsync(self._fd) != .OK {
+		return IoError{cast(int)posix.get_errno(), "fsync"}
+	}
+	log.infof("recorded %d records, %d bytes", len(self._index), index_offset + u64(len(index_bytes)))
+	return nil
+}
+
+@(private)
+_recorder_free :: proc(self: ^Recorder) {
+	_stop_writer(self)
+	posix.close(self._fd)
+	for chunk in self._chunks {
+		mem.free_bytes(chunk.data)
+	}
+	delete(self._chunks)
+	delete(self._index)
+	delete(self._free)
+	delete(self._queue)
+	free(self)
+}
+
+// a recording mapped read only; records are read in place
+Reader :: struct {
+	header:   FileHeader,
+	// every record, in the order received; see `reader_is_torn` for frames
+	index:    []IndexEntry,
+	_data:    []u8,
+	// the index found by scanning, for a recording cut short
+	_scanned: [dynamic]IndexEntry,
+	// the frames by frame index, for `reader_find_frame`, without torn ones
+	_frames:  []FrameKey,
+	// by position in `index`: a frame retracted by a later `.Torn` record
+	_is_torn: []bool,
+}
+
+@(private)
+FrameKey :: struct {
+	frame_index: u32,
+	position:    int,
+}
+
+Record :: struct {
+	kind:        RecordKind,
+	received_ns: u64,
+	metadata:    cvmmap.FrameMetadata,
+	// into the mapping
+	payload:     []u8,
+}
+
+reader_open :: proc(path: string) -> (self: ^Reader, err: Error) {
+	path_c := strings.clone_to_cstring(path)
+	defer delete(path_c)
+	fd := posix.open(path_c, {.CLOEXEC})
+	if fd == -1 {
+		return nil, IoError{cast(int)posix.get_errno(), "open"}
+	}
+	// the mapping stays valid without it
+	defer posix.close(fd)
+	stat: posix.stat_t
+	if posix.fstat(fd, &stat) != .OK {
+		return nil, IoError{cast(int)posix.get_errno(), "fstat"}
+	}
+	size := int(stat.st_size)
+	if size < HEADER_SIZE {
+		return nil, FormatError.Truncated
+	}
+	ptr, errno := linux.mmap(0, uint(size), {.READ}, {.SHARED}, linux.Fd(fd), 0)
+	if errno != .NONE {
+		return nil, IoError{int(errno), "mmap"}
+	}
+	data := (cast([^]u8)ptr)[:size]
+	header: FileHeader
+	mem.copy(&header, raw_data(data), size_of(header))
+	if string(header.magic[:len(MAGIC)]) != MAGIC {
+		posix.munmap(ptr, c.size_t(size))
+		return nil, FormatError.BadMagic
+	}
+	if header.version < 1 || header.version > VERSION {
+		posix.munmap(ptr, c.size_t(size))
+		return nil, FormatError.UnsupportedVersion
+	}
+	self = new(Reader)
+	self.header = header
+	self._data = data
+	index_size := header.n_records * size_of(IndexEntry)
+	if header.index_offset != 0 && header.index_offset + index_size <= u64(size) {
+		// page aligned
+		self.index = (cast([^]IndexEntry)raw_data(data[header.index_offset:]))[:header.n_records]
+	} else {
+		_scan(self)
+		log.warnf("%s has no index; %d records found by scanning", path, len(self._scanned))
+		self.index = self._scanned[:]
+	}
+
+	// the frame a `.Torn` record retracts was appended shortly before it
+	self._is_torn = make([]bool, len(self.index))
+	for entry, i in self.index {
+		if entry.kind != .Torn {
+			continue
+		}
+		for j := i - 1; j >= 0; j -= 1 {
+			if self.index[j].kind == .Frame && self.index[j].frame_index == entry.frame_index {
+				self._is_torn[j] = true
+				break
+			}
+		}
+	}
+	n_frames := 0
+	for entry, i in self.index {
+		if entry.kind == .Frame && !self._is_torn[i] {
+			n_frames += 1
+		}
+	}
+	self._frames = make([]FrameKey, n_frames)
+	n_frames = 0
+	for entry, i in self.index {
+		if entry.kind == .Frame && !self._is_torn[i] {
+			self._frames[n_frames] = FrameKey{entry.frame_index, i}
+			n_frames += 1
+		}
+	}
+	// in the order recorded for the same frame index
+	slice.sort_by(self._frames, proc(a, b: FrameKey) -> bool {
+		if a.frame_index != b.frame_index {
+			return a.frame_index < b.frame_index
+		}
+		return a.position < b.position
+	})
+	return self, nil
+}
+
+// every complete record from the start, up to the first one that is not
+@(private)
+_scan :: proc(self: ^Reader) {
+	offset := HEADER_SIZE
+	for offset + size_of(RecordHeader) <= len(self._data) {
+		header: RecordHeader
+		mem.copy(&header, raw_data(self._data[offset:]), size_of(header))
+		if header.kind != .Frame && header.kind != .Pose && header.kind != .Torn {
+			break
+		}
+		end := offset + size_of(RecordHeader) + int(header.size)
+		if end > len(self._data) {
+			break
+		}
+		append(&self._scanned, IndexEntry{u64(offset), header.received_ns, header.metadata.frame_index, header.kind})
+		offset = _round_up(end, RECORD_ALIGNMENT)
+	}
+}
+
+reader_close :: proc(self: ^Reader) {
+	posix.munmap(raw_data(self._data), c.size_t(len(self._data)))
+	delete(self._scanned)
+	delete(self._frames)
+	delete(self._is_torn)
+	free(self)
+}
+
+// record `position` of `index`
+reader_record :: proc(self: ^Reader, position: int) -> Record {
+	entry := self.index[position]
+	header: RecordHeader
+	mem.copy(&header, raw_data(self._data[entry.offset:]), size_of(header))
+	start := int(entry.offset) + size_of(RecordHeader)
+	return Record{header.kind, header.received_ns, header.metadata, self._data[start:][:header.size]}
+}
+
+// whether record `position` is a frame retracted by `retract_frame`, which
+// should be skipped like the `.Torn` record itself
+reader_is_torn :: proc(self: ^Reader, position: int) -> bool {
+	return self._is_torn[position]
+}
+
+// the position in `index` of frame `frame_index`, never a torn one; the
+// first one recorded if the producer restarted meanwhile
+reader_find_frame :: proc(self: ^Reader, frame_index: u32) -> (position: int, ok: bool) {
+	lo, hi := 0, len(self._frames)
+	for lo < hi {
+		mid := (lo + hi) / 2
+		if self._frames[mid].frame_index < frame_index {
+			lo = mid + 1
+		} else {
+			hi = mid
+		}
+	}
+	if lo == len(self._frames) || self._frames[lo].frame_index != frame_index {
+		return -1, false
+	}
+	return self._frames[lo].position, true
+}
+
+// frames in the recording, without torn ones
+reader_frame_count :: proc(self: ^Reader) -> int {
+	return len(self._frames)
+}
@@ -14,6 +14,106 @@ foreign auximg {
 	put_text_impl :: proc(mat: SharedMat, text: cstring, pos: Vec2i, color: Vec3d, scale: c.double, thickness: c.int, bottomLeftOrigin: bool) ---
 	rectangle_impl :: proc(mat: SharedMat, pt1: Vec2i, pt2: Vec2i, color: Vec3d, thickness: c.int) ---
 	draw_whole_body_skeleton_impl :: proc(mat: SharedMat, data: [^]c.float, options: DrawSkeletonOptions) ---
+	draw_poses_batch_impl :: proc(mat: SharedMat, keypoints: [^]c.float, n_people: c.size_t, boxes: [^]u16, n_boxes: c.size_t, options: DrawPosesOptions, stats: ^CullStats) ---
+	// enabled by default; disable to always draw with OpenCV
+	set_fast_raster :: proc(enabled: bool) ---
+	// `n_threads > 1` draws in horizontal bands on a pool owned by the library;
+	// `n_threads <= 1` draws on the caller's thread (default)
+	set_num_threads :: proc(n_threads: c.int) ---
+	get_num_threads :: proc() -> c.int ---
+	// strings kept rendered by `put_text` (256 by default); 0 keeps glyphs only
+	set_text_cache_capacity :: proc(capacity: c.size_t) ---
+	// row step of a `CompositeTarget`, padded to 4 bytes if `is_row_aligned`
+	composite_step :: proc(cols: u16, format: OutputFormat, is_row_aligned: bool) -> c.size_t ---
+	composite_poses_impl :: proc(src: SharedMat, dst: CompositeTarget, keypoints: [^]c.float, n_people: c.size_t, boxes: [^]u16, n_boxes: c.size_t, options: DrawPosesOptions, stats: ^CullStats) ---
+	// `composite_poses_impl` at the size of `dst`, with the poses scaled
+	// along; radii and thicknesses are in preview pixels
+	preview_poses :: proc(src: SharedMat, dst: PreviewTarget, keypoints: [^]c.float, n_people: c.size_t, boxes: [^]u16, n_boxes: c.size_t, options: DrawPosesOptions, stats: ^CullStats) -> Status ---
+	// from frame to preview coordinates
+	preview_scale :: proc(src: SharedMat, dst: PreviewTarget) -> Vec2f ---
+	// geometry-only counterparts of the drawing procedures; append to `out`,
+	// or return false (appending nothing) if it is full
+	export_whole_body_skeleton :: proc(data: [^]c.float, options: DrawSkeletonOptions, out: ^GeometryBuffer) -> bool ---
+	export_rectangle :: proc(start: Vec2i, end: Vec2i, color: Vec3d, thickness: c.int, out: ^GeometryBuffer) -> bool ---
+	export_poses_batch :: proc(keypoints: [^]c.float, n_people: c.size_t, boxes: [^]u16, n_boxes: c.size_t, options: DrawPosesOptions, out: ^GeometryBuffer) -> bool ---
+	// rasterize an exported buffer into `mat`, for validation on the CPU
+	rasterize_geometry :: proc(mat: SharedMat, geometry: ^GeometryBuffer) ---
+	// nothing throws through the procedures above; the ones taking a
+	// `SharedMat` only report failures here (thread local, "" if none)
+	last_error :: proc() -> cstring ---
+	status_to_string :: proc(status: Status) -> cstring ---
+	// validate `mat` once; draw through the canvas on the hot path
+	canvas_create :: proc(mat: SharedMat, out: ^Canvas) -> Status ---
+	canvas_destroy :: proc(canvas: Canvas) ---
+	// the next frame, of the same shape and format
+	canvas_set_data :: proc(canvas: Canvas, data: rawptr) -> Status ---
+	canvas_put_text :: proc(canvas: Canvas, text: cstring, pos: Vec2i, color: Vec3d, scale: c.double, thickness: c.int, bottomLeftOrigin: bool) -> Status ---
+	canvas_rectangle :: proc(canvas: Canvas, pt1: Vec2i, pt2: Vec2i, color: Vec3d, thickness: c.int) -> Status ---
+	canvas_draw_whole_body_skeleton :: proc(canvas: Canvas, data: [^]c.float, options: DrawSkeletonOptions) -> Status ---
+	canvas_draw_poses_batch :: proc(canvas: Canvas, keypoints: [^]c.float, n_people: c.size_t, boxes: [^]u16, n_boxes: c.size_t, options: DrawPosesOptions, stats: ^CullStats) -> Status ---
+	// draw commands recorded into arenas owned by the list (copied), drawn
+	// by `canvas_execute` any number of times; `cmdlist_clear` keeps the memory
+	cmdlist_create :: proc(out: ^CommandList) -> Status ---
+	cmdlist_destroy :: proc(list: CommandList) ---
+	cmdlist_clear :: proc(list: CommandList) ---
+	cmdlist_size :: proc(list: CommandList) -> c.size_t ---
+	cmdlist_reserve :: proc(list: CommandList, n_commands: c.size_t, n_people: c.size_t, n_text_bytes: c.size_t) -> Status ---
+	cmdlist_skeleton :: proc(list: CommandList, data: [^]c.float, options: DrawSkeletonOptions) -> Status ---
+	cmdlist_poses_batch :: proc(list: CommandList, keypoints: [^]c.float, n_people: c.size_t, boxes: [^]u16, n_boxes: c.size_t, options: DrawPosesOptions) -> Status ---
+	cmdlist_rectangle :: proc(list: CommandList, pt1: Vec2i, pt2: Vec2i, color: Vec3d, thickness: c.int) -> Status ---
+	cmdlist_line :: proc(list: CommandList, pt1: Vec2i, pt2: Vec2i, color: Vec3d, thickness: c.int) -> Status ---
+	cmdlist_circle :: proc(list: CommandList, center: Vec2i, radius: c.int, color: Vec3d, thickness: c.int) -> Status ---
+	cmdlist_put_text :: proc(list: CommandList, text: cstring, pos: Vec2i, color: Vec3d, scale: c.double, thickness: c.int) -> Status ---
+	// skeletons first, then the other commands in recording order
+	canvas_execute :: proc(canvas: Canvas, list: CommandList, stats: ^CullStats) -> Status ---
+	// a ring of the last `capacity` pose snapshots of up to `max_people`
+	// each, allocated once; not thread safe
+	history_create :: proc(capacity: c.size_t, max_people: c.size_t, layout: Layout, out: ^PoseHistory) -> Status ---
+	history_destroy :: proc(history: PoseHistory) ---
+	history_clear :: proc(history: PoseHistory) ---
+	history_push :: proc(history: PoseHistory, frame_index: u32, keypoints: [^]c.float, n_people: c.size_t, boxes: [^]u16, n_boxes: c.size_t) -> Status ---
+	// interpolated between snapshots, or extrapolated up to
+	// `max_extrapolation` frames past the newest; `keypoints`/`boxes` must
+	// have room for `max_people`
+	history_sample :: proc(history: PoseHistory, frame_index: u32, max_extrapolation: u32, keypoints: [^]c.float, boxes: [^]u16, out: ^PoseSample) -> Status ---
+	// point `out` into a received pose message without copying it; valid
+	// while `data` is
+	pose_view_parse :: proc(data: [^]u8, size: c.size_t, out: ^PoseView) -> Status ---
+	// every skeleton and box of a view, in either wire version;
+	// `confidences` may be nil
+	pose_view_decode :: proc(view: ^PoseView, keypoints: [^]c.float, boxes: [^]u16, confidences: [^]c.float) -> Status ---
+	// a v2 pose message, see `PoseView`; `confidences` may be nil
+	pose_encoded_size :: proc(n_people: c.size_t, n_boxes: c.size_t) -> c.size_t ---
+	pose_encode :: proc(frame_index: u32, keypoints: [^]c.float, confidences: [^]c.float, n_people: c.size_t, boxes: [^]u16, n_boxes: c.size_t, out: [^]u8, capacity: c.size_t, size: ^c.size_t) -> Status ---
+	canvas_draw_pose_view :: proc(canvas: Canvas, view: ^PoseView, options: DrawPosesOptions, stats: ^CullStats) -> Status ---
+	composite_pose_view :: proc(src: SharedMat, dst: CompositeTarget, view: ^PoseView, options: DrawPosesOptions, stats: ^CullStats) -> Status ---
+	history_push_view :: proc(history: PoseHistory, view: ^PoseView) -> Status ---
+	// the newest poses from one writer thread to one reader thread, without
+	// locks or allocation; a read is valid until the next one
+	pose_buffer_create :: proc(max_people: c.size_t, out: ^PoseBuffer) -> Status ---
+	pose_buffer_destroy :: proc(buffer: PoseBuffer) ---
+	pose_buffer_write :: proc(buffer: PoseBuffer, frame_index: u32, keypoints: [^]c.float, n_people: c.size_t, boxes: [^]u16, n_boxes: c.size_t) -> Status ---
+	pose_buffer_write_view :: proc(buffer: PoseBuffer, view: ^PoseView) -> Status ---
+	pose_buffer_read :: proc(buffer: PoseBuffer, out: ^PoseFrame) -> Status ---
+	pose_buffer_stats :: proc(buffer: PoseBuffer, out: ^PoseBufferStats) ---
+	// `CLOCK_MONOTONIC` in ns, as `cvmmap.now_ns`
+	now_ns :: proc() -> u64 ---
+	// per stage histograms; the library records `Composite` and `Overlay`
+	// itself while enabled (off by default)
+	set_latency_enabled :: proc(enabled: bool) ---
+	latency_record :: proc(stage: Stage, ns: u64) ---
+	latency_add_dropped :: proc(n: u64) ---
+	latency_report :: proc(out: ^LatencyReport) ---
+	latency_reset :: proc() ---
+	// many cameras downsampled into the tiles of one image; `set_frame`
+	// downsamples the frame within the call (from any thread, in stripes on the
+	// pool), so it need not outlive it, and `compose` converts the tiles with a
+	// newer one on the pool
+	mosaic_create :: proc(layout: MosaicLayout, out: ^Mosaic) -> Status ---
+	mosaic_destroy :: proc(mosaic: Mosaic) ---
+	mosaic_set_frame :: proc(mosaic: Mosaic, index: c.size_t, frame: SharedMat) -> Status ---
+	mosaic_compose :: proc(mosaic: Mosaic, n_updated: ^c.size_t) -> Status ---
+	mosaic_image :: proc(mosaic: Mosaic) -> CompositeTarget ---
 }
 
 NUM_KEYPOINTS :: 133
@@ -28,6 +128,118 @@ draw_whole_body_skeleton :: #force_inline proc(
 	draw_whole_body_skeleton_impl(mat, raw_data(keypoints), options)
 }
 
+// draw all skeletons and bounding boxes in a single foreign call
+//
+// `keypoints` and `boxes` are passed as-is, i.e. the backing arrays of
+// `[dynamic]Skeleton` and `[dynamic]BoundingBox` could be used directly
+draw_poses_batch :: #force_inline proc(
+	mat: SharedMat,
+	keypoints: [][NUM_KEYPOINTS_PAIR]f32,
+	boxes: [][4]u16,
+	options: DrawPosesOptions,
+) -> (
+	stats: CullStats,
+) {
+	draw_poses_batch_impl(
+		mat,
+		cast([^]c.float)raw_data(keypoints),
+		c.size_t(len(keypoints)),
+		cast([^]u16)raw_data(boxes),
+		c.size_t(len(boxes)),
+		options,
+		&stats,
+	)
+	return stats
+}
+
+// copy `src` into `dst` in the output format and draw the poses on top, in
+// one pass over the frame; bands without overlay bypass the cache
+composite_poses :: #force_inline proc(
+	src: SharedMat,
+	dst: CompositeTarget,
+	keypoints: [][NUM_KEYPOINTS_PAIR]f32,
+	boxes: [][4]u16,
+	options: DrawPosesOptions,
+) -> (
+	stats: CullStats,
+) {
+	composite_poses_impl(
+		src,
+		dst,
+		cast([^]c.float)raw_data(keypoints),
+		c.size_t(len(keypoints)),
+		cast([^]u16)raw_data(boxes),
+		c.size_t(len(boxes)),
+		options,
+		&stats,
+	)
+	return stats
+}
+
+// `composite_poses` into a display sized buffer, e.g. a thumbnail of a 4K
+// frame, which is converted, drawn on and uploaded instead of the frame
+preview_poses_slice :: #force_inline proc(
+	src: SharedMat,
+	dst: PreviewTarget,
+	keypoints: [][NUM_KEYPOINTS_PAIR]f32,
+	boxes: [][4]u16,
+	options: DrawPosesOptions,
+) -> (
+	stats: CullStats,
+	status: Status,
+) {
+	status = preview_poses(
+		src,
+		dst,
+		cast([^]c.float)raw_data(keypoints),
+		c.size_t(len(keypoints)),
+		cast([^]u16)raw_data(boxes),
+		c.size_t(len(boxes)),
+		options,
+		&stats,
+	)
+	return stats, status
+}
+
+// `draw_poses_batch` on a canvas
+canvas_draw_poses :: #force_inline proc(
+	canvas: Canvas,
+	keypoints: [][NUM_KEYPOINTS_PAIR]f32,
+	boxes: [][4]u16,
+	options: DrawPosesOptions,
+) -> (
+	stats: CullStats,
+	status: Status,
+) {
+	status = canvas_draw_poses_batch(
+		canvas,
+		cast([^]c.float)raw_data(keypoints),
+		c.size_t(len(keypoints)),
+		cast([^]u16)raw_data(boxes),
+		c.size_t(len(boxes)),
+		options,
+		&stats,
+	)
+	return stats, status
+}
+
+// record `draw_poses_batch`
+cmdlist_poses :: #force_inline proc(
+	list: CommandList,
+	keypoints: [][NUM_KEYPOINTS_PAIR]f32,
+	boxes: [][4]u16,
+	options: DrawPosesOptions,
+) -> Status {
+	return cmdlist_poses_batch(
+		list,
+		cast([^]c.float)raw_data(keypoints),
+		c.size_t(len(keypoints)),
+		cast([^]u16)raw_data(boxes),
+		c.size_t(len(boxes)),
+		options,
+	)
+}
+
 put_text :: #force_inline proc(
 	mat: SharedMat,
 	text: cstring,
@@ -84,6 +296,8 @@ PixelFormat :: enum u8 {
 	GRAY,
 	YUV,
 	YUYV,
+	NV12,
+	I420,
 }
 
 SharedMat :: struct {
@@ -128,4 +342,202 @@ DrawSkeletonOptions :: struct {
 	landmark_radius:    c.int,
 	landmark_thickness: c.int,
 	bone_thickness:     c.int,
+	// skip the face (hand) subset of a person whose body spans fewer pixels
+	// vertically; 0 always draws it
+	face_min_height:    c.int,
+	hand_min_height:    c.int,
+	// skip non-finite/off-frame landmarks and clip bones to the frame
+	is_cull:            bool,
+}
+
+CullStats :: struct {
+	landmarks_drawn:      u32,
+	landmarks_culled:     u32,
+	bones_drawn:          u32,
+	bones_culled:         u32,
+	people_without_face:  u32,
+	people_without_hands: u32,
+}
+
+DrawPosesOptions :: struct {
+	skeleton:               DrawSkeletonOptions,
+	bounding_box_color:     Vec3d,
+	bounding_box_thickness: c.int,
+}
+
+OutputFormat :: enum u8 {
+	BGR = 0,
+	RGBA,
+	BGRA,
+}
+
+// `step` is the number of bytes between rows, see `composite_step`
+CompositeTarget :: struct {
+	data:   rawptr,
+	step:   c.size_t,
+	format: OutputFormat,
+}
+
+// a display buffer of `cols` x `rows`, see `preview_poses`
+PreviewTarget :: struct {
+	data:   rawptr,
+	step:   c.size_t,
+	rows:   u16,
+	cols:   u16,
+	format: OutputFormat,
+}
+
+Status :: enum i32 {
+	Ok = 0,
+	InvalidArgument,
+	OutOfMemory,
+	OpenCVError,
+	Unknown,
+}
+
+// opaque handle from `canvas_create`, released with `canvas_destroy`
+Canvas :: distinct rawptr
+
+// opaque handle from `cmdlist_create`, released with `cmdlist_destroy`
+CommandList :: distinct rawptr
+
+// opaque handle from `history_create`, released with `history_destroy`
+PoseHistory :: distinct rawptr
+
+// a pose message decoded in place; the arrays point into the message and
+// are unaligned (and quantized for v2), so they are only passed back to the
+// library
+PoseView :: struct {
+	frame_index: u32,
+	n_people:    u32,
+	n_boxes:     u32,
+	version:     u32,
+	keypoints:   [^]u8,
+	boxes:       [^]u8,
+	confidences: [^]u8,
+}
+
+Stage :: enum u32 {
+	// from the producer's timestamp to the client receiving the announcement
+	Receive = 0,
+	// from receiving the announcement to the frame callback running
+	Dispatch,
+	Composite,
+	Overlay,
+	Upload,
+	// from the producer's timestamp to the end of the upload
+	Total,
+}
+
+StageLatency :: struct {
+	count:  u64,
+	p50_ns: u64,
+	p99_ns: u64,
+	max_ns: u64,
+}
+
+LatencyReport :: struct {
+	stages:  [Stage]StageLatency,
+	dropped: u64,
+}
+
+// opaque handle from `pose_buffer_create`, released with `pose_buffer_destroy`
+PoseBuffer :: distinct rawptr
+
+// owned by the `PoseBuffer` it was read from
+PoseFrame :: struct {
+	frame_index: u32,
+	n_people:    u32,
+	n_boxes:     u32,
+	// published since the previous read
+	is_fresh:    bool,
+	keypoints:   [^]c.float,
+	boxes:       [^]u16,
+}
+
+PoseBufferStats :: struct {
+	published:  u64,
+	// published, then replaced before being read
+	dropped:    u64,
+	read_fresh: u64,
+}
+
+SampleKind :: enum u8 {
+	None = 0,
+	Exact,
+	Interpolated,
+	Extrapolated,
+	Held,
+}
+
+PoseSample :: struct {
+	n_people: u32,
+	n_boxes:  u32,
+	kind:     SampleKind,
+}
+
+// `grid_cols` x `grid_rows` tiles of `tile_cols` x `tile_rows` pixels
+MosaicLayout :: struct {
+	grid_cols: u16,
+	grid_rows: u16,
+	tile_cols: u16,
+	tile_rows: u16,
+	format:    OutputFormat,
+}
+
+// opaque handle from `mosaic_create`, released with `mosaic_destroy`
+Mosaic :: distinct rawptr
+
+GeometrySegment :: struct {
+	p0:        Vec2f,
+	p1:        Vec2f,
+	thickness: c.float,
+	color:     [4]u8,
+}
+
+GeometryDisc :: struct {
+	center:    Vec2f,
+	radius:    c.float,
+	// negative for a filled disc
+	thickness: c.float,
+	color:     [4]u8,
+}
+
+GeometryQuad :: struct {
+	p0:        Vec2f,
+	p1:        Vec2f,
+	// negative for a filled quad
+	thickness: c.float,
+	color:     [4]u8,
+}
+
+GeometryBuffer :: struct {
+	segments:          [^]GeometrySegment,
+	segments_capacity: u32,
+	n_segments:        u32,
+	discs:             [^]GeometryDisc,
+	discs_capacity:    u32,
+	n_discs:           u32,
+	quads:             [^]GeometryQuad,
+	quads_capacity:    u32,
+	n_quads:           u32,
+}
+
+// wrap caller owned slices; counters start at zero
+geometry_buffer_from_slices :: proc(
+	segments: []GeometrySegment,
+	discs: []GeometryDisc,
+	quads: []GeometryQuad,
+) -> GeometryBuffer {
+	return GeometryBuffer {
+		raw_data(segments),
+		u32(len(segments)),
+		0,
+		raw_data(discs),
+		u32(len(discs)),
+		0,
+		raw_data(quads),
+		u32(len(quads)),
+		0,
+	}
 }
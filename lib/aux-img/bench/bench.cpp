@@ -0,0 +1,713 @@
+// self-contained microbenchmark for the aux-img drawing API
+//
+//   auximg_bench [--filter <substr>] [--min-time <ms>] [--threads <n>]
+//                [--json <path>] [--verify] [--stress <ms>]
+//
+// every case draws deterministic synthetic keypoints into a frame through the
+// C ABI, and reports ns/frame and ns/person (or ns/call)
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <format>
+#include <functional>
+#include <mutex>
+#include <print>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include <aux.hpp>
+
+namespace {
+using Clock = std::chrono::steady_clock;
+constexpr auto NUM_KEYPOINTS = 133;
+
+struct Resolution {
+	const char *name;
+	uint16_t cols;
+	uint16_t rows;
+};
+
+constexpr Resolution resolutions[] = {
+	{"720p", 1280, 720},
+	{"1080p", 1920, 1080},
+	{"4k", 3840, 2160},
+};
+
+struct Format {
+	aux_img::PixelFormat pixel_format;
+	aux_img::Depth depth;
+	// 4:2:0 formats take 12 bits per pixel
+	size_t bits_per_pixel;
+};
+
+constexpr Format formats[] = {
+	{aux_img::PixelFormat::BGR, aux_img::Depth::U8, 24},
+	{aux_img::PixelFormat::RGB, aux_img::Depth::U8, 24},
+	{aux_img::PixelFormat::BGRA, aux_img::Depth::U8, 32},
+	{aux_img::PixelFormat::GRAY, aux_img::Depth::U8, 8},
+	{aux_img::PixelFormat::BGR, aux_img::Depth::U16, 48},
+	{aux_img::PixelFormat::BGR, aux_img::Depth::F32, 96},
+	{aux_img::PixelFormat::YUV, aux_img::Depth::U8, 24},
+	{aux_img::PixelFormat::YUYV, aux_img::Depth::U8, 16},
+	{aux_img::PixelFormat::NV12, aux_img::Depth::U8, 12},
+	{aux_img::PixelFormat::I420, aux_img::Depth::U8, 12},
+};
+
+constexpr size_t people_counts[] = {1, 4, 16, 64};
+
+struct Toggle {
+	const char *name;
+	bool is_draw_landmarks;
+	bool is_draw_bones;
+	// level of detail and culling, with the thresholds of the viewer
+	bool is_lod;
+};
+
+constexpr Toggle toggles[] = {
+	{"all", true, true, false},
+	{"landmarks", true, false, false},
+	{"bones", false, true, false},
+	{"lod", true, true, true},
+};
+
+// xorshift32, so that the keypoints are the same on every platform
+struct Rng {
+	uint32_t state;
+	uint32_t next() {
+		state ^= state << 13;
+		state ^= state >> 17;
+		state ^= state << 5;
+		return state;
+	}
+	// [0, 1)
+	float uniform() { return static_cast<float>(next() >> 8) / static_cast<float>(1 << 24); }
+};
+
+// person `i` is placed on a grid, with keypoints scattered in its box
+struct Scene {
+	std::vector<float> keypoints;
+	std::vector<uint16_t> boxes;
+};
+
+Scene make_scene(const Resolution &res, size_t n_people, aux_img::Layout layout) {
+	Scene scene;
+	scene.keypoints.resize(n_people * NUM_KEYPOINTS * 2);
+	scene.boxes.resize(n_people * 4);
+	Rng rng{0x9e3779b9u};
+	const auto grid   = static_cast<size_t>(std::ceil(std::sqrt(static_cast<double>(n_people))));
+	const float box_w = static_cast<float>(res.cols) / grid;
+	const float box_h = static_cast<float>(res.rows) / grid;
+	for (size_t p = 0; p < n_people; p++) {
+		const float x0 = (p % grid) * box_w;
+		const float y0 = (p / grid) * box_h;
+		float *kps     = scene.keypoints.data() + p * NUM_KEYPOINTS * 2;
+		for (size_t k = 0; k < NUM_KEYPOINTS; k++) {
+			const float x = x0 + (0.1f + 0.8f * rng.uniform()) * box_w;
+			const float y = y0 + (0.1f + 0.8f * rng.uniform()) * box_h;
+			if (layout == aux_img::Layout::RowMajor) {
+				kps[k * 2]     = x;
+				kps[k * 2 + 1] = y;
+			} else {
+				kps[k]                 = x;
+				kps[NUM_KEYPOINTS + k] = y;
+			}
+		}
+		auto *bb = scene.boxes.data() + p * 4;
+		bb[0]    = static_cast<uint16_t>(x0);
+		bb[1]    = static_cast<uint16_t>(y0);
+		bb[2]    = static_cast<uint16_t>(std::min(x0 + box_w, res.cols - 1.0f));
+		bb[3]    = static_cast<uint16_t>(std::min(y0 + box_h, res.rows - 1.0f));
+	}
+	return scene;
+}
+
+struct Frame {
+	std::vector<uint8_t> buffer;
+	aux_img::SharedMat mat;
+
+	Frame(const Resolution &res, const Format &fmt)
+		: buffer(static_cast<size_t>(res.rows) * res.cols * fmt.bits_per_pixel / 8),
+		  mat{buffer.data(), res.rows, res.cols, fmt.depth, fmt.pixel_format} {}
+};
+
+// 8 bit RGB, BGR, RGBA, BGRA or GRAY
+bool is_composite_source(const Format &fmt) {
+	return fmt.depth == aux_img::Depth::U8 && fmt.pixel_format <= aux_img::PixelFormat::GRAY;
+}
+
+aux_img::DrawSkeletonOptions skeleton_options(aux_img::Layout layout, const Toggle &toggle) {
+	const int face_min_height = toggle.is_lod ? 64 : 0;
+	const int hand_min_height = toggle.is_lod ? 96 : 0;
+	return {layout, toggle.is_draw_landmarks, toggle.is_draw_bones, 5, -1, 2, face_min_height, hand_min_height, toggle.is_lod};
+}
+
+struct Options {
+	std::string_view filter;
+	double min_time_ms = 100;
+	int threads        = 1;
+	const char *json   = nullptr;
+	bool is_verify     = false;
+	// run the pose handoff stress test for this long instead, if > 0
+	double stress_ms = 0;
+};
+
+struct Result {
+	std::string name;
+	size_t iterations;
+	double ns_per_frame;
+	// people, boxes or text labels per frame
+	size_t units;
+	double ns_per_unit;
+};
+
+// repeat `frame_fn` until `min_time_ms` has elapsed
+Result measure(const Options &opts, std::string name, size_t units, const std::function<void()> &frame_fn) {
+	// warm up, e.g. the pool and the caches
+	frame_fn();
+	size_t iterations = 0;
+	const auto start  = Clock::now();
+	auto elapsed      = Clock::duration::zero();
+	do {
+		frame_fn();
+		iterations++;
+		elapsed = Clock::now() - start;
+	} while (std::chrono::duration<double, std::milli>(elapsed).count() < opts.min_time_ms);
+	const double ns_per_frame = std::chrono::duration<double, std::nano>(elapsed).count() / iterations;
+	return {std::move(name), iterations, ns_per_frame, units, ns_per_frame / std::max<size_t>(units, 1)};
+}
+
+bool is_selected(const Options &opts, const std::string &name) {
+	return opts.filter.empty() || name.find(opts.filter) != std::string::npos;
+}
+
+void run_all(const Options &opts, std::vector<Result> &results) {
+	auto report = [&](Result r) {
+		std::println("{:<64} {:>10} it {:>14.0f} ns/frame {:>12.0f} ns/unit", r.name, r.iterations, r.ns_per_frame, r.ns_per_unit);
+		results.push_back(std::move(r));
+	};
+	for (const auto &res : resolutions) {
+		for (const auto &fmt : formats) {
+			Frame frame(res, fmt);
+			const auto fmt_name = std::format("{}_{}", aux_img::pixel_format_to_string(fmt.pixel_format), aux_img::depth_to_string(fmt.depth));
+			for (const auto layout : {aux_img::Layout::RowMajor, aux_img::Layout::ColMajor}) {
+				const auto layout_name = layout == aux_img::Layout::RowMajor ? "row" : "col";
+				for (const auto n_people : people_counts) {
+					const auto scene = make_scene(res, n_people, layout);
+					for (const auto &toggle : toggles) {
+						const auto name = std::format("skeleton/{}/{}/{}/{}/n={}", res.name, fmt_name, layout_name, toggle.name, n_people);
+						if (!is_selected(opts, name)) {
+							continue;
+						}
+						const auto skt_opts = skeleton_options(layout, toggle);
+						report(measure(opts, name, n_people, [&] {
+							for (size_t p = 0; p < n_people; p++) {
+								aux_img_draw_whole_body_skeleton_impl(frame.mat, scene.keypoints.data() + p * NUM_KEYPOINTS * 2, skt_opts);
+							}
+						}));
+					}
+					const auto batch_opts = aux_img::DrawPosesOptions{skeleton_options(layout, toggles[0]), {0, 250, 0}, 5};
+					const auto name       = std::format("batch/{}/{}/{}/n={}", res.name, fmt_name, layout_name, n_people);
+					if (is_selected(opts, name)) {
+						report(measure(opts, name, n_people, [&] {
+							aux_img_draw_poses_batch_impl(frame.mat, scene.keypoints.data(), n_people, scene.boxes.data(), n_people, batch_opts, nullptr);
+						}));
+					}
+					// the same through a canvas, validated and styled once, and replaying
+					// a recorded list onto it (e.g. the last known poses)
+					const auto canvas_name  = std::format("canvas_batch/{}/{}/{}/n={}", res.name, fmt_name, layout_name, n_people);
+					const auto replay_name  = std::format("replay/{}/{}/{}/n={}", res.name, fmt_name, layout_name, n_people);
+					aux_img::Canvas *canvas = nullptr;
+					if ((is_selected(opts, canvas_name) || is_selected(opts, replay_name)) &&
+						aux_img_canvas_create(frame.mat, &canvas) == aux_img::Status::Ok) {
+						if (is_selected(opts, canvas_name)) {
+							report(measure(opts, canvas_name, n_people, [&] {
+								aux_img_canvas_draw_poses_batch(canvas, scene.keypoints.data(), n_people, scene.boxes.data(), n_people, batch_opts, nullptr);
+							}));
+						}
+						aux_img::CommandList *list = nullptr;
+						if (is_selected(opts, replay_name) && aux_img_cmdlist_create(&list) == aux_img::Status::Ok) {
+							aux_img_cmdlist_poses_batch(list, scene.keypoints.data(), n_people, scene.boxes.data(), n_people, batch_opts);
+							report(measure(opts, replay_name, n_people, [&] {
+								aux_img_canvas_execute(canvas, list, nullptr);
+							}));
+							aux_img_cmdlist_destroy(list);
+						}
+						aux_img_canvas_destroy(canvas);
+					}
+					if (!is_composite_source(fmt)) {
+						continue;
+					}
+					// the viewer path: a copy of the frame then a batch, against the
+					// fused kernel writing a row aligned BGR buffer
+					const auto copy_name = std::format("copy+batch/{}/{}/{}/n={}", res.name, fmt_name, layout_name, n_people);
+					if (is_selected(opts, copy_name)) {
+						Frame copy(res, fmt);
+						report(measure(opts, copy_name, n_people, [&] {
+							std::memcpy(copy.buffer.data(), frame.buffer.data(), frame.buffer.size());
+							aux_img_draw_poses_batch_impl(copy.mat, scene.keypoints.data(), n_people, scene.boxes.data(), n_people, batch_opts, nullptr);
+						}));
+					}
+					const auto composite_name = std::format("composite/{}/{}/{}/n={}", res.name, fmt_name, layout_name, n_people);
+					if (is_selected(opts, composite_name)) {
+						const size_t step = aux_img_composite_step(res.cols, aux_img::OutputFormat::BGR, true);
+						std::vector<uint8_t> display(step * res.rows);
+						const auto target = aux_img::CompositeTarget{display.data(), step, aux_img::OutputFormat::BGR};
+						report(measure(opts, composite_name, n_people, [&] {
+							aux_img_composite_poses_impl(frame.mat, target, scene.keypoints.data(), n_people, scene.boxes.data(), n_people, batch_opts, nullptr);
+						}));
+					}
+					// the same into a 640 pixel wide preview, as the viewer shows it
+					const auto preview_name = std::format("preview/{}/{}/{}/n={}", res.name, fmt_name, layout_name, n_people);
+					if (is_selected(opts, preview_name)) {
+						const auto rows   = static_cast<uint16_t>(res.rows * 640 / res.cols);
+						const size_t step = aux_img_composite_step(640, aux_img::OutputFormat::BGR, true);
+						std::vector<uint8_t> display(step * rows);
+						const auto target = aux_img::PreviewTarget{display.data(), step, rows, 640, aux_img::OutputFormat::BGR};
+						report(measure(opts, preview_name, n_people, [&] {
+							aux_img_preview_poses(frame.mat, target, scene.keypoints.data(), n_people, scene.boxes.data(), n_people, batch_opts, nullptr);
+						}));
+					}
+				}
+			}
+			for (const auto n_boxes : people_counts) {
+				const auto name = std::format("rectangle/{}/{}/n={}", res.name, fmt_name, n_boxes);
+				if (!is_selected(opts, name)) {
+					continue;
+				}
+				const auto scene = make_scene(res, n_boxes, aux_img::Layout::RowMajor);
+				report(measure(opts, name, n_boxes, [&] {
+					for (size_t b = 0; b < n_boxes; b++) {
+						const auto *bb = scene.boxes.data() + b * 4;
+						aux_img_rectangle_impl(frame.mat, {bb[0], bb[1]}, {bb[2], bb[3]}, {0, 250, 0}, 5);
+					}
+				}));
+			}
+			for (const auto n_labels : people_counts) {
+				const auto scene = make_scene(res, n_labels, aux_img::Layout::RowMajor);
+				std::vector<std::string> labels;
+				for (size_t i = 0; i < n_labels; i++) {
+					labels.push_back(std::format("id={} fps={:.1f}", i, 30.0 - i * 0.1));
+				}
+				// "glyphs" composes every string from the glyph atlas
+				for (const auto &[cache_name, capacity] : {std::pair{"cached", 256}, std::pair{"glyphs", 0}}) {
+					const auto name = std::format("put_text/{}/{}/{}/n={}", res.name, fmt_name, cache_name, n_labels);
+					if (!is_selected(opts, name)) {
+						continue;
+					}
+					aux_img_set_text_cache_capacity(capacity);
+					report(measure(opts, name, n_labels, [&] {
+						for (size_t i = 0; i < n_labels; i++) {
+							const auto *bb = scene.boxes.data() + i * 4;
+							aux_img_put_text_impl(frame.mat, labels[i].c_str(), {bb[0], bb[1] + 24}, {255, 255, 255}, 0.8, 2, false);
+						}
+					}));
+				}
+				aux_img_set_text_cache_capacity(256);
+			}
+		}
+	}
+	// a pose stream at a third of the camera rate, sampled at every frame in
+	// between; frame independent
+	for (const auto n_people : people_counts) {
+		const auto name               = std::format("history/n={}", n_people);
+		aux_img::PoseHistory *history = nullptr;
+		if (!is_selected(opts, name) || aux_img_history_create(8, n_people, aux_img::Layout::RowMajor, &history) != aux_img::Status::Ok) {
+			continue;
+		}
+		const auto scene = make_scene(resolutions[0], n_people, aux_img::Layout::RowMajor);
+		for (uint32_t f = 0; f < 8 * 3; f += 3) {
+			aux_img_history_push(history, f, scene.keypoints.data(), n_people, scene.boxes.data(), n_people);
+		}
+		std::vector<float> keypoints(scene.keypoints.size());
+		std::vector<uint16_t> boxes(scene.boxes.size());
+		aux_img::PoseSample sample{};
+		uint32_t f = 0;
+		report(measure(opts, name, n_people, [&] {
+			aux_img_history_sample(history, 1 + f++ % 20, 0, keypoints.data(), boxes.data(), &sample);
+		}));
+		aux_img_history_destroy(history);
+	}
+	// ingest of a received pose message into the history: copied out and
+	// decoded into aligned arrays first (as `info.unmarshal` did), or pushed
+	// from a view into the message, of either wire version
+	for (const auto n_people : people_counts) {
+		const auto copy_name          = std::format("ingest/copy/n={}", n_people);
+		const auto view_name          = std::format("ingest/view/n={}", n_people);
+		const auto v2_name            = std::format("ingest/view_v2/n={}", n_people);
+		aux_img::PoseHistory *history = nullptr;
+		if ((!is_selected(opts, copy_name) && !is_selected(opts, view_name) && !is_selected(opts, v2_name)) ||
+			aux_img_history_create(8, n_people, aux_img::Layout::RowMajor, &history) != aux_img::Status::Ok) {
+			continue;
+		}
+		const auto scene = make_scene(resolutions[0], n_people, aux_img::Layout::RowMajor);
+		const auto n_kps = scene.keypoints.size() * sizeof(float);
+		std::vector<uint8_t> message(6 + n_kps + scene.boxes.size() * sizeof(uint16_t));
+		message[4] = static_cast<uint8_t>(n_people);
+		message[5] = static_cast<uint8_t>(n_people);
+		std::memcpy(message.data() + 6, scene.keypoints.data(), n_kps);
+		std::memcpy(message.data() + 6 + n_kps, scene.boxes.data(), scene.boxes.size() * sizeof(uint16_t));
+		uint32_t f = 0;
+		if (is_selected(opts, copy_name)) {
+			report(measure(opts, copy_name, n_people, [&] {
+				std::vector<uint8_t> received(message.begin(), message.end());
+				std::vector<float> keypoints(scene.keypoints.size());
+				std::vector<uint16_t> boxes(scene.boxes.size());
+				std::memcpy(keypoints.data(), received.data() + 6, n_kps);
+				std::memcpy(boxes.data(), received.data() + 6 + n_kps, boxes.size() * sizeof(uint16_t));
+				aux_img_history_push(history, f++, keypoints.data(), n_people, boxes.data(), n_people);
+			}));
+		}
+		if (is_selected(opts, view_name)) {
+			report(measure(opts, view_name, n_people, [&] {
+				std::memcpy(message.data(), &f, sizeof(f));
+				f++;
+				aux_img::PoseView view{};
+				aux_img_pose_view_parse(message.data(), message.size(), &view);
+				aux_img_history_push_view(history, &view);
+			}));
+		}
+		if (is_selected(opts, v2_name)) {
+			// 1.56x smaller; dequantized with SIMD instead of copied
+			std::vector<uint8_t> encoded(aux_img_pose_encoded_size(n_people, n_people));
+			aux_img_pose_encode(0, scene.keypoints.data(), nullptr, n_people, scene.boxes.data(), n_people, encoded.data(), encoded.size(), nullptr);
+			report(measure(opts, v2_name, n_people, [&] {
+				std::memcpy(encoded.data() + 4, &f, sizeof(f));
+				f++;
+				aux_img::PoseView view{};
+				aux_img_pose_view_parse(encoded.data(), encoded.size(), &view);
+				aux_img_history_push_view(history, &view);
+			}));
+		}
+		aux_img_history_destroy(history);
+	}
+
+	// 4 or 16 cameras with a new 1080p frame each, downsampled into the
+	// 480x270 tiles of a 4x4 grid; per camera
+	for (const size_t n_cameras : {4, 16}) {
+		const auto name         = std::format("mosaic/n={}/1080p", n_cameras);
+		aux_img::Mosaic *mosaic = nullptr;
+		if (!is_selected(opts, name) || aux_img_mosaic_create({4, 4, 480, 270, aux_img::OutputFormat::BGR}, &mosaic) != aux_img::Status::Ok) {
+			continue;
+		}
+		std::vector<Frame> cameras;
+		cameras.reserve(n_cameras);
+		for (size_t i = 0; i < n_cameras; i++) {
+			cameras.emplace_back(resolutions[1], formats[0]);
+			std::fill(cameras.back().buffer.begin(), cameras.back().buffer.end(), static_cast<uint8_t>(i * 16));
+		}
+		report(measure(opts, name, n_cameras, [&] {
+			for (size_t i = 0; i < n_cameras; i++) {
+				aux_img_mosaic_set_frame(mosaic, i, cameras[i].mat);
+			}
+			aux_img_mosaic_compose(mosaic, nullptr);
+		}));
+		aux_img_mosaic_destroy(mosaic);
+	}
+
+	// the receive thread alone, i.e. `set_frame` of 16 cameras at 1080p, each
+	// downsampled on the pool of `--threads`; it keeps up with 30 fps cameras
+	// if a set of frames takes less than their period
+	if (const std::string name = "mosaic/receive/n=16/1080p"; is_selected(opts, name)) {
+		constexpr size_t N_CAMERAS = 16;
+		constexpr double PERIOD_MS = 1000.0 / 30;
+		aux_img::Mosaic *mosaic    = nullptr;
+		if (aux_img_mosaic_create({4, 4, 480, 270, aux_img::OutputFormat::BGR}, &mosaic) == aux_img::Status::Ok) {
+			std::vector<Frame> cameras;
+			cameras.reserve(N_CAMERAS);
+			for (size_t i = 0; i < N_CAMERAS; i++) {
+				cameras.emplace_back(resolutions[1], formats[0]);
+				std::fill(cameras.back().buffer.begin(), cameras.back().buffer.end(), static_cast<uint8_t>(i * 16));
+			}
+			auto result = measure(opts, name, N_CAMERAS, [&] {
+				for (size_t i = 0; i < N_CAMERAS; i++) {
+					aux_img_mosaic_set_frame(mosaic, i, cameras[i].mat);
+				}
+			});
+			const double ms = result.ns_per_frame / 1e6;
+			std::println("  receive thread: {:.2f} ms per set of {} frames, {} the {:.2f} ms of 30 fps ({} threads)", ms, N_CAMERAS,
+						 ms < PERIOD_MS ? "within" : "OVER", PERIOD_MS, opts.threads);
+			report(std::move(result));
+			aux_img_mosaic_destroy(mosaic);
+		}
+	}
+}
+
+// compare the span rasterizer against OpenCV on BGR U8
+//
+// landmarks must be pixel identical; bones may differ by one pixel along the
+// edges, so at most `BONE_TOLERANCE` of the covered pixels may differ
+bool verify() {
+	constexpr double BONE_TOLERANCE = 0.05;
+	constexpr Resolution res        = {"verify", 640, 480};
+	constexpr Format fmt            = formats[0];
+	bool ok                         = true;
+	for (const auto layout : {aux_img::Layout::RowMajor, aux_img::Layout::ColMajor}) {
+		const auto scene = make_scene(res, 4, layout);
+		for (int radius : {0, 1, 2, 3, 5, 8}) {
+			for (int bone_thickness : {2, 3, 4, 7}) {
+				for (const auto &toggle : {toggles[1], toggles[2]}) {
+					Frame fast(res, fmt);
+					Frame reference(res, fmt);
+					const auto skt_opts = aux_img::DrawSkeletonOptions{layout, toggle.is_draw_landmarks, toggle.is_draw_bones, radius, -1, bone_thickness, 0, 0, false};
+					for (auto [frame, is_fast] : {std::pair{&fast, true}, std::pair{&reference, false}}) {
+						aux_img_set_fast_raster(is_fast);
+						aux_img_draw_poses_batch_impl(frame->mat, scene.keypoints.data(), 4, nullptr, 0, {skt_opts, {}, 0}, nullptr);
+					}
+					aux_img_set_fast_raster(true);
+					size_t covered = 0, mismatched = 0;
+					for (size_t i = 0; i < fast.buffer.size(); i += fmt.bits_per_pixel / 8) {
+						const bool is_covered = std::memcmp(&reference.buffer[i], "\0\0\0", 3) != 0 || std::memcmp(&fast.buffer[i], "\0\0\0", 3) != 0;
+						covered += is_covered;
+						mismatched += std::memcmp(&reference.buffer[i], &fast.buffer[i], 3) != 0;
+					}
+					const double ratio = covered == 0 ? 0 : static_cast<double>(mismatched) / covered;
+					const bool pass    = toggle.is_draw_landmarks ? mismatched == 0 : ratio <= BONE_TOLERANCE;
+					std::println("verify/{}/{}/r={}/t={}: {} of {} pixels differ ({:.3f}%) {}",
+								 layout == aux_img::Layout::RowMajor ? "row" : "col", toggle.name, radius, bone_thickness,
+								 mismatched, covered, ratio * 100, pass ? "ok" : "FAIL");
+					ok = ok && pass;
+				}
+			}
+		}
+	}
+	// a single person exported and rasterized must match direct drawing
+	for (const auto layout : {aux_img::Layout::RowMajor, aux_img::Layout::ColMajor}) {
+		const auto scene    = make_scene(res, 1, layout);
+		const auto skt_opts = skeleton_options(layout, toggles[0]);
+		std::vector<aux_img::GeometrySegment> segments(256);
+		std::vector<aux_img::GeometryDisc> discs(256);
+		aux_img::GeometryBuffer geometry{segments.data(), 256, 0, discs.data(), 256, 0, nullptr, 0, 0};
+		Frame exported(res, fmt);
+		Frame reference(res, fmt);
+		aux_img_set_fast_raster(false);
+		aux_img_draw_whole_body_skeleton_impl(reference.mat, scene.keypoints.data(), skt_opts);
+		aux_img_set_fast_raster(true);
+		const bool is_exported = aux_img_export_whole_body_skeleton(scene.keypoints.data(), skt_opts, &geometry);
+		aux_img_rasterize_geometry(exported.mat, &geometry);
+		const bool pass = is_exported && exported.buffer == reference.buffer;
+		std::println("verify/{}/geometry: {} segments, {} discs {}",
+					 layout == aux_img::Layout::RowMajor ? "row" : "col", geometry.n_segments, geometry.n_discs, pass ? "ok" : "FAIL");
+		ok = ok && pass;
+	}
+	return ok;
+}
+
+// the pose handoff from the socket thread to the frame thread, under load
+//
+// a producer publishes every `PRODUCER_PERIOD`, and a consumer reads in a
+// loop and then keeps using what it read for `hold` (i.e. draws it). Every
+// value of a publish is its frame index, so a read mixing two publishes is
+// counted as torn. The baseline is the mutex the viewer used to hold while
+// drawing.
+//
+// reported: the time a write and a read take (contention), and the age of
+// fresh poses when read (latency)
+struct Percentiles {
+	double p50;
+	double p99;
+	double max;
+};
+
+Percentiles percentiles(std::vector<int64_t> &samples) {
+	if (samples.empty()) {
+		return {0, 0, 0};
+	}
+	std::sort(samples.begin(), samples.end());
+	auto at = [&](double q) { return static_cast<double>(samples[static_cast<size_t>(q * (samples.size() - 1))]); };
+	return {at(0.5), at(0.99), static_cast<double>(samples.back())};
+}
+
+// what the producer and the consumer go through; the triple buffer or the
+// mutex guarded copy
+struct Handoff {
+	std::function<void(uint32_t frame_index, const float *keypoints, const uint16_t *boxes)> write;
+	// calls `use` with the newest poses, and whether they are fresh
+	std::function<void(const std::function<void(const aux_img::PoseFrame &)> &use)> read;
+};
+
+bool stress(double duration_ms) {
+	constexpr size_t N_PEOPLE          = 8;
+	constexpr auto PRODUCER_PERIOD     = std::chrono::microseconds(100);
+	constexpr size_t N_FLOATS          = N_PEOPLE * NUM_KEYPOINTS * 2;
+	constexpr size_t PUBLISHED_AT_MASK = (1 << 16) - 1;
+	bool ok                            = true;
+
+	for (const auto hold : {std::chrono::microseconds(0), std::chrono::microseconds(1000)}) {
+		// triple buffer
+		aux_img::PoseBuffer *buffer = nullptr;
+		if (aux_img_pose_buffer_create(N_PEOPLE, &buffer) != aux_img::Status::Ok) {
+			return false;
+		}
+		Handoff triple{
+			[&](uint32_t frame_index, const float *keypoints, const uint16_t *boxes) {
+				aux_img_pose_buffer_write(buffer, frame_index, keypoints, N_PEOPLE, boxes, N_PEOPLE);
+			},
+			[&](const auto &use) {
+				aux_img::PoseFrame frame{};
+				aux_img_pose_buffer_read(buffer, &frame);
+				use(frame);
+			},
+		};
+		// mutex guarded copy, held while the poses are used
+		std::mutex mutex;
+		std::vector<float> shared_keypoints(N_FLOATS);
+		std::vector<uint16_t> shared_boxes(N_PEOPLE * 4);
+		uint32_t shared_frame_index = 0;
+		bool is_shared_fresh        = false;
+		Handoff locked{
+			[&](uint32_t frame_index, const float *keypoints, const uint16_t *boxes) {
+				std::lock_guard lock(mutex);
+				std::copy_n(keypoints, N_FLOATS, shared_keypoints.data());
+				std::copy_n(boxes, N_PEOPLE * 4, shared_boxes.data());
+				shared_frame_index = frame_index;
+				is_shared_fresh    = true;
+			},
+			[&](const auto &use) {
+				std::lock_guard lock(mutex);
+				const aux_img::PoseFrame frame{shared_frame_index, N_PEOPLE, N_PEOPLE, is_shared_fresh, shared_keypoints.data(), shared_boxes.data()};
+				is_shared_fresh = false;
+				use(frame);
+			},
+		};
+
+		for (const auto &[name, handoff] : {std::pair<const char *, Handoff *>{"triple", &triple}, {"mutex", &locked}}) {
+			std::vector<std::atomic<int64_t>> published_at(PUBLISHED_AT_MASK + 1);
+			std::vector<int64_t> write_ns, read_ns, age_ns;
+			write_ns.reserve(1 << 20);
+			read_ns.reserve(1 << 20);
+			age_ns.reserve(1 << 20);
+			std::atomic<bool> is_running{true};
+			size_t n_torn     = 0;
+			size_t n_fresh    = 0;
+			uint32_t n_writes = 0;
+
+			std::thread producer([&] {
+				std::vector<float> keypoints(N_FLOATS);
+				std::vector<uint16_t> boxes(N_PEOPLE * 4);
+				auto next = Clock::now();
+				for (uint32_t f = 1; is_running.load(std::memory_order_relaxed); f++) {
+					std::fill(keypoints.begin(), keypoints.end(), static_cast<float>(f & 0xffffff));
+					std::fill(boxes.begin(), boxes.end(), static_cast<uint16_t>(f));
+					const auto start = Clock::now();
+					published_at[f & PUBLISHED_AT_MASK].store(start.time_since_epoch().count(), std::memory_order_relaxed);
+					handoff->write(f, keypoints.data(), boxes.data());
+					if (write_ns.size() < write_ns.capacity()) {
+						write_ns.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count());
+					}
+					n_writes = f;
+					next += PRODUCER_PERIOD;
+					while (Clock::now() < next) {
+					}
+				}
+			});
+
+			const auto end = Clock::now() + std::chrono::duration<double, std::milli>(duration_ms);
+			while (Clock::now() < end) {
+				const auto start = Clock::now();
+				handoff->read([&](const aux_img::PoseFrame &frame) {
+					if (read_ns.size() < read_ns.capacity()) {
+						read_ns.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count());
+					}
+					if (!frame.is_fresh) {
+						return;
+					}
+					n_fresh++;
+					const auto published = published_at[frame.frame_index & PUBLISHED_AT_MASK].load(std::memory_order_relaxed);
+					if (age_ns.size() < age_ns.capacity()) {
+						age_ns.push_back(Clock::now().time_since_epoch().count() - published);
+					}
+					const auto value = static_cast<float>(frame.frame_index & 0xffffff);
+					const bool is_torn =
+						std::any_of(frame.keypoints, frame.keypoints + N_FLOATS, [&](float v) { return v != value; }) ||
+						std::any_of(frame.boxes, frame.boxes + N_PEOPLE * 4, [&](uint16_t v) { return v != static_cast<uint16_t>(frame.frame_index); });
+					n_torn += is_torn;
+					// drawing
+					const auto until = Clock::now() + hold;
+					while (Clock::now() < until) {
+					}
+				});
+			}
+			is_running = false;
+			producer.join();
+
+			const auto w = percentiles(write_ns);
+			const auto r = percentiles(read_ns);
+			const auto a = percentiles(age_ns);
+			std::println("stress/{}/hold={}us: {} writes, {} fresh reads, {} torn", name, hold.count(), n_writes, n_fresh, n_torn);
+			std::println("  write ns p50 {:.0f} p99 {:.0f} max {:.0f}, read ns p50 {:.0f} p99 {:.0f} max {:.0f}, age ns p50 {:.0f} p99 {:.0f} max {:.0f}",
+						 w.p50, w.p99, w.max, r.p50, r.p99, r.max, a.p50, a.p99, a.max);
+			ok = ok && n_torn == 0;
+		}
+		aux_img::PoseBufferStats stats{};
+		aux_img_pose_buffer_stats(buffer, &stats);
+		std::println("  triple buffer: {} published, {} dropped, {} read", stats.published, stats.dropped, stats.read_fresh);
+		aux_img_pose_buffer_destroy(buffer);
+	}
+	return ok;
+}
+
+void write_json(const char *path, const Options &opts, const std::vector<Result> &results) {
+	FILE *f = std::fopen(path, "w");
+	if (f == nullptr) {
+		std::println(stderr, "failed to open {}", path);
+		return;
+	}
+	std::println(f, "{{\n  \"threads\": {},\n  \"min_time_ms\": {},\n  \"results\": [", opts.threads, opts.min_time_ms);
+	for (size_t i = 0; i < results.size(); i++) {
+		const auto &r = results[i];
+		std::println(f, "    {{\"name\": \"{}\", \"iterations\": {}, \"ns_per_frame\": {:.1f}, \"units\": {}, \"ns_per_unit\": {:.1f}}}{}",
+					 r.name, r.iterations, r.ns_per_frame, r.units, r.ns_per_unit, i + 1 == results.size() ? "" : ",");
+	}
+	std::println(f, "  ]\n}}");
+	std::fclose(f);
+}
+}
+
+int main(int argc, char **argv) {
+	Options opts;
+	for (int i = 1; i < argc; i++) {
+		const std::string_view arg = argv[i];
+		auto value                 = [&] {
+			if (i + 1 >= argc) {
+				std::println(stderr, "missing value for {}", arg);
+				std::exit(2);
+			}
+			return argv[++i];
+		};
+		if (arg == "--filter") {
+			opts.filter = value();
+		} else if (arg == "--min-time") {
+			opts.min_time_ms = std::atof(value());
+		} else if (arg == "--threads") {
+			opts.threads = std::atoi(value());
+		} else if (arg == "--json") {
+			opts.json = value();
+		} else if (arg == "--verify") {
+			opts.is_verify = true;
+		} else if (arg == "--stress") {
+			opts.stress_ms = std::atof(value());
+		} else {
+			std::println(stderr, "usage: {} [--filter <substr>] [--min-time <ms>] [--threads <n>] [--json <path>] [--verify] [--stress <ms>]", argv[0]);
+			return 2;
+		}
+	}
+	aux_img_set_num_threads(opts.threads);
+	if (opts.is_verify) {
+		return verify() ? 0 : 1;
+	}
+	if (opts.stress_ms > 0) {
+		return stress(opts.stress_ms) ? 0 : 1;
+	}
+	std::vector<Result> results;
+	run_all(opts, results);
+	if (opts.json != nullptr) {
+		write_json(opts.json, opts, results);
+	}
+	return 0;
+}
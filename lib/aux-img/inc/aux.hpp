@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 #include <opencv2/core.hpp>
 
@@ -13,8 +14,14 @@ enum class PixelFormat : uint8_t {
 	BGRA,
 	/// channel=1
 	GRAY,
+	/// packed 4:4:4, Y U V per pixel
 	YUV,
+	/// packed 4:2:2, Y0 U Y1 V per pair of pixels
 	YUYV,
+	/// 4:2:0, Y plane followed by an interleaved UV plane
+	NV12,
+	/// 4:2:0, Y plane followed by a U plane and a V plane
+	I420,
 };
 
 /// @note use with `depth` field in `frame_info_t`
@@ -31,6 +38,12 @@ enum class Depth : uint8_t {
 
 // assuming step = cols * channels
 // no curious step values/padding
+//
+// YUV formats are `Depth::U8` only, and drawn into without a conversion of
+// the frame: colors are given in BGR and converted to BT.601 limited range,
+// and chroma is averaged over each subsampled block. `rows`/`cols` are those
+// of the luma plane, which must be even for `NV12`/`I420` (`cols` for
+// `YUYV`). Geometry rasterization does not support them.
 struct SharedMat {
 	uint8_t *data;
 	uint16_t rows;
@@ -90,18 +103,264 @@ struct DrawSkeletonOptions {
 	int landmark_radius;
 	int landmark_thickness;
 	int bone_thickness;
+	// level of detail, by the height (in pixels) spanned by the body and
+	// feet keypoints of a person; below it the face landmarks, or the hand
+	// landmarks and bones, are skipped. 0 always draws them.
+	int face_min_height;
+	int hand_min_height;
+	// skip landmarks that are NaN or outside the frame, and clip bones to
+	// the frame (dropping the ones that miss it entirely); YUV targets are
+	// always culled
+	bool is_cull;
+};
+
+// how much of the skeleton work was skipped by the level of detail and
+// culling of `DrawSkeletonOptions`
+struct CullStats {
+	uint32_t landmarks_drawn;
+	uint32_t landmarks_culled;
+	uint32_t bones_drawn;
+	uint32_t bones_culled;
+	// people drawn without their face/hand subsets
+	uint32_t people_without_face;
+	uint32_t people_without_hands;
+};
+
+struct DrawPosesOptions {
+	DrawSkeletonOptions skeleton;
+	Vec3d bounding_box_color;
+	int bounding_box_thickness;
+};
+
+// layout of the display buffer written by `aux_img_composite_poses_impl`
+enum class OutputFormat : uint8_t {
+	BGR = 0,
+	RGBA,
+	BGRA,
+};
+
+// `rows`/`cols` are those of the source frame; `step` is the number of bytes
+// between rows, at least `cols` times the pixel size
+struct CompositeTarget {
+	uint8_t *data;
+	size_t step;
+	OutputFormat format;
+};
+
+// a display buffer of its own size, usually smaller than the frame; see
+// `aux_img_preview_poses`
+struct PreviewTarget {
+	uint8_t *data;
+	size_t step;
+	uint16_t rows;
+	uint16_t cols;
+	OutputFormat format;
+};
+
+// overlay primitives, exported instead of rasterized
+//
+// each one is a tightly packed instance record (4 byte aligned, no padding)
+// which could be uploaded as-is and expanded on the GPU. Colors are 8 bit
+// per channel, in the same channel order as the drawing functions would
+// write them, with alpha = 255.
+struct GeometrySegment {
+	Vec2f p0;
+	Vec2f p1;
+	float thickness;
+	uint8_t color[4];
+};
+
+struct GeometryDisc {
+	Vec2f center;
+	float radius;
+	// negative for a filled disc, otherwise the width of the outline
+	float thickness;
+	uint8_t color[4];
+};
+
+// an axis aligned rectangle, with corners `p0` and `p1`
+struct GeometryQuad {
+	Vec2f p0;
+	Vec2f p1;
+	// negative for a filled quad, otherwise the width of the outline
+	float thickness;
+	uint8_t color[4];
+};
+
+static_assert(sizeof(GeometrySegment) == 24);
+static_assert(sizeof(GeometryDisc) == 20);
+static_assert(sizeof(GeometryQuad) == 24);
+
+// caller provided arrays; the export functions append to them and bump the
+// `n_*` counters
+struct GeometryBuffer {
+	GeometrySegment *segments;
+	uint32_t segments_capacity;
+	uint32_t n_segments;
+	GeometryDisc *discs;
+	uint32_t discs_capacity;
+	uint32_t n_discs;
+	GeometryQuad *quads;
+	uint32_t quads_capacity;
+	uint32_t n_quads;
+};
+
+// returned by the `aux_img_canvas_*` functions; nothing is thrown through
+// the C ABI
+enum class Status : int32_t {
+	Ok = 0,
+	// bad format/depth/dimensions, or a null pointer
+	InvalidArgument,
+	OutOfMemory,
+	// raised by OpenCV itself
+	OpenCVError,
+	Unknown,
+};
+
+// a `SharedMat` validated once, with its `cv::Mat` header, format dispatch
+// and skeleton style kept between calls; see `aux_img_canvas_create`
+struct Canvas;
+
+// draw commands recorded into flat arenas owned by the list, and run by
+// `aux_img_canvas_execute`; see `aux_img_cmdlist_create`
+struct CommandList;
+
+// where a frame spends its time, from the producer to the screen; see
+// `aux_img_latency_report`
+enum class Stage : uint32_t {
+	// from the producer's timestamp to the client receiving the announcement
+	Receive = 0,
+	// from receiving the announcement to the frame callback running
+	Dispatch,
+	// `aux_img_composite_*`: copy, conversion and overlay (recorded here)
+	Composite,
+	// drawing poses into a frame in place (recorded here)
+	Overlay,
+	// handing the frame to the GPU
+	Upload,
+	// from the producer's timestamp to the end of the upload
+	Total,
+};
+constexpr size_t STAGE_COUNT = 6;
+
+struct StageLatency {
+	uint64_t count;
+	uint64_t p50_ns;
+	uint64_t p99_ns;
+	uint64_t max_ns;
+};
+
+struct LatencyReport {
+	StageLatency stages[STAGE_COUNT];
+	// frames the client never saw
+	uint64_t dropped;
+};
+
+// a pose message decoded in place, pointing into the received bytes, which
+// must outlive it; see `aux_img_pose_view_parse`
+//
+// wire format v1, little endian: frame index (u32), number of skeletons
+// (u8), number of boxes (u8), the skeletons (133 * 2 f32 each, row major) and
+// the boxes (4 u16 each, [x1, y1, x2, y2])
+//
+// v2, told apart by its leading magic "PV2\xff": the magic, frame index
+// (u32), number of skeletons (u16), number of boxes (u16), the skeletons,
+// their confidences (133 u8 each, 255 being 1) and the boxes as in v1. A
+// skeleton is the origin and step of x and y (4 f32) followed by 133 * 2 u16
+// levels, row major, i.e. `origin + level * step` over the range of its own
+// keypoints; 0xffff is a missing (non finite) keypoint. 689 bytes a person
+// with a box, instead of 1072.
+struct PoseView {
+	uint32_t frame_index;
+	uint32_t n_people;
+	uint32_t n_boxes;
+	// 1 or 2
+	uint32_t version;
+	// unaligned, as they follow the header; read through
+	// `aux_img_pose_view_decode` unless `version` is 1
+	const uint8_t *keypoints;
+	const uint8_t *boxes;
+	// v2 only
+	const uint8_t *confidences;
+};
+
+// the newest poses handed from one producer thread to one consumer thread
+// without locks; see `aux_img_pose_buffer_create`
+struct PoseBuffer;
+
+// poses read from a `PoseBuffer`, owned by it and valid until the next read
+struct PoseFrame {
+	uint32_t frame_index;
+	uint32_t n_people;
+	uint32_t n_boxes;
+	// published since the previous read; otherwise the same poses again
+	bool is_fresh;
+	const float *keypoints;
+	const uint16_t *boxes;
+};
+
+struct PoseBufferStats {
+	uint64_t published;
+	// published, then replaced before being read
+	uint64_t dropped;
+	uint64_t read_fresh;
 };
+
+// recent poses by frame index, to draw one for every camera frame when the
+// pose stream is slower or behind; see `aux_img_history_create`
+struct PoseHistory;
+
+enum class SampleKind : uint8_t {
+	// nothing close enough to the frame
+	None = 0,
+	// a snapshot of that very frame
+	Exact,
+	// between the two snapshots around the frame
+	Interpolated,
+	// past the newest snapshot, along the motion from the one before
+	Extrapolated,
+	// past the only snapshot, which is repeated
+	Held,
+};
+
+struct PoseSample {
+	uint32_t n_people;
+	uint32_t n_boxes;
+	SampleKind kind;
+};
+
+// a grid of `grid_cols` x `grid_rows` tiles of `tile_cols` x `tile_rows`
+// pixels, in `format`
+struct MosaicLayout {
+	uint16_t grid_cols;
+	uint16_t grid_rows;
+	uint16_t tile_cols;
+	uint16_t tile_rows;
+	OutputFormat format;
+};
+
+// the newest frame of many cameras, downsampled into the tiles of one
+// image; see `aux_img_mosaic_create`
+struct Mosaic;
 }
 
 
 extern "C" {
+// nothing is thrown through these functions. The ones taking a `SharedMat`
+// validate it on every call and report a failure by `aux_img_last_error`
+// only; prefer an `aux_img_canvas_*` handle on the hot path.
+//
+// `cv::FONT_HERSHEY_SIMPLEX` text; glyphs are rasterized once per (scale,
+// thickness) and recent strings are kept as masks, so repeated labels are a
+// masked copy. Glyphs land on whole pixels, which could differ from
+// `cv::putText` by a pixel. `bottomLeftOrigin` goes through `cv::putText`.
 void aux_img_put_text_impl(aux_img::SharedMat mat,
 						   const char *text,
 						   aux_img::Vec2i pos,
 						   aux_img::Vec3d color,
 						   double scale,
 						   int thickness,
-						   bool bottomLeftOrigin);
+						   bool bottomLeftOrigin) noexcept;
 // caller should check the length of data to be
 // 133 * 2 * sizeof(float) = 1064 bytes
 // expecting row-major order
@@ -110,6 +369,292 @@ void aux_img_put_text_impl(aux_img::SharedMat mat,
 //
 // This function will trust the caller and not check the length,
 // but take whatever is passed to it.
-void aux_img_draw_whole_body_skeleton_impl(aux_img::SharedMat mat, const float *data, aux_img::DrawSkeletonOptions options);
-void aux_img_rectangle_impl(aux_img::SharedMat mat, aux_img::Vec2i start, aux_img::Vec2i end, aux_img::Vec3d color, int thickness);
+void aux_img_draw_whole_body_skeleton_impl(aux_img::SharedMat mat, const float *data, aux_img::DrawSkeletonOptions options) noexcept;
+void aux_img_rectangle_impl(aux_img::SharedMat mat, aux_img::Vec2i start, aux_img::Vec2i end, aux_img::Vec3d color, int thickness) noexcept;
+// draw every skeleton and bounding box of a frame in one call
+//
+// keypoints: `n_people` skeletons, contiguous, each 133 * 2 floats in the
+// layout given by `options.skeleton.layout` (`[dynamic]Skeleton` in Odin)
+// boxes: `n_boxes` boxes, contiguous, each [x1, y1, x2, y2]
+// (`[dynamic]BoundingBox` in Odin)
+//
+// the `cv::Mat` header is built once and reused for all primitives
+//
+// stats: optional, filled with the culling statistics of the call
+void aux_img_draw_poses_batch_impl(aux_img::SharedMat mat,
+								   const float *keypoints,
+								   size_t n_people,
+								   const uint16_t *boxes,
+								   size_t n_boxes,
+								   aux_img::DrawPosesOptions options,
+								   aux_img::CullStats *stats) noexcept;
+// 8 bit, 3 channel targets use a dedicated span rasterizer for filled
+// landmarks and thick bones by default; disable it to always go through
+// OpenCV (e.g. to compare the outputs)
+void aux_img_set_fast_raster(bool enabled) noexcept;
+// the geometry-only counterparts of `aux_img_draw_whole_body_skeleton_impl`,
+// `aux_img_rectangle_impl` and `aux_img_draw_poses_batch_impl`
+//
+// nothing is rasterized; bones are appended as segments, landmarks as discs
+// and boxes as quads, with unrounded coordinates. Return `false` (and append
+// nothing) if `out` does not have enough room left. The level of detail and
+// culling are not applied, as there is no frame to cull against.
+bool aux_img_export_whole_body_skeleton(const float *data, aux_img::DrawSkeletonOptions options, aux_img::GeometryBuffer *out) noexcept;
+bool aux_img_export_rectangle(aux_img::Vec2i start, aux_img::Vec2i end, aux_img::Vec3d color, int thickness, aux_img::GeometryBuffer *out) noexcept;
+bool aux_img_export_poses_batch(const float *keypoints,
+								size_t n_people,
+								const uint16_t *boxes,
+								size_t n_boxes,
+								aux_img::DrawPosesOptions options,
+								aux_img::GeometryBuffer *out) noexcept;
+// rasterize an exported buffer with OpenCV, i.e. segments, then discs, then
+// quads. Coordinates are truncated like the drawing functions do, so for a
+// single person this matches `aux_img_draw_whole_body_skeleton_impl`; with
+// several people only the stacking order of overlapping primitives differs.
+void aux_img_rasterize_geometry(aux_img::SharedMat mat, const aux_img::GeometryBuffer *geometry) noexcept;
+// opt-in parallel drawing
+//
+// with `n_threads > 1`, skeletons, rectangles and text are binned into
+// horizontal bands of the image, which are rasterized concurrently on a
+// persistent pool owned by the library (the calling thread included). The
+// output does not depend on the thread count. `n_threads <= 1` goes back to
+// drawing on the caller's thread only.
+void aux_img_set_num_threads(int n_threads) noexcept;
+int aux_img_get_num_threads() noexcept;
+// the row step of a `CompositeTarget`, with rows padded to 4 bytes if
+// `is_row_aligned` (e.g. for the default `GL_UNPACK_ALIGNMENT`)
+size_t aux_img_composite_step(uint16_t cols, aux_img::OutputFormat format, bool is_row_aligned) noexcept;
+// copy `src` into `dst` and draw the poses on top, in one pass over the frame
+//
+// the frame is walked in bands of rows: each band is converted into the
+// output format and, if any primitive touches it, drawn on while still in
+// cache. Bands without primitives are written with non-temporal stores.
+// Equivalent to a copy followed by `aux_img_draw_poses_batch_impl`, with the
+// colors (given in BGR) written in the order of `dst.format`. `src` must be
+// 8 bit RGB, BGR, RGBA, BGRA or GRAY; `n_people`/`n_boxes` may be 0.
+void aux_img_composite_poses_impl(aux_img::SharedMat src,
+							 aux_img::CompositeTarget dst,
+							 const float *keypoints,
+							 size_t n_people,
+							 const uint16_t *boxes,
+							 size_t n_boxes,
+							 aux_img::DrawPosesOptions options,
+							 aux_img::CullStats *stats) noexcept;
+// `aux_img_composite_poses_impl` at the size of `dst`: the frame is scaled
+// first (area averaging when shrinking), in its own format, and the keypoints
+// and boxes are scaled along, so that the overlay is drawn at the preview
+// resolution with the radii and thicknesses of `options` in preview pixels.
+// Much less to convert, draw and upload than the full frame for a thumbnail;
+// `aux_img_composite_poses_impl` remains the full resolution path.
+aux_img::Status aux_img_preview_poses(aux_img::SharedMat src,
+									  aux_img::PreviewTarget dst,
+									  const float *keypoints,
+									  size_t n_people,
+									  const uint16_t *boxes,
+									  size_t n_boxes,
+									  aux_img::DrawPosesOptions options,
+									  aux_img::CullStats *stats) noexcept;
+// the factors from frame to preview coordinates, e.g. to place text drawn
+// on the preview afterwards
+aux_img::Vec2f aux_img_preview_scale(aux_img::SharedMat src, aux_img::PreviewTarget dst) noexcept;
+// the number of rendered strings kept by `aux_img_put_text_impl` (256 by
+// default); 0 keeps the glyphs only
+void aux_img_set_text_cache_capacity(size_t capacity) noexcept;
+
+// the message of the last failed call on this thread, or "" if none did
+const char *aux_img_last_error() noexcept;
+const char *aux_img_status_to_string(aux_img::Status status) noexcept;
+// validate `mat` once; drawing through the returned canvas only dereferences
+// it, reusing the `cv::Mat` header, the format dispatch and the skeleton
+// style (rebuilt only when the options or `aux_img_set_fast_raster` change)
+//
+// `*out` is left untouched on failure. A canvas is not thread safe, but the
+// library may still draw into it from its own pool.
+aux_img::Status aux_img_canvas_create(aux_img::SharedMat mat, aux_img::Canvas **out) noexcept;
+// `nullptr` is ignored
+void aux_img_canvas_destroy(aux_img::Canvas *canvas) noexcept;
+// point the canvas to the next frame, of the same shape and format
+aux_img::Status aux_img_canvas_set_data(aux_img::Canvas *canvas, uint8_t *data) noexcept;
+aux_img::Status aux_img_canvas_put_text(aux_img::Canvas *canvas,
+										const char *text,
+										aux_img::Vec2i pos,
+										aux_img::Vec3d color,
+										double scale,
+										int thickness,
+										bool bottomLeftOrigin) noexcept;
+aux_img::Status aux_img_canvas_rectangle(aux_img::Canvas *canvas, aux_img::Vec2i start, aux_img::Vec2i end, aux_img::Vec3d color, int thickness) noexcept;
+aux_img::Status aux_img_canvas_draw_whole_body_skeleton(aux_img::Canvas *canvas, const float *data, aux_img::DrawSkeletonOptions options) noexcept;
+aux_img::Status aux_img_canvas_draw_poses_batch(aux_img::Canvas *canvas,
+												const float *keypoints,
+												size_t n_people,
+												const uint16_t *boxes,
+												size_t n_boxes,
+												aux_img::DrawPosesOptions options,
+												aux_img::CullStats *stats) noexcept;
+// a list of draw commands, recorded now and drawn later, any number of times
+//
+// skeleton keypoints and text are copied into arenas of the list, which grow
+// geometrically and keep their capacity across `aux_img_cmdlist_clear`, so
+// recording allocates nothing once warmed up (or after
+// `aux_img_cmdlist_reserve`). A list is immutable while executed, and can be
+// replayed onto later frames, e.g. to keep showing the last known poses.
+aux_img::Status aux_img_cmdlist_create(aux_img::CommandList **out) noexcept;
+// `nullptr` is ignored
+void aux_img_cmdlist_destroy(aux_img::CommandList *list) noexcept;
+// drop every command, keeping the memory
+void aux_img_cmdlist_clear(aux_img::CommandList *list) noexcept;
+size_t aux_img_cmdlist_size(const aux_img::CommandList *list) noexcept;
+aux_img::Status aux_img_cmdlist_reserve(aux_img::CommandList *list, size_t n_commands, size_t n_people, size_t n_text_bytes) noexcept;
+// `data` as in `aux_img_draw_whole_body_skeleton_impl`, copied
+aux_img::Status aux_img_cmdlist_skeleton(aux_img::CommandList *list, const float *data, aux_img::DrawSkeletonOptions options) noexcept;
+// `keypoints`/`boxes` as in `aux_img_draw_poses_batch_impl`, copied
+aux_img::Status aux_img_cmdlist_poses_batch(aux_img::CommandList *list,
+											const float *keypoints,
+											size_t n_people,
+											const uint16_t *boxes,
+											size_t n_boxes,
+											aux_img::DrawPosesOptions options) noexcept;
+aux_img::Status aux_img_cmdlist_rectangle(aux_img::CommandList *list, aux_img::Vec2i start, aux_img::Vec2i end, aux_img::Vec3d color, int thickness) noexcept;
+aux_img::Status aux_img_cmdlist_line(aux_img::CommandList *list, aux_img::Vec2i start, aux_img::Vec2i end, aux_img::Vec3d color, int thickness) noexcept;
+aux_img::Status aux_img_cmdlist_circle(aux_img::CommandList *list, aux_img::Vec2i center, int radius, aux_img::Vec3d color, int thickness) noexcept;
+// top left origin only; `text` is copied
+aux_img::Status aux_img_cmdlist_put_text(aux_img::CommandList *list,
+										 const char *text,
+										 aux_img::Vec2i pos,
+										 aux_img::Vec3d color,
+										 double scale,
+										 int thickness) noexcept;
+// draw `list` into the frame of `canvas`
+//
+// skeletons come first, beneath everything else: consecutive ones sharing
+// their options are drawn as one batch, with the level of detail and culling
+// of those options. Lines, circles, rectangles and text follow in recording
+// order, in one pass: the ones missing the frame are dropped, and the rest
+// are binned into bands drawn on the pool of `aux_img_set_num_threads`. YUV
+// frames are resolved once for all of them.
+//
+// stats: optional, filled with the culling statistics of the skeletons
+aux_img::Status aux_img_canvas_execute(aux_img::Canvas *canvas, const aux_img::CommandList *list, aux_img::CullStats *stats) noexcept;
+// a ring of the last `capacity` (at least 2) pose snapshots, each of up to
+// `max_people` skeletons and boxes in `layout`, all allocated here
+//
+// not thread safe
+aux_img::Status aux_img_history_create(size_t capacity, size_t max_people, aux_img::Layout layout, aux_img::PoseHistory **out) noexcept;
+// `nullptr` is ignored
+void aux_img_history_destroy(aux_img::PoseHistory *history) noexcept;
+void aux_img_history_clear(aux_img::PoseHistory *history) noexcept;
+// copy the poses of `frame_index`, dropping people past `max_people`
+//
+// the same `frame_index` as the newest snapshot replaces it, and an older one
+// (a restarted producer) clears the history first
+aux_img::Status aux_img_history_push(aux_img::PoseHistory *history,
+									 uint32_t frame_index,
+									 const float *keypoints,
+									 size_t n_people,
+									 const uint16_t *boxes,
+									 size_t n_boxes) noexcept;
+// the poses at `frame_index`, into `keypoints`/`boxes` which must have room
+// for `max_people` each
+//
+// between two snapshots, the people of the nearer one are interpolated
+// towards the other, matched by the centroid of their body keypoints (boxes
+// by their center), nearest pairs first; unmatched ones are kept as they are.
+// Up to `max_extrapolation` frames past the newest snapshot, it is
+// extrapolated from the one before.
+aux_img::Status aux_img_history_sample(aux_img::PoseHistory *history,
+									   uint32_t frame_index,
+									   uint32_t max_extrapolation,
+									   float *keypoints,
+									   uint16_t *boxes,
+									   aux_img::PoseSample *out) noexcept;
+// check the header and the size of a pose message of either version, and
+// point `out` into it
+//
+// nothing is copied; the view is valid as long as `data` is, e.g. while the
+// ZMQ message holding it is open. Trailing bytes are ignored.
+aux_img::Status aux_img_pose_view_parse(const uint8_t *data, size_t size, aux_img::PoseView *out) noexcept;
+// every skeleton (133 * 2 floats, row major) and box of a view; a v2 message
+// is dequantized with SSE2/AVX2. `confidences` (133 each) may be null, and
+// are all 1 for v1
+aux_img::Status aux_img_pose_view_decode(const aux_img::PoseView *view, float *keypoints, uint16_t *boxes, float *confidences) noexcept;
+// the size of a v2 message
+size_t aux_img_pose_encoded_size(size_t n_people, size_t n_boxes) noexcept;
+// a v2 message of row major skeletons into `out`, of at least
+// `aux_img_pose_encoded_size` bytes; `confidences` may be null, i.e. all 1
+//
+// every axis of a skeleton is quantized to 1/65534 of its extent, e.g.
+// within 0.01 px for a person 1000 px tall
+aux_img::Status aux_img_pose_encode(uint32_t frame_index,
+									const float *keypoints,
+									const float *confidences,
+									size_t n_people,
+									const uint16_t *boxes,
+									size_t n_boxes,
+									uint8_t *out,
+									size_t capacity,
+									size_t *size) noexcept;
+// `aux_img_canvas_draw_poses_batch` and `aux_img_composite_poses_impl` on a
+// view; the keypoints are decoded into a staging buffer owned by the calling
+// thread, as floats may not be loaded from unaligned addresses. A view is row
+// major, so `options.skeleton.layout` is ignored.
+aux_img::Status aux_img_canvas_draw_pose_view(aux_img::Canvas *canvas,
+											  const aux_img::PoseView *view,
+											  aux_img::DrawPosesOptions options,
+											  aux_img::CullStats *stats) noexcept;
+aux_img::Status aux_img_composite_pose_view(aux_img::SharedMat src,
+											aux_img::CompositeTarget dst,
+											const aux_img::PoseView *view,
+											aux_img::DrawPosesOptions options,
+											aux_img::CullStats *stats) noexcept;
+// `aux_img_history_push` of a view, decoded straight into the ring; the view
+// is row major, and transposed for a `ColMajor` history
+aux_img::Status aux_img_history_push_view(aux_img::PoseHistory *history, const aux_img::PoseView *view) noexcept;
+// a triple buffer of up to `max_people` each, allocated once
+//
+// `write` and `write_view` may only be called from one thread, and `read`
+// from one other thread; neither blocks, allocates nor waits for the other.
+// A read returns the newest published poses, older ones it missed are
+// dropped.
+aux_img::Status aux_img_pose_buffer_create(size_t max_people, aux_img::PoseBuffer **out) noexcept;
+void aux_img_pose_buffer_destroy(aux_img::PoseBuffer *buffer) noexcept;
+aux_img::Status aux_img_pose_buffer_write(aux_img::PoseBuffer *buffer,
+										  uint32_t frame_index,
+										  const float *keypoints,
+										  size_t n_people,
+										  const uint16_t *boxes,
+										  size_t n_boxes) noexcept;
+aux_img::Status aux_img_pose_buffer_write_view(aux_img::PoseBuffer *buffer, const aux_img::PoseView *view) noexcept;
+aux_img::Status aux_img_pose_buffer_read(aux_img::PoseBuffer *buffer, aux_img::PoseFrame *out) noexcept;
+// counters, from any thread
+void aux_img_pose_buffer_stats(const aux_img::PoseBuffer *buffer, aux_img::PoseBufferStats *out) noexcept;
+// nanoseconds of `CLOCK_MONOTONIC`, the clock of every stage; the cv-mmap
+// producer stamps its sync messages with the same clock
+uint64_t aux_img_now_ns() noexcept;
+// disabled by default; the library records its own stages only when enabled
+void aux_img_set_latency_enabled(bool enabled) noexcept;
+// lock free, from any thread; ignored while disabled
+void aux_img_latency_record(aux_img::Stage stage, uint64_t ns) noexcept;
+void aux_img_latency_add_dropped(uint64_t n) noexcept;
+// p50/p99 (within 6.25%) and max of every stage since the last reset
+void aux_img_latency_report(aux_img::LatencyReport *out) noexcept;
+void aux_img_latency_reset() noexcept;
+// the image is allocated once, black, with rows padded to 4 bytes (see
+// `aux_img_composite_step`); tile `i` is at column `i % grid_cols` and row
+// `i / grid_cols`
+aux_img::Status aux_img_mosaic_create(aux_img::MosaicLayout layout, aux_img::Mosaic **out) noexcept;
+void aux_img_mosaic_destroy(aux_img::Mosaic *mosaic) noexcept;
+// make `frame` the newest of tile `index`: it is downsampled (area
+// averaging, aspect ratio kept) before returning, in stripes on the pool of
+// `aux_img_set_num_threads` and the calling thread, e.g. the one receiving
+// the frames, so `frame` only has to be valid during the call, as a shared
+// memory frame is during its callback. Callable from any thread. 8 bit RGB,
+// BGR, RGBA, BGRA or GRAY.
+aux_img::Status aux_img_mosaic_set_frame(aux_img::Mosaic *mosaic, size_t index, aux_img::SharedMat frame) noexcept;
+// convert into the image the newest downsample of every tile which got one
+// since the previous call, tiles running concurrently on the pool of
+// `aux_img_set_num_threads`. From one thread at a time; the number of tiles
+// drawn goes to `n_updated` if not `nullptr`.
+aux_img::Status aux_img_mosaic_compose(aux_img::Mosaic *mosaic, size_t *n_updated) noexcept;
+// the image, written by `aux_img_mosaic_compose` only
+aux_img::CompositeTarget aux_img_mosaic_image(aux_img::Mosaic *mosaic) noexcept;
 }
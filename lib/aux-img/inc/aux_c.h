@@ -15,6 +15,8 @@ enum AuxImgPixelFormat : uint8_t {
 	AUX_IMG_PIXEL_FORMAT_GRAY,
 	AUX_IMG_PIXEL_FORMAT_YUV,
 	AUX_IMG_PIXEL_FORMAT_YUYV,
+	AUX_IMG_PIXEL_FORMAT_NV12,
+	AUX_IMG_PIXEL_FORMAT_I420,
 };
 
 enum AuxImgDepth : uint8_t {
@@ -1,27 +1,31 @@
 package info
 import auximg ".."
 import "core:c"
-import "core:encoding/endian"
-import "core:fmt"
 import "core:log"
-import "core:strings"
+import "core:math"
 
 NUM_KEYPOINTS :: auximg.NUM_KEYPOINTS
 
 BoundingBox :: [4]u16
 Skeleton :: [NUM_KEYPOINTS * 2]f32
+// in [0, 1], per keypoint
+Confidences :: [NUM_KEYPOINTS]f32
 
 PoseInfo :: struct {
 	frame_index:  u32,
 	keypoints:    [dynamic]Skeleton,
 	bounding_box: [dynamic]BoundingBox,
+	// one per skeleton, or empty if the message had none
+	confidences:  [dynamic]Confidences,
 }
 
 destroy :: proc(info: ^PoseInfo) {
 	delete(info.keypoints)
 	delete(info.bounding_box)
+	delete(info.confidences)
 	info.keypoints = nil
 	info.bounding_box = nil
+	info.confidences = nil
 }
 
 clone :: proc(info: PoseInfo) -> PoseInfo {
@@ -31,86 +35,71 @@ clone :: proc(info: PoseInfo) -> PoseInfo {
 	bounding_box_copy := make([dynamic]BoundingBox, len(info.bounding_box))
 	copy(bounding_box_copy[:], info.bounding_box[:])
 
-	return PoseInfo{info.frame_index, keypoints_copy, bounding_box_copy}
+	confidences_copy: [dynamic]Confidences = nil
+	if len(info.confidences) != 0 {
+		confidences_copy = make([dynamic]Confidences, len(info.confidences))
+		copy(confidences_copy[:], info.confidences[:])
+	}
+
+	return PoseInfo{info.frame_index, keypoints_copy, bounding_box_copy, confidences_copy}
 }
 
+PoseView :: auximg.PoseView
+
+// `unmarshal` without copying: the view points into `data` and is valid as
+// long as it is
+parse_view :: proc(data: []u8) -> (view: PoseView, ok: bool) {
+	status := auximg.pose_view_parse(raw_data(data), c.size_t(len(data)), &view)
+	return view, status == .Ok
+}
+
+// either wire version, see `auximg.PoseView`; `confidences` is left empty
+// for v1, which carries none
 unmarshal :: proc(data: []u8) -> (info: PoseInfo, ok: bool) {
-	MIN_SIZE :: 4 + 1 + 1
-	info = PoseInfo{}
-	ok = true
-	if len(data) < MIN_SIZE {
-		ok = false
-		return
+	view := parse_view(data) or_return
+	info.frame_index = view.frame_index
+	info.keypoints = make([dynamic]Skeleton, view.n_people)
+	info.bounding_box = make([dynamic]BoundingBox, view.n_boxes)
+	if view.version >= 2 {
+		info.confidences = make([dynamic]Confidences, view.n_people)
 	}
-	frame_index: u32
-	rest := data
-	frame_index, ok = endian.get_u32(rest[:4], .Little)
-	if !ok {
-		return
+	status := auximg.pose_view_decode(
+		&view,
+		cast([^]c.float)raw_data(info.keypoints),
+		cast([^]u16)raw_data(info.bounding_box),
+		cast([^]c.float)raw_data(info.confidences),
+	)
+	if status != .Ok {
+		destroy(&info)
+		return PoseInfo{}, false
 	}
-	rest = rest[4:]
-
-	num_keypoints := rest[0]
-	rest = rest[1:]
-
-	num_boxes := rest[0]
-	rest = rest[1:]
+	return info, true
+}
 
-	keypoints: [dynamic]Skeleton = nil
-	if num_keypoints != 0 {
-		KP_SIZE_PER_UNIT :: NUM_KEYPOINTS * 2 * size_of(f32)
-		if len(rest) < int(num_keypoints) * KP_SIZE_PER_UNIT {
-			ok = false
-			return
-		}
-		keypoints = make([dynamic]Skeleton, num_keypoints)
-		defer {
-			if !ok {
-				delete(keypoints)
-			}
-		}
-		for i in 0 ..< num_keypoints {
-			rest_ptr := ([^]u8)(raw_data(rest))
-			kp_ptr := ([^]u8)(&keypoints[i])
-			r := rest_ptr[:KP_SIZE_PER_UNIT]
-			k := kp_ptr[:KP_SIZE_PER_UNIT]
-			copy(k, r)
-			rest = rest[KP_SIZE_PER_UNIT:]
-		}
+// `info` as a v2 message, allocated with `allocator`; confidences of 1 if
+// `info` has none
+marshal :: proc(info: PoseInfo, allocator := context.allocator) -> (data: []u8, ok: bool) {
+	if len(info.confidences) != 0 && len(info.confidences) != len(info.keypoints) {
+		return nil, false
 	}
-	bounding_box: [dynamic]BoundingBox = nil
-	print_as_hex :: proc(index: int, data: []u8) {
-		b, err := strings.builder_make_none()
-		defer strings.builder_destroy(&b)
-		for d in data {
-			fmt.sbprintf(&b, "{:02x} ", d)
-		}
-		s := string(b.buf[:])
-		log.debugf("index={}, data={}", index, s)
+	data = make([]u8, auximg.pose_encoded_size(c.size_t(len(info.keypoints)), c.size_t(len(info.bounding_box))), allocator)
+	size: c.size_t
+	status := auximg.pose_encode(
+		info.frame_index,
+		cast([^]c.float)raw_data(info.keypoints),
+		cast([^]c.float)raw_data(info.confidences),
+		c.size_t(len(info.keypoints)),
+		cast([^]u16)raw_data(info.bounding_box),
+		c.size_t(len(info.bounding_box)),
+		raw_data(data),
+		c.size_t(len(data)),
+		&size,
+	)
+	if status != .Ok {
+		delete(data, allocator)
+		return nil, false
 	}
-	if num_boxes != 0 {
-		BB_SIZE_PER_UNIT :: 4 * size_of(u16)
-		if len(rest) < int(num_boxes) * BB_SIZE_PER_UNIT {
-			ok = false
-			return
-		}
-		bounding_box = make([dynamic]BoundingBox, num_boxes)
-		defer {
-			if !ok {
-				delete(bounding_box)
-			}
-		}
-		for i in 0 ..< num_boxes {
-			rest_ptr := ([^]u8)(raw_data(rest))
-			bb_ptr := ([^]u8)(&bounding_box[i])
-			r := rest_ptr[:BB_SIZE_PER_UNIT]
-			b := bb_ptr[:BB_SIZE_PER_UNIT]
-			copy(b, r)
-			rest = rest[BB_SIZE_PER_UNIT:]
-		}
-	}
-	info = PoseInfo{frame_index, keypoints, bounding_box}
-	return
+	return data[:size], true
 }
 
 DrawPoseOptions :: struct {
@@ -119,36 +108,207 @@ DrawPoseOptions :: struct {
 	bone_thickness:         int,
 	bounding_box_thickness: int,
 	bounding_box_color:     [3]c.double,
+	// see `auximg.DrawSkeletonOptions`
+	face_min_height:        int,
+	hand_min_height:        int,
+	is_cull:                bool,
 }
 
-draw :: proc(mat: auximg.SharedMat, info: ^PoseInfo, opts: DrawPoseOptions) {
+// sizes for an image scaled by `scale`, e.g. a preview, so that the overlay
+// looks as it would on the frame scaled afterwards; lines stay at least a
+// pixel wide, and a negative (filled) thickness stays as it is
+scale_draw_options :: proc(opts: DrawPoseOptions, scale: f32) -> DrawPoseOptions {
+	scaled :: proc(v: int, scale: f32) -> int {
+		if v <= 0 {
+			return v
+		}
+		return max(1, int(math.round(f32(v) * scale)))
+	}
+	out := opts
+	out.landmark_radius = scaled(opts.landmark_radius, scale)
+	out.landmark_thickness = scaled(opts.landmark_thickness, scale)
+	out.bone_thickness = scaled(opts.bone_thickness, scale)
+	out.bounding_box_thickness = scaled(opts.bounding_box_thickness, scale)
+	out.face_min_height = int(f32(opts.face_min_height) * scale)
+	out.hand_min_height = int(f32(opts.hand_min_height) * scale)
+	return out
+}
+
+to_draw_poses_options :: proc(opts: DrawPoseOptions) -> auximg.DrawPosesOptions {
+	return auximg.DrawPosesOptions {
+		skeleton = auximg.DrawSkeletonOptions {
+			layout = auximg.Layout.RowMajor,
+			is_draw_landmarks = true,
+			is_draw_bones = true,
+			landmark_radius = c.int(opts.landmark_radius),
+			landmark_thickness = c.int(opts.landmark_thickness),
+			bone_thickness = c.int(opts.bone_thickness),
+			face_min_height = c.int(opts.face_min_height),
+			hand_min_height = c.int(opts.hand_min_height),
+			is_cull = opts.is_cull,
+		},
+		bounding_box_color = auximg.Vec3d {
+			opts.bounding_box_color[0],
+			opts.bounding_box_color[1],
+			opts.bounding_box_color[2],
+		},
+		bounding_box_thickness = c.int(opts.bounding_box_thickness),
+	}
+}
+
+draw :: proc(mat: auximg.SharedMat, info: ^PoseInfo, opts: DrawPoseOptions) -> (stats: auximg.CullStats) {
 	if info == nil {
 		return
 	}
+	// kps is row major. i.e. [NUM_KEYPOINTS_PAIR][2]f32
+	// bb is [x1, y1, x2, y2]
+	return auximg.draw_poses_batch(mat, info.keypoints[:], info.bounding_box[:], to_draw_poses_options(opts))
+}
 
-	skt_opts := auximg.DrawSkeletonOptions {
-		auximg.Layout.RowMajor,
-		true,
-		true,
-		c.int(opts.landmark_radius),
-		c.int(opts.landmark_thickness),
-		c.int(opts.bone_thickness),
+// `draw` through a canvas created for the frame, see `auximg.canvas_create`
+draw_on_canvas :: proc(
+	canvas: auximg.Canvas,
+	info: ^PoseInfo,
+	opts: DrawPoseOptions,
+) -> (
+	stats: auximg.CullStats,
+	status: auximg.Status,
+) {
+	if info == nil {
+		return
 	}
-	for &kps in info.keypoints {
-		// kps is row major. i.e. [NUM_KEYPOINTS_PAIR][2]f32
-		auximg.draw_whole_body_skeleton(mat, kps[:], skt_opts)
+	return auximg.canvas_draw_poses(canvas, info.keypoints[:], info.bounding_box[:], to_draw_poses_options(opts))
+}
+
+// copy `src` into `dst` with the poses of `info` drawn on top; a nil `info`
+// only copies
+composite :: proc(
+	src: auximg.SharedMat,
+	dst: auximg.CompositeTarget,
+	info: ^PoseInfo,
+	opts: DrawPoseOptions,
+) -> (
+	stats: auximg.CullStats,
+) {
+	batch_opts := to_draw_poses_options(opts)
+	if info == nil {
+		return auximg.composite_poses(src, dst, nil, nil, batch_opts)
+	}
+	return auximg.composite_poses(src, dst, info.keypoints[:], info.bounding_box[:], batch_opts)
+}
+
+// `composite` at the size of `dst`, with the poses scaled along
+preview :: proc(
+	src: auximg.SharedMat,
+	dst: auximg.PreviewTarget,
+	info: ^PoseInfo,
+	opts: DrawPoseOptions,
+) -> (
+	stats: auximg.CullStats,
+	status: auximg.Status,
+) {
+	batch_opts := to_draw_poses_options(opts)
+	if info == nil {
+		return auximg.preview_poses_slice(src, dst, nil, nil, batch_opts)
+	}
+	return auximg.preview_poses_slice(src, dst, info.keypoints[:], info.bounding_box[:], batch_opts)
+}
+
+// `composite` of a view, see `parse_view`
+composite_view :: proc(
+	src: auximg.SharedMat,
+	dst: auximg.CompositeTarget,
+	view: ^PoseView,
+	opts: DrawPoseOptions,
+) -> (
+	stats: auximg.CullStats,
+	status: auximg.Status,
+) {
+	status = auximg.composite_pose_view(src, dst, view, to_draw_poses_options(opts), &stats)
+	return
+}
+
+// recent poses, sampled at the frame being shown; see `auximg.history_sample`
+History :: struct {
+	handle:     auximg.PoseHistory,
+	max_people: int,
+	// where samples are written, with room for `max_people` allocated once
+	sample:     PoseInfo,
+}
+
+history_make :: proc(capacity: int, max_people: int) -> (history: History, ok: bool) {
+	status := auximg.history_create(
+		c.size_t(capacity),
+		c.size_t(max_people),
+		.RowMajor,
+		&history.handle,
+	)
+	if status != .Ok {
+		log.errorf("failed to create pose history: {}", auximg.last_error())
+		return history, false
 	}
+	history.max_people = max_people
+	history.sample.keypoints = make([dynamic]Skeleton, max_people)
+	history.sample.bounding_box = make([dynamic]BoundingBox, max_people)
+	return history, true
+}
+
+history_destroy :: proc(history: ^History) {
+	auximg.history_destroy(history.handle)
+	destroy(&history.sample)
+	history.handle = nil
+}
+
+history_push :: proc(history: ^History, info: PoseInfo) -> bool {
+	status := auximg.history_push(
+		history.handle,
+		info.frame_index,
+		cast([^]c.float)raw_data(info.keypoints),
+		c.size_t(len(info.keypoints)),
+		cast([^]u16)raw_data(info.bounding_box),
+		c.size_t(len(info.bounding_box)),
+	)
+	return status == .Ok
+}
+
+// `history_push` straight from a received message, see `parse_view`
+history_push_view :: proc(history: ^History, view: ^PoseView) -> bool {
+	return auximg.history_push_view(history.handle, view) == .Ok
+}
+
+// `history_push` of what was read from a `auximg.PoseBuffer`
+history_push_frame :: proc(history: ^History, frame: ^auximg.PoseFrame) -> bool {
+	status := auximg.history_push(
+		history.handle,
+		frame.frame_index,
+		frame.keypoints,
+		c.size_t(frame.n_people),
+		frame.boxes,
+		c.size_t(frame.n_boxes),
+	)
+	return status == .Ok
+}
 
-	for &bb in info.bounding_box {
-		// bb is [x1, y1, x2, y2]
-		pt1 := [2]c.int{c.int(bb[0]), c.int(bb[1])}
-		pt2 := [2]c.int{c.int(bb[2]), c.int(bb[3])}
-		auximg.rectangle(
-			mat,
-			pt1,
-			pt2,
-			opts.bounding_box_color,
-			c.int(opts.bounding_box_thickness),
-		)
+// the poses at `frame_index`, valid until the next sample; nil if there is
+// nothing close enough
+history_sample :: proc(history: ^History, frame_index: u32, max_extrapolation: u32) -> ^PoseInfo {
+	// within the capacity allocated by `history_make`
+	resize(&history.sample.keypoints, history.max_people)
+	resize(&history.sample.bounding_box, history.max_people)
+	sample: auximg.PoseSample
+	status := auximg.history_sample(
+		history.handle,
+		frame_index,
+		max_extrapolation,
+		cast([^]c.float)raw_data(history.sample.keypoints),
+		cast([^]u16)raw_data(history.sample.bounding_box),
+		&sample,
+	)
+	if status != .Ok || sample.kind == .None {
+		return nil
 	}
+	resize(&history.sample.keypoints, int(sample.n_people))
+	resize(&history.sample.bounding_box, int(sample.n_boxes))
+	history.sample.frame_index = frame_index
+	return &history.sample
 }
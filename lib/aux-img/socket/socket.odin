@@ -1,5 +1,6 @@
 package socket
 
+import "../../../components/reactor"
 import zmq "../../odin-zeromq"
 import info "../info"
 import "core:log"
@@ -10,6 +11,14 @@ PoseInfo :: info.PoseInfo
 Thread :: thread.Thread
 // Returns true if the `PoseInfo` is moved (the callback won't free `PoseInfo` in this case, otherwise it will)
 OnInfo_Proc :: proc(info: PoseInfo, user_data: rawptr) -> (is_moved: bool)
+PoseView :: info.PoseView
+// Called with a view into the received message, which is closed when the
+// callback returns; nothing is copied or allocated. Takes precedence over
+// `on_info`.
+OnView_Proc :: proc(view: ^PoseView, user_data: rawptr)
+// Called with every message as received, before `on_view` or `on_info`
+// (e.g. to record it); the bytes are only valid during the call.
+OnMessage_Proc :: proc(data: []u8, user_data: rawptr)
 ZmqError :: zmq.ZmqError
 
 AuxImgClient :: struct {
@@ -17,12 +26,15 @@ AuxImgClient :: struct {
 	_zmq_ctx:          ^zmq.Context,
 	_is_owned_zmq_ctx: bool,
 	_zmq_sock:         ^zmq.Socket,
-	_polling_task:     Maybe(^Thread),
+	_reactor:          ^reactor.Reactor,
+	_is_owned_reactor: bool,
 	_is_running:       bool,
 	_has_init:         bool,
 	// callbacks
 	user_data:         rawptr,
 	on_info:           OnInfo_Proc,
+	on_view:           OnView_Proc,
+	on_message:        OnMessage_Proc,
 }
 
 create :: proc(zmq_addr: string, zmq_ctx: ^zmq.Context = nil) -> ^AuxImgClient {
@@ -34,12 +46,15 @@ create :: proc(zmq_addr: string, zmq_ctx: ^zmq.Context = nil) -> ^AuxImgClient {
 	client._zmq_ctx = ctx
 	client._is_owned_zmq_ctx = is_owned_zmq_ctx
 	client._zmq_sock = zmq.socket(ctx, zmq.SUB)
-	client._polling_task = nil
+	client._reactor = nil
+	client._is_owned_reactor = false
 	client._is_running = false
 	client._has_init = false
 
 	client.user_data = nil
 	client.on_info = nil
+	client.on_view = nil
+	client.on_message = nil
 	return client
 }
 
@@ -80,12 +95,6 @@ init :: proc(self: ^AuxImgClient) -> AuxImgError {
 	if code != 0 {
 		return ZmqError{code, "setsockopt_bool"}
 	}
-	// Let recv() time out so the thread can exit when _is_running becomes false
-	code = cast(int)zmq.setsockopt_int(self._zmq_sock, zmq.RCVTIMEO, 100) // 100 ms
-	if code != 0 {
-		return ZmqError{code, "setsockopt_int(RCVTIMEO)"}
-	}
-
 	// Connect to the ZMQ socket
 	code = cast(int)zmq.bind(self._zmq_sock, zmq_addr_c)
 	if code != 0 {
@@ -103,9 +112,10 @@ init :: proc(self: ^AuxImgClient) -> AuxImgError {
 	return nil
 }
 
+// one message, called by the reactor once the socket is readable
 @(private)
-_polling_task :: proc(t: ^Thread) {
-	client := cast(^AuxImgClient)t.data
+_on_readable :: proc(skt: ^zmq.Socket, user_data: rawptr) {
+	client := cast(^AuxImgClient)user_data
 
 	recv_data :: proc(skt: ^zmq.Socket) -> ([]u8, bool) {
 		msg := zmq.Message{}
@@ -120,30 +130,58 @@ _polling_task :: proc(t: ^Thread) {
 		return data_copy, true
 	}
 
-	for client._is_running {
-		data, ok := recv_data(client._zmq_sock)
+	// the view only lives as long as `msg`
+	recv_view :: proc(client: ^AuxImgClient, skt: ^zmq.Socket) {
+		msg := zmq.Message{}
+		data, ok := zmq.recv_msg_bytes(&msg, skt)
+		defer zmq.msg_close(&msg)
 		if !ok {
-			continue
+			return
 		}
-		defer delete(data)
-
-		pose_info, unmarshal_ok := info.unmarshal(data)
-		if !unmarshal_ok {
-			log.errorf("failed to unmarshal pose info")
-			continue
-		}
-
-		is_moved := false
-		if client.on_info != nil {
-			is_moved = client.on_info(pose_info, client.user_data)
+		if client.on_message != nil {
+			client.on_message(data, client.user_data)
 		}
-		if !is_moved {
-			info.destroy(&pose_info)
+		view, view_ok := info.parse_view(data)
+		if !view_ok {
+			log.errorf("failed to parse pose info")
+			return
 		}
+		client.on_view(&view, client.user_data)
+	}
+
+	if client.on_view != nil {
+		recv_view(client, skt)
+		return
+	}
+	data, ok := recv_data(skt)
+	if !ok {
+		return
+	}
+	defer delete(data)
+	if client.on_message != nil {
+		client.on_message(data, client.user_data)
+	}
+
+	pose_info, unmarshal_ok := info.unmarshal(data)
+	if !unmarshal_ok {
+		log.errorf("failed to unmarshal pose info")
+		return
+	}
+
+	is_moved := false
+	if client.on_info != nil {
+		is_moved = client.on_info(pose_info, client.user_data)
+	}
+	if !is_moved {
+		info.destroy(&pose_info)
 	}
 }
 
-start :: proc(self: ^AuxImgClient, init_context := context) -> (err: AuxImgError) {
+// receive on `shared`, or on a reactor of its own if `nil`
+//
+// a shared reactor is started by the caller after every `start` (sockets
+// are added while it is stopped), and stopped before any `stop`
+start :: proc(self: ^AuxImgClient, shared: ^reactor.Reactor = nil, init_context := context) -> (err: AuxImgError) {
 	if !self._has_init {
 		return StateError.NeverInitialized
 	}
@@ -151,11 +189,12 @@ start :: proc(self: ^AuxImgClient, init_context := context) -> (err: AuxImgError
 		return StateError.AlreadyRunning
 	}
 	self._is_running = true
-	task := thread.create(_polling_task)
-	task.data = self
-	task.init_context = init_context
-	thread.start(task)
-	self._polling_task = task
+	self._is_owned_reactor = shared == nil
+	self._reactor = shared if shared != nil else reactor.create()
+	reactor.add(self._reactor, self._zmq_sock, _on_readable, self)
+	if self._is_owned_reactor {
+		reactor.start(self._reactor, init_context)
+	}
 	return nil
 }
 
@@ -167,11 +206,13 @@ stop :: proc(self: ^AuxImgClient) {
 		return
 	}
 	self._is_running = false
-	if task, ok := self._polling_task.?; ok {
-		thread.join(task)
-		thread.destroy(task)
-		self._polling_task = nil
+	if self._is_owned_reactor {
+		reactor.destroy(self._reactor)
+	} else {
+		assert(!reactor.is_running(self._reactor), "the shared reactor is stopped before the client")
+		reactor.remove(self._reactor, self._zmq_sock)
 	}
+	self._reactor = nil
 	// now it is safe to close the socket
 	if self._zmq_sock != nil {
 		zmq.close(self._zmq_sock)
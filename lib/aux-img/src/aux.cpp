@@ -1,9 +1,16 @@
 #include <cstdint>
 #include <format>
+#include <span>
 #include <opencv2/core.hpp>
 #include <opencv2/imgproc.hpp>
 #include <stdexcept>
 #include <aux.hpp>
+#include "band.hpp"
+#include "pool.hpp"
+#include "status.hpp"
+#include "target.hpp"
+#include "text.hpp"
+#include "yuv.hpp"
 
 
 namespace aux_img {
@@ -50,6 +57,10 @@ const char *pixel_format_to_string(const PixelFormat fmt) {
 		return "YUV";
 	case PixelFormat::YUYV:
 		return "YUYV";
+	case PixelFormat::NV12:
+		return "NV12";
+	case PixelFormat::I420:
+		return "I420";
 	default:
 		return "unknown";
 	}
@@ -93,21 +104,101 @@ cv::Mat fromSharedMat(SharedMat sharedMat) {
 	auto format = opencv_format_from_pixel_format(sharedMat.pixel_format, sharedMat.depth);
 	return cv::Mat(sharedMat.rows, sharedMat.cols, format, sharedMat.data);
 }
+
+Target::Target(SharedMat shared) : shared(shared), is_yuv(yuv::is_yuv(shared.pixel_format)) {
+	if (shared.data == nullptr) {
+		throw std::invalid_argument("data == nullptr");
+	}
+	if (is_yuv) {
+		yuv::validate(shared);
+	} else {
+		mat = fromSharedMat(shared);
+	}
+}
+
+void Target::rebind(uint8_t *data) {
+	if (data == nullptr) {
+		throw std::invalid_argument("data == nullptr");
+	}
+	shared.data = data;
+	if (!is_yuv) {
+		mat = cv::Mat(mat.rows, mat.cols, mat.type(), data);
+	}
 }
 
-extern "C" {
 // https://docs.opencv.org/4.x/d6/d6e/group__imgproc__draw.html#ga5126f47f883d730f633d74f07456c576
-void aux_img_put_text_impl(aux_img::SharedMat mat, const char *text, aux_img::Vec2i pos, aux_img::Vec3d color, double scale, int thickness, bool bottomLeftOrigin) {
-	cv::Mat cv_mat = aux_img::fromSharedMat(mat);
-	auto cv_org    = cv::Point(pos.x, pos.y);
-	auto cv_color  = cv::Scalar(color.x, color.y, color.z);
-	cv::putText(cv_mat, text, cv_org, cv::FONT_HERSHEY_SIMPLEX, scale, cv_color, thickness, cv::LINE_8, bottomLeftOrigin);
+void put_text(Target &target, const char *text, cv::Point org, const cv::Scalar &color, double scale, int thickness, bool bottomLeftOrigin) {
+	if (text == nullptr) {
+		throw std::invalid_argument("text == nullptr");
+	}
+	if (target.is_yuv) {
+		yuv::Overlay overlay(target.shared);
+		const auto label_color = overlay.label_of(color);
+		if (bottomLeftOrigin) {
+			int baseline    = 0;
+			const auto size = cv::getTextSize(text, cv::FONT_HERSHEY_SIMPLEX, scale, thickness, &baseline);
+			cv::putText(overlay.labels(), text, org, cv::FONT_HERSHEY_SIMPLEX, scale, label_color, thickness, cv::LINE_8, bottomLeftOrigin);
+			overlay.resolve(cv::Rect(org.x - thickness, org.y - baseline - thickness, size.width + 2 * thickness, size.height + baseline + 2 * thickness));
+		} else {
+			const auto label = text::label(text, scale, thickness);
+			text::blit(overlay.labels(), *label, org, label_color);
+			overlay.resolve(cv::Rect(org + label->offset, label->mask.size()));
+		}
+		return;
+	}
+	auto &mat = target.mat;
+	if (bottomLeftOrigin) {
+		// upside down text is rare; not worth caching
+		cv::putText(mat, text, org, cv::FONT_HERSHEY_SIMPLEX, scale, color, thickness, cv::LINE_8, bottomLeftOrigin);
+		return;
+	}
+	const auto label = text::label(text, scale, thickness);
+	if (auto pool = shared_pool(); pool != nullptr) {
+		const int top     = org.y + label->offset.y;
+		const auto extent = band::extent_of(top, top + label->mask.rows - 1, 0);
+		band::render(*pool, mat, std::span(&extent, 1), [&](cv::Mat &roi, int band_y, uint32_t) {
+			text::blit(roi, *label, org, color, band_y);
+		});
+		return;
+	}
+	text::blit(mat, *label, org, color);
+}
+
+void rectangle(Target &target, cv::Point start, cv::Point end, const cv::Scalar &color, int thickness) {
+	const int pad = thickness > 0 ? (thickness + 1) / 2 + 1 : 0;
+	if (target.is_yuv) {
+		yuv::Overlay overlay(target.shared);
+		cv::rectangle(overlay.labels(), start, end, overlay.label_of(color), thickness);
+		const auto bounds = cv::Rect(start, end);
+		overlay.resolve(cv::Rect(bounds.x - pad, bounds.y - pad, bounds.width + 2 * pad + 1, bounds.height + 2 * pad + 1));
+		return;
+	}
+	auto &mat = target.mat;
+	if (auto pool = shared_pool(); pool != nullptr) {
+		const auto extent = band::extent_of(start.y, end.y, pad);
+		band::render(*pool, mat, std::span(&extent, 1), [&](cv::Mat &roi, int band_y, uint32_t) {
+			// axis aligned, so even thin edges clip to the band exactly
+			const auto offset = cv::Point(0, band_y);
+			cv::rectangle(roi, start - offset, end - offset, color, thickness);
+		});
+		return;
+	}
+	cv::rectangle(mat, start, end, color, thickness);
+}
+}
+
+extern "C" {
+void aux_img_put_text_impl(aux_img::SharedMat mat, const char *text, aux_img::Vec2i pos, aux_img::Vec3d color, double scale, int thickness, bool bottomLeftOrigin) noexcept {
+	aux_img::guard([&] {
+		auto target = aux_img::Target(mat);
+		aux_img::put_text(target, text, cv::Point(pos.x, pos.y), cv::Scalar(color.x, color.y, color.z), scale, thickness, bottomLeftOrigin);
+	});
 }
 
-void aux_img_rectangle_impl(aux_img::SharedMat mat, aux_img::Vec2i start, aux_img::Vec2i end, aux_img::Vec3d color, int thickness) {
-	cv::rectangle(aux_img::fromSharedMat(mat),
-				  cv::Point(start.x, start.y), cv::Point(end.x, end.y),
-				  cv::Scalar(color.x, color.y, color.z),
-				  thickness);
+void aux_img_rectangle_impl(aux_img::SharedMat mat, aux_img::Vec2i start, aux_img::Vec2i end, aux_img::Vec3d color, int thickness) noexcept {
+	aux_img::guard([&] {
+		auto target = aux_img::Target(mat);
+		aux_img::rectangle(target, cv::Point(start.x, start.y), cv::Point(end.x, end.y), cv::Scalar(color.x, color.y, color.z), thickness);
+	});
 }
 }
@@ -0,0 +1,173 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <vector>
+#include <opencv2/core.hpp>
+#include "pool.hpp"
+
+// horizontal band rendering
+//
+// primitives are binned by their vertical extent into fixed height bands of
+// the image, and the bands are rasterized concurrently. Every band owns its
+// rows and replays the primitives overlapping it in the original order, so
+// there is no data race. The output does not depend on the thread count as
+// long as every primitive draws the same rows into a band as into the whole
+// image: true of fills clipped per row (discs, thick lines, text), but not of
+// a thin `cv::line`, which starts Bresenham where it enters the band; see
+// `line`.
+namespace aux_img::band {
+constexpr int BAND_HEIGHT = 64;
+
+// rows covered by a primitive, inclusive, including its thickness
+struct Extent {
+	int y0;
+	int y1;
+};
+
+inline Extent extent_of(int64_t y0, int64_t y1, int64_t pad) {
+	constexpr int64_t LIMIT = 1 << 24;
+	const auto lo           = std::clamp(std::min(y0, y1) - pad, -LIMIT, LIMIT);
+	const auto hi           = std::clamp(std::max(y0, y1) + pad, -LIMIT, LIMIT);
+	return {static_cast<int>(lo), static_cast<int>(hi)};
+}
+
+// primitives of each band, i.e. `items[offsets[b], offsets[b + 1])` are the
+// indices overlapping band `b`, in increasing order
+//
+// the storage is owned by the calling thread and reused by the next `bin`
+struct Bins {
+	int n_bands;
+	const uint32_t *offsets;
+	const uint32_t *items;
+
+	bool is_busy(int b) const { return offsets[b + 1] != offsets[b]; }
+};
+
+inline Bins bin(int rows, std::span<const Extent> extents) {
+	const int n_bands = (rows + BAND_HEIGHT - 1) / BAND_HEIGHT;
+	// counting sort of (band, index), stable on index
+	thread_local std::vector<uint32_t> offsets;
+	thread_local std::vector<uint32_t> items;
+	offsets.assign(n_bands + 1, 0);
+	auto band_range = [&](const Extent &e, int &b0, int &b1) {
+		if (e.y1 < 0 || e.y0 >= rows) {
+			return false;
+		}
+		b0 = std::max(e.y0, 0) / BAND_HEIGHT;
+		b1 = std::min(e.y1, rows - 1) / BAND_HEIGHT;
+		return true;
+	};
+	for (const auto &e : extents) {
+		int b0, b1;
+		if (band_range(e, b0, b1)) {
+			for (int b = b0; b <= b1; b++) {
+				offsets[b + 1]++;
+			}
+		}
+	}
+	for (int b = 0; b < n_bands; b++) {
+		offsets[b + 1] += offsets[b];
+	}
+	items.resize(offsets[n_bands]);
+	thread_local std::vector<uint32_t> cursor;
+	cursor.assign(offsets.begin(), offsets.end() - 1);
+	for (uint32_t i = 0; i < extents.size(); i++) {
+		int b0, b1;
+		if (band_range(extents[i], b0, b1)) {
+			for (int b = b0; b <= b1; b++) {
+				items[cursor[b]++] = i;
+			}
+		}
+	}
+	return {n_bands, offsets.data(), items.data()};
+}
+
+inline cv::Mat band_of(cv::Mat &mat, int b) {
+	const int band_y = b * BAND_HEIGHT;
+	return mat.rowRange(band_y, std::min(band_y + BAND_HEIGHT, mat.rows));
+}
+
+// `cv::line` from `p0` to `p1` of an image `image_rows` high, into the band of
+// its rows starting at `band_y`
+//
+// a thin line is traced over the whole image, as `cv::line` would, and only
+// the pixels of the band are written; a thick one is a polygon filled per
+// row, so it is drawn into the band as is
+inline void line(cv::Mat &roi, int band_y, int image_rows, cv::Point p0, cv::Point p1, const cv::Scalar &color, int thickness) {
+	const auto offset = cv::Point(0, band_y);
+	if (thickness > 1 || (band_y == 0 && roi.rows == image_rows)) {
+		cv::line(roi, p0 - offset, p1 - offset, color, thickness);
+		return;
+	}
+	// up to 4 channels of 8 bytes
+	alignas(8) uint8_t raw[32];
+	cv::Mat pixel(1, 1, roi.type(), raw);
+	pixel = color;
+
+	const size_t elem_size = roi.elemSize();
+	cv::LineIterator it(cv::Rect(0, 0, roi.cols, image_rows), p0, p1, 8, true);
+	for (int i = 0; i < it.count; i++, ++it) {
+		const auto p = it.pos();
+		if (p.y >= band_y && p.y < band_y + roi.rows) {
+			std::memcpy(roi.ptr(p.y - band_y, p.x), raw, elem_size);
+		}
+	}
+}
+
+// `draw(band, band_y, index)` is called for every primitive overlapping a
+// band, in increasing `index` order, where `band` is the sub-matrix of rows
+// starting at `band_y`, i.e. coordinates should be shifted by `-band_y`
+template <typename Draw>
+void render(ThreadPool &pool, cv::Mat &mat, std::span<const Extent> extents, Draw &&draw) {
+	if (mat.rows == 0 || extents.empty()) {
+		return;
+	}
+	const auto bins = bin(mat.rows, extents);
+	// only wake the pool for bands with something to draw
+	thread_local std::vector<uint32_t> busy;
+	busy.clear();
+	for (int b = 0; b < bins.n_bands; b++) {
+		if (bins.is_busy(b)) {
+			busy.push_back(b);
+		}
+	}
+	const uint32_t *busy_data = busy.data();
+	pool.parallel_for(busy.size(), [&](size_t i) {
+		const auto b = static_cast<int>(busy_data[i]);
+		cv::Mat roi  = band_of(mat, b);
+		for (auto k = bins.offsets[b]; k < bins.offsets[b + 1]; k++) {
+			draw(roi, b * BAND_HEIGHT, bins.items[k]);
+		}
+	});
+}
+
+// like `render`, but visits every band, busy or not, and calls
+// `begin(band, band_y, is_busy)` before its primitives; on `pool` if not
+// `nullptr`, otherwise in order on the calling thread
+template <typename Begin, typename Draw>
+void render_all(ThreadPool *pool, cv::Mat &mat, std::span<const Extent> extents, Begin &&begin, Draw &&draw) {
+	if (mat.rows == 0) {
+		return;
+	}
+	const auto bins = bin(mat.rows, extents);
+	auto band_fn    = [&](size_t i) {
+		const auto b     = static_cast<int>(i);
+		const int band_y = b * BAND_HEIGHT;
+		cv::Mat roi      = band_of(mat, b);
+		begin(roi, band_y, bins.is_busy(b));
+		for (auto k = bins.offsets[b]; k < bins.offsets[b + 1]; k++) {
+			draw(roi, band_y, bins.items[k]);
+		}
+	};
+	if (pool != nullptr) {
+		pool->parallel_for(bins.n_bands, band_fn);
+	} else {
+		for (int b = 0; b < bins.n_bands; b++) {
+			band_fn(b);
+		}
+	}
+}
+}
@@ -0,0 +1,115 @@
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <opencv2/core.hpp>
+#include <aux.hpp>
+#include "status.hpp"
+#include "target.hpp"
+
+namespace aux_img {
+namespace {
+	thread_local char last_error[256] = "";
+}
+
+Target &target_of(Canvas *canvas) {
+	if (canvas == nullptr) {
+		throw std::invalid_argument("canvas == nullptr");
+	}
+	return canvas->target;
+}
+
+void set_last_error(Status status, const char *message) noexcept {
+	const char *prefix = aux_img_status_to_string(status);
+	const size_t n     = std::strlen(prefix);
+	std::memcpy(last_error, prefix, n);
+	last_error[n]     = ':';
+	last_error[n + 1] = ' ';
+	std::strncpy(last_error + n + 2, message != nullptr ? message : "", sizeof(last_error) - n - 3);
+	last_error[sizeof(last_error) - 1] = '\0';
+}
+}
+
+extern "C" {
+const char *aux_img_last_error() noexcept {
+	return aux_img::last_error;
+}
+
+const char *aux_img_status_to_string(aux_img::Status status) noexcept {
+	switch (status) {
+	case aux_img::Status::Ok:
+		return "Ok";
+	case aux_img::Status::InvalidArgument:
+		return "InvalidArgument";
+	case aux_img::Status::OutOfMemory:
+		return "OutOfMemory";
+	case aux_img::Status::OpenCVError:
+		return "OpenCVError";
+	case aux_img::Status::Unknown:
+	default:
+		return "Unknown";
+	}
+}
+
+aux_img::Status aux_img_canvas_create(aux_img::SharedMat mat, aux_img::Canvas **out) noexcept {
+	return aux_img::guard([&] {
+		if (out == nullptr) {
+			throw std::invalid_argument("out == nullptr");
+		}
+		auto *canvas                  = new aux_img::Canvas{aux_img::Target(mat)};
+		canvas->target.skeleton_cache = aux_img::make_skeleton_cache();
+		*out                          = canvas;
+	});
+}
+
+void aux_img_canvas_destroy(aux_img::Canvas *canvas) noexcept {
+	delete canvas;
+}
+
+aux_img::Status aux_img_canvas_set_data(aux_img::Canvas *canvas, uint8_t *data) noexcept {
+	return aux_img::guard([&] { aux_img::target_of(canvas).rebind(data); });
+}
+
+aux_img::Status aux_img_canvas_put_text(aux_img::Canvas *canvas,
+										const char *text,
+										aux_img::Vec2i pos,
+										aux_img::Vec3d color,
+										double scale,
+										int thickness,
+										bool bottomLeftOrigin) noexcept {
+	return aux_img::guard([&] {
+		aux_img::put_text(aux_img::target_of(canvas), text, cv::Point(pos.x, pos.y), cv::Scalar(color.x, color.y, color.z), scale, thickness, bottomLeftOrigin);
+	});
+}
+
+aux_img::Status aux_img_canvas_rectangle(aux_img::Canvas *canvas, aux_img::Vec2i start, aux_img::Vec2i end, aux_img::Vec3d color, int thickness) noexcept {
+	return aux_img::guard([&] {
+		aux_img::rectangle(aux_img::target_of(canvas), cv::Point(start.x, start.y), cv::Point(end.x, end.y), cv::Scalar(color.x, color.y, color.z), thickness);
+	});
+}
+
+aux_img::Status aux_img_canvas_draw_whole_body_skeleton(aux_img::Canvas *canvas, const float *data, aux_img::DrawSkeletonOptions options) noexcept {
+	return aux_img::guard([&] {
+		aux_img::CullStats stats{};
+		aux_img::draw_poses(aux_img::target_of(canvas), data, 1, nullptr, 0, options, {}, 0, stats);
+	});
+}
+
+aux_img::Status aux_img_canvas_draw_poses_batch(aux_img::Canvas *canvas,
+												const float *keypoints,
+												size_t n_people,
+												const uint16_t *boxes,
+												size_t n_boxes,
+												aux_img::DrawPosesOptions options,
+												aux_img::CullStats *stats) noexcept {
+	return aux_img::guard([&] {
+		const auto box_color = cv::Scalar(options.bounding_box_color.x, options.bounding_box_color.y, options.bounding_box_color.z);
+		aux_img::CullStats local_stats{};
+		aux_img::draw_poses(aux_img::target_of(canvas), keypoints, n_people, boxes, n_boxes, options.skeleton, box_color, options.bounding_box_thickness, local_stats);
+		if (stats != nullptr) {
+			*stats = local_stats;
+		}
+	});
+}
+}
@@ -0,0 +1,386 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <vector>
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+#include <aux.hpp>
+#include "band.hpp"
+#include "pool.hpp"
+#include "status.hpp"
+#include "target.hpp"
+#include "text.hpp"
+#include "yuv.hpp"
+
+namespace aux_img {
+namespace {
+	constexpr size_t SKELETON_FLOATS = 133 * 2;
+
+	cv::Scalar to_scalar(const Vec3d &color) {
+		return cv::Scalar(color.x, color.y, color.z);
+	}
+
+	uint32_t to_offset(size_t offset) {
+		if (offset > std::numeric_limits<uint32_t>::max()) {
+			throw std::invalid_argument("command list is full");
+		}
+		return static_cast<uint32_t>(offset);
+	}
+}
+
+// one recorded command; variable sized data lives in the arenas of the list
+struct Command {
+	enum class Kind : uint8_t {
+		Skeleton,
+		Line,
+		Circle,
+		Box,
+		Text,
+	};
+	Kind kind;
+	int thickness;
+	// start of a line/box, center of a circle, origin of text
+	cv::Point p0;
+	// end of a line/box
+	cv::Point p1;
+	int radius;
+	double scale;
+	cv::Scalar color;
+	// skeletons: first float in `keypoints`, and index in `skeleton_options`;
+	// text: first char in `text`, NUL terminated
+	uint32_t offset;
+	uint32_t options;
+};
+
+struct CommandList {
+	std::vector<Command> commands;
+	std::vector<float> keypoints;
+	std::vector<char> text;
+	// only appended to when the options differ from the last ones, as
+	// consecutive skeletons usually share them
+	std::vector<DrawSkeletonOptions> skeleton_options;
+
+	void clear() {
+		commands.clear();
+		keypoints.clear();
+		text.clear();
+		skeleton_options.clear();
+	}
+
+	void add_skeleton(const float *data, const DrawSkeletonOptions &options) {
+		if (skeleton_options.empty() || !is_same_options(skeleton_options.back(), options)) {
+			skeleton_options.push_back(options);
+		}
+		Command cmd{};
+		cmd.kind    = Command::Kind::Skeleton;
+		cmd.offset  = to_offset(keypoints.size());
+		cmd.options = to_offset(skeleton_options.size() - 1);
+		keypoints.insert(keypoints.end(), data, data + SKELETON_FLOATS);
+		commands.push_back(cmd);
+	}
+
+	void add_shape(Command::Kind kind, cv::Point p0, cv::Point p1, int radius, const cv::Scalar &color, int thickness) {
+		Command cmd{};
+		cmd.kind      = kind;
+		cmd.thickness = thickness;
+		cmd.p0        = p0;
+		cmd.p1        = p1;
+		cmd.radius    = radius;
+		cmd.color     = color;
+		commands.push_back(cmd);
+	}
+
+	void add_text(const char *str, cv::Point org, const cv::Scalar &color, double scale, int thickness) {
+		Command cmd{};
+		cmd.kind      = Command::Kind::Text;
+		cmd.thickness = thickness;
+		cmd.p0        = org;
+		cmd.scale     = scale;
+		cmd.color     = color;
+		cmd.offset    = to_offset(text.size());
+		text.insert(text.end(), str, str + std::strlen(str) + 1);
+		commands.push_back(cmd);
+	}
+};
+
+namespace {
+	// a line, circle, box or text of a list that touches the frame, ready to
+	// be drawn
+	struct Shape {
+		const Command *cmd;
+		// in the frame, including the thickness
+		cv::Rect bounds;
+		// `cmd->color`, or its label for a YUV frame
+		cv::Scalar color;
+		// text only
+		const text::Label *label;
+	};
+
+	cv::Rect padded(cv::Point p0, cv::Point p1, int pad) {
+		const auto tl = cv::Point(std::min(p0.x, p1.x) - pad, std::min(p0.y, p1.y) - pad);
+		const auto br = cv::Point(std::max(p0.x, p1.x) + pad + 1, std::max(p0.y, p1.y) + pad + 1);
+		return cv::Rect(tl, br);
+	}
+
+	// the shapes of `list` in recording order, without the ones missing the
+	// frame; the storage is owned by the calling thread and reused by the next
+	// call
+	std::span<Shape> collect_shapes(const CommandList &list, cv::Size frame, std::vector<band::Extent> &extents) {
+		thread_local std::vector<Shape> shapes;
+		// keeps the labels alive while drawn
+		thread_local std::vector<std::shared_ptr<const text::Label>> labels;
+		shapes.clear();
+		labels.clear();
+		extents.clear();
+		const auto frame_rect = cv::Rect(cv::Point(0, 0), frame);
+		for (const auto &cmd : list.commands) {
+			Shape shape{&cmd, {}, cmd.color, nullptr};
+			switch (cmd.kind) {
+			case Command::Kind::Skeleton:
+				continue;
+			case Command::Kind::Line:
+				shape.bounds = padded(cmd.p0, cmd.p1, (std::max(cmd.thickness, 1) + 1) / 2 + 1);
+				break;
+			case Command::Kind::Circle:
+				shape.bounds = padded(cmd.p0, cmd.p0, cmd.radius + std::max(cmd.thickness, 0) + 1);
+				break;
+			case Command::Kind::Box:
+				shape.bounds = padded(cmd.p0, cmd.p1, cmd.thickness > 0 ? (cmd.thickness + 1) / 2 + 1 : 0);
+				break;
+			case Command::Kind::Text: {
+				auto label   = text::label(list.text.data() + cmd.offset, cmd.scale, cmd.thickness);
+				shape.bounds = cv::Rect(cmd.p0 + label->offset, label->mask.size());
+				shape.label  = label.get();
+				labels.push_back(std::move(label));
+				break;
+			}
+			}
+			shape.bounds &= frame_rect;
+			if (shape.bounds.empty()) {
+				continue;
+			}
+			shapes.push_back(shape);
+			extents.push_back({shape.bounds.y, shape.bounds.y + shape.bounds.height - 1});
+		}
+		return shapes;
+	}
+
+	// into the band of the rows of an image `image_rows` high starting at `band_y`
+	void draw_shape(cv::Mat &roi, int band_y, int image_rows, const Shape &shape) {
+		const auto &cmd   = *shape.cmd;
+		const auto offset = cv::Point(0, band_y);
+		switch (cmd.kind) {
+		case Command::Kind::Line:
+			band::line(roi, band_y, image_rows, cmd.p0, cmd.p1, shape.color, cmd.thickness);
+			break;
+		case Command::Kind::Circle:
+			cv::circle(roi, cmd.p0 - offset, cmd.radius, shape.color, cmd.thickness);
+			break;
+		case Command::Kind::Box:
+			cv::rectangle(roi, cmd.p0 - offset, cmd.p1 - offset, shape.color, cmd.thickness);
+			break;
+		case Command::Kind::Text:
+			text::blit(roi, *shape.label, cmd.p0, shape.color, band_y);
+			break;
+		default:
+			break;
+		}
+	}
+
+	void draw_shapes(cv::Mat &mat, std::span<const Shape> shapes, std::span<const band::Extent> extents) {
+		if (auto pool = shared_pool(); pool != nullptr) {
+			band::render(*pool, mat, extents, [&](cv::Mat &roi, int band_y, uint32_t k) {
+				draw_shape(roi, band_y, mat.rows, shapes[k]);
+			});
+			return;
+		}
+		for (const auto &shape : shapes) {
+			draw_shape(mat, 0, mat.rows, shape);
+		}
+	}
+}
+
+void execute(Target &target, const CommandList &list, CullStats &stats) {
+	// skeletons, batched by runs sharing their options
+	const Command *run = nullptr;
+	size_t n_run       = 0;
+	auto flush         = [&] {
+		if (n_run != 0) {
+			draw_poses(target, list.keypoints.data() + run->offset, n_run, nullptr, 0,
+					   list.skeleton_options[run->options], {}, 0, stats);
+		}
+		n_run = 0;
+	};
+	for (const auto &cmd : list.commands) {
+		if (cmd.kind != Command::Kind::Skeleton) {
+			continue;
+		}
+		if (n_run != 0 && cmd.options == run->options && cmd.offset == run->offset + n_run * SKELETON_FLOATS) {
+			n_run++;
+			continue;
+		}
+		flush();
+		run   = &cmd;
+		n_run = 1;
+	}
+	flush();
+
+	thread_local std::vector<band::Extent> extents;
+	const auto frame  = cv::Size(target.shared.cols, target.shared.rows);
+	const auto shapes = collect_shapes(list, frame, extents);
+	if (shapes.empty()) {
+		return;
+	}
+	if (!target.is_yuv) {
+		draw_shapes(target.mat, shapes, extents);
+		return;
+	}
+	yuv::Overlay overlay(target.shared);
+	cv::Rect dirty;
+	for (auto &shape : shapes) {
+		shape.color = overlay.label_of(shape.cmd->color);
+		dirty       = dirty.empty() ? shape.bounds : (dirty | shape.bounds);
+	}
+	draw_shapes(overlay.labels(), shapes, extents);
+	overlay.resolve(dirty);
+}
+}
+
+extern "C" {
+aux_img::Status aux_img_cmdlist_create(aux_img::CommandList **out) noexcept {
+	return aux_img::guard([&] {
+		if (out == nullptr) {
+			throw std::invalid_argument("out == nullptr");
+		}
+		*out = new aux_img::CommandList;
+	});
+}
+
+void aux_img_cmdlist_destroy(aux_img::CommandList *list) noexcept {
+	delete list;
+}
+
+void aux_img_cmdlist_clear(aux_img::CommandList *list) noexcept {
+	if (list != nullptr) {
+		list->clear();
+	}
+}
+
+size_t aux_img_cmdlist_size(const aux_img::CommandList *list) noexcept {
+	return list == nullptr ? 0 : list->commands.size();
+}
+
+aux_img::Status aux_img_cmdlist_reserve(aux_img::CommandList *list, size_t n_commands, size_t n_people, size_t n_text_bytes) noexcept {
+	return aux_img::guard([&] {
+		if (list == nullptr) {
+			throw std::invalid_argument("list == nullptr");
+		}
+		list->commands.reserve(n_commands);
+		list->keypoints.reserve(n_people * aux_img::SKELETON_FLOATS);
+		list->text.reserve(n_text_bytes);
+	});
+}
+
+aux_img::Status aux_img_cmdlist_skeleton(aux_img::CommandList *list, const float *data, aux_img::DrawSkeletonOptions options) noexcept {
+	return aux_img::guard([&] {
+		if (list == nullptr || data == nullptr) {
+			throw std::invalid_argument("list == nullptr || data == nullptr");
+		}
+		list->add_skeleton(data, options);
+	});
+}
+
+aux_img::Status aux_img_cmdlist_poses_batch(aux_img::CommandList *list,
+											const float *keypoints,
+											size_t n_people,
+											const uint16_t *boxes,
+											size_t n_boxes,
+											aux_img::DrawPosesOptions options) noexcept {
+	return aux_img::guard([&] {
+		if (list == nullptr) {
+			throw std::invalid_argument("list == nullptr");
+		}
+		if (n_people != 0 && keypoints == nullptr) {
+			throw std::invalid_argument("keypoints == nullptr with n_people != 0");
+		}
+		if (n_boxes != 0 && boxes == nullptr) {
+			throw std::invalid_argument("boxes == nullptr with n_boxes != 0");
+		}
+		for (size_t i = 0; i < n_people; i++) {
+			list->add_skeleton(keypoints + i * aux_img::SKELETON_FLOATS, options.skeleton);
+		}
+		const auto box_color = aux_img::to_scalar(options.bounding_box_color);
+		for (size_t i = 0; i < n_boxes; i++) {
+			// [x1, y1, x2, y2]
+			const uint16_t *bb = boxes + i * 4;
+			list->add_shape(aux_img::Command::Kind::Box, cv::Point(bb[0], bb[1]), cv::Point(bb[2], bb[3]), 0,
+							box_color, options.bounding_box_thickness);
+		}
+	});
+}
+
+aux_img::Status aux_img_cmdlist_rectangle(aux_img::CommandList *list, aux_img::Vec2i start, aux_img::Vec2i end, aux_img::Vec3d color, int thickness) noexcept {
+	return aux_img::guard([&] {
+		if (list == nullptr) {
+			throw std::invalid_argument("list == nullptr");
+		}
+		list->add_shape(aux_img::Command::Kind::Box, cv::Point(start.x, start.y), cv::Point(end.x, end.y), 0, aux_img::to_scalar(color), thickness);
+	});
+}
+
+aux_img::Status aux_img_cmdlist_line(aux_img::CommandList *list, aux_img::Vec2i start, aux_img::Vec2i end, aux_img::Vec3d color, int thickness) noexcept {
+	return aux_img::guard([&] {
+		if (list == nullptr) {
+			throw std::invalid_argument("list == nullptr");
+		}
+		if (thickness <= 0) {
+			throw std::invalid_argument("line thickness <= 0");
+		}
+		list->add_shape(aux_img::Command::Kind::Line, cv::Point(start.x, start.y), cv::Point(end.x, end.y), 0, aux_img::to_scalar(color), thickness);
+	});
+}
+
+aux_img::Status aux_img_cmdlist_circle(aux_img::CommandList *list, aux_img::Vec2i center, int radius, aux_img::Vec3d color, int thickness) noexcept {
+	return aux_img::guard([&] {
+		if (list == nullptr) {
+			throw std::invalid_argument("list == nullptr");
+		}
+		if (radius < 0) {
+			throw std::invalid_argument("radius < 0");
+		}
+		list->add_shape(aux_img::Command::Kind::Circle, cv::Point(center.x, center.y), {}, radius, aux_img::to_scalar(color), thickness);
+	});
+}
+
+aux_img::Status aux_img_cmdlist_put_text(aux_img::CommandList *list,
+										 const char *text,
+										 aux_img::Vec2i pos,
+										 aux_img::Vec3d color,
+										 double scale,
+										 int thickness) noexcept {
+	return aux_img::guard([&] {
+		if (list == nullptr || text == nullptr) {
+			throw std::invalid_argument("list == nullptr || text == nullptr");
+		}
+		list->add_text(text, cv::Point(pos.x, pos.y), aux_img::to_scalar(color), scale, thickness);
+	});
+}
+
+aux_img::Status aux_img_canvas_execute(aux_img::Canvas *canvas, const aux_img::CommandList *list, aux_img::CullStats *stats) noexcept {
+	return aux_img::guard([&] {
+		if (canvas == nullptr || list == nullptr) {
+			throw std::invalid_argument("canvas == nullptr || list == nullptr");
+		}
+		aux_img::CullStats local_stats{};
+		aux_img::execute(canvas->target, *list, local_stats);
+		if (stats != nullptr) {
+			*stats = local_stats;
+		}
+	});
+}
+}
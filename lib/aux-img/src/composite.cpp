@@ -0,0 +1,142 @@
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include <aux.hpp>
+#include "composite.hpp"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace aux_img::composite {
+namespace {
+// the source channel of each of the three color channels of the output
+std::array<int, 3> channel_order(PixelFormat src, OutputFormat dst) {
+	const bool is_src_rgb = src == PixelFormat::RGB || src == PixelFormat::RGBA;
+	const bool is_dst_rgb = dst == OutputFormat::RGBA;
+	if (src == PixelFormat::GRAY) {
+		return {0, 0, 0};
+	}
+	if (is_src_rgb == is_dst_rgb) {
+		return {0, 1, 2};
+	}
+	return {2, 1, 0};
+}
+
+template <int N_SRC, int N_DST>
+void convert_pixels(const uint8_t *__restrict src, uint8_t *__restrict dst, int cols, std::array<int, 3> order) {
+	for (int x = 0; x < cols; x++) {
+		const uint8_t *s = src + x * N_SRC;
+		uint8_t *d       = dst + x * N_DST;
+		d[0]             = s[order[0]];
+		d[1]             = s[order[1]];
+		d[2]             = s[order[2]];
+		if constexpr (N_DST == 4) {
+			d[3] = N_SRC == 4 ? s[3] : 255;
+		}
+	}
+}
+
+void convert_row(const uint8_t *src, size_t n_src, uint8_t *dst, size_t n_dst, int cols, std::array<int, 3> order) {
+	using Kernel        = void (*)(const uint8_t *, uint8_t *, int, std::array<int, 3>);
+	const Kernel kernel = n_src == 1   ? (n_dst == 3 ? convert_pixels<1, 3> : convert_pixels<1, 4>)
+						  : n_src == 3 ? (n_dst == 3 ? convert_pixels<3, 3> : convert_pixels<3, 4>)
+									   : (n_dst == 3 ? convert_pixels<4, 3> : convert_pixels<4, 4>);
+	kernel(src, dst, cols, order);
+}
+
+// `memcpy` bypassing the cache for the 16 byte aligned part of `dst`
+void stream_copy(uint8_t *dst, const uint8_t *src, size_t n) {
+#if defined(__SSE2__)
+	const size_t head = std::min(n, (16 - reinterpret_cast<uintptr_t>(dst) % 16) % 16);
+	std::memcpy(dst, src, head);
+	dst += head;
+	src += head;
+	n -= head;
+	for (; n >= 64; n -= 64, dst += 64, src += 64) {
+		const auto a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src));
+		const auto b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + 16));
+		const auto c = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + 32));
+		const auto d = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + 48));
+		_mm_stream_si128(reinterpret_cast<__m128i *>(dst), a);
+		_mm_stream_si128(reinterpret_cast<__m128i *>(dst + 16), b);
+		_mm_stream_si128(reinterpret_cast<__m128i *>(dst + 32), c);
+		_mm_stream_si128(reinterpret_cast<__m128i *>(dst + 48), d);
+	}
+	for (; n >= 16; n -= 16, dst += 16, src += 16) {
+		_mm_stream_si128(reinterpret_cast<__m128i *>(dst), _mm_loadu_si128(reinterpret_cast<const __m128i *>(src)));
+	}
+#endif
+	std::memcpy(dst, src, n);
+}
+}
+
+size_t channels_of(PixelFormat format) {
+	switch (format) {
+	case PixelFormat::RGB:
+	case PixelFormat::BGR:
+		return 3;
+	case PixelFormat::RGBA:
+	case PixelFormat::BGRA:
+		return 4;
+	case PixelFormat::GRAY:
+		return 1;
+	default:
+		return 0;
+	}
+}
+
+size_t channels_of(OutputFormat format) {
+	return format == OutputFormat::BGR ? 3 : 4;
+}
+
+bool is_supported_source(const SharedMat &src) {
+	return src.depth == Depth::U8 && channels_of(src.pixel_format) != 0;
+}
+
+void convert_rows(const uint8_t *src,
+				  size_t src_step,
+				  PixelFormat src_format,
+				  uint8_t *dst,
+				  size_t dst_step,
+				  OutputFormat dst_format,
+				  int rows,
+				  int cols,
+				  bool is_streaming) {
+	const size_t n_src     = channels_of(src_format);
+	const size_t n_dst     = channels_of(dst_format);
+	const auto order       = channel_order(src_format, dst_format);
+	const bool is_same     = n_src == n_dst && order == std::array{0, 1, 2};
+	const size_t row_bytes = static_cast<size_t>(cols) * n_dst;
+	// converted rows are staged here before being streamed out; it stays in
+	// L1/L2, unlike the output
+	thread_local std::vector<uint8_t> staging;
+	if (is_streaming && !is_same) {
+		staging.resize(row_bytes);
+	}
+	for (int y = 0; y < rows; y++) {
+		const uint8_t *s = src + y * src_step;
+		uint8_t *d       = dst + y * dst_step;
+		if (is_same) {
+			if (is_streaming) {
+				stream_copy(d, s, row_bytes);
+			} else {
+				std::memcpy(d, s, row_bytes);
+			}
+		} else if (is_streaming) {
+			convert_row(s, n_src, staging.data(), n_dst, cols, order);
+			stream_copy(d, staging.data(), row_bytes);
+		} else {
+			convert_row(s, n_src, d, n_dst, cols, order);
+		}
+	}
+#if defined(__SSE2__)
+	if (is_streaming) {
+		// order the non-temporal stores before anything that reads them
+		_mm_sfence();
+	}
+#endif
+}
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <aux.hpp>
+
+// row kernels of `aux_img_composite_poses_impl`, which converts a frame into a
+// display buffer and draws the overlay in the same pass
+namespace aux_img::composite {
+// 0 for a format that is not a supported source
+size_t channels_of(PixelFormat format);
+size_t channels_of(OutputFormat format);
+
+// 8 bit RGB, BGR, RGBA, BGRA or GRAY
+bool is_supported_source(const SharedMat &src);
+
+// convert `rows` rows of `cols` pixels; the alpha of a 4 channel source is
+// kept, otherwise the output is opaque
+//
+// with `is_streaming`, the output is written with non-temporal stores, so
+// that rows nobody reads back do not evict the cache
+void convert_rows(const uint8_t *src,
+				  size_t src_step,
+				  PixelFormat src_format,
+				  uint8_t *dst,
+				  size_t dst_step,
+				  OutputFormat dst_format,
+				  int rows,
+				  int cols,
+				  bool is_streaming);
+}
@@ -0,0 +1,367 @@
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#include <aux.hpp>
+#include "status.hpp"
+#include "wire.hpp"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace aux_img {
+namespace {
+	constexpr size_t SKELETON_FLOATS = 133 * 2;
+	// body keypoints, which locate a person for matching
+	constexpr size_t BODY_KEYPOINTS = 17;
+
+	// `out = a + (b - a) * t`, i.e. interpolation for `t` in [0, 1] and
+	// extrapolation past it
+	void lerp(const float *__restrict a, const float *__restrict b, float t, float *__restrict out, size_t n) {
+		size_t i = 0;
+#if defined(__SSE2__)
+		const auto vt = _mm_set1_ps(t);
+		for (; i + 8 <= n; i += 8) {
+			const auto a0 = _mm_loadu_ps(a + i);
+			const auto a1 = _mm_loadu_ps(a + i + 4);
+			const auto b0 = _mm_loadu_ps(b + i);
+			const auto b1 = _mm_loadu_ps(b + i + 4);
+			_mm_storeu_ps(out + i, _mm_add_ps(a0, _mm_mul_ps(_mm_sub_ps(b0, a0), vt)));
+			_mm_storeu_ps(out + i + 4, _mm_add_ps(a1, _mm_mul_ps(_mm_sub_ps(b1, a1), vt)));
+		}
+#endif
+		for (; i < n; i++) {
+			out[i] = a[i] + (b[i] - a[i]) * t;
+		}
+	}
+
+	struct Point2f {
+		float x;
+		float y;
+	};
+
+	// mean of the finite body keypoints; NaN if there is none
+	Point2f centroid(const float *data, Layout layout) {
+		float x = 0;
+		float y = 0;
+		int n   = 0;
+		for (size_t i = 0; i < BODY_KEYPOINTS; i++) {
+			const float px = layout == Layout::RowMajor ? data[i * 2] : data[i];
+			const float py = layout == Layout::RowMajor ? data[i * 2 + 1] : data[133 + i];
+			if (std::isfinite(px) && std::isfinite(py)) {
+				x += px;
+				y += py;
+				n++;
+			}
+		}
+		if (n == 0) {
+			return {std::numeric_limits<float>::quiet_NaN(), std::numeric_limits<float>::quiet_NaN()};
+		}
+		return {x / n, y / n};
+	}
+
+	Point2f center_of(const uint16_t *bb) {
+		return {(bb[0] + bb[2]) * 0.5f, (bb[1] + bb[3]) * 0.5f};
+	}
+}
+
+struct PoseHistory {
+	struct Snapshot {
+		uint32_t frame_index;
+		uint32_t n_people;
+		uint32_t n_boxes;
+	};
+
+	struct Pair {
+		float distance;
+		uint32_t base;
+		uint32_t other;
+	};
+
+	size_t capacity;
+	size_t max_people;
+	Layout layout;
+	// ring of `capacity` snapshots, oldest at `head`
+	std::vector<Snapshot> snapshots;
+	std::vector<float> keypoints;
+	std::vector<uint16_t> boxes;
+	size_t head = 0;
+	size_t size = 0;
+	// scratch of `sample`, sized once
+	std::vector<Point2f> base_centers;
+	std::vector<Point2f> other_centers;
+	std::vector<Pair> pairs;
+	std::vector<int32_t> match;
+	// the row major keypoints of a view, for a column major history only
+	std::vector<float> decoded;
+
+	PoseHistory(size_t capacity, size_t max_people, Layout layout)
+		: capacity(capacity), max_people(max_people), layout(layout), snapshots(capacity),
+		  keypoints(capacity * max_people * SKELETON_FLOATS), boxes(capacity * max_people * 4),
+		  base_centers(max_people), other_centers(max_people), match(max_people),
+		  decoded(layout == Layout::ColMajor ? max_people * SKELETON_FLOATS : 0) {
+		pairs.reserve(max_people * max_people);
+	}
+
+	size_t slot(size_t i) const { return (head + i) % capacity; }
+	const Snapshot &at(size_t i) const { return snapshots[slot(i)]; }
+	float *keypoints_of(size_t i) { return keypoints.data() + slot(i) * max_people * SKELETON_FLOATS; }
+	uint16_t *boxes_of(size_t i) { return boxes.data() + slot(i) * max_people * 4; }
+
+	void clear() {
+		head = 0;
+		size = 0;
+	}
+
+	// make the newest snapshot room for `n_people` and `n_boxes`, and return
+	// its index; people past `max_people` are dropped
+	size_t append(uint32_t frame_index, size_t &n_people, size_t &n_boxes) {
+		if (size != 0) {
+			const auto newest = at(size - 1).frame_index;
+			if (frame_index == newest) {
+				// a correction of the newest snapshot
+				size--;
+			} else if (frame_index < newest) {
+				// the producer restarted
+				clear();
+			}
+		}
+		if (size == capacity) {
+			head = (head + 1) % capacity;
+			size--;
+		}
+		n_people = std::min(n_people, max_people);
+		n_boxes  = std::min(n_boxes, max_people);
+
+		const size_t i     = size++;
+		snapshots[slot(i)] = {frame_index, static_cast<uint32_t>(n_people), static_cast<uint32_t>(n_boxes)};
+		return i;
+	}
+
+	void push(uint32_t frame_index, const float *kps, size_t n_people, const uint16_t *bbs, size_t n_boxes) {
+		const size_t i = append(frame_index, n_people, n_boxes);
+		std::copy_n(kps, n_people * SKELETON_FLOATS, keypoints_of(i));
+		std::copy_n(bbs, n_boxes * 4, boxes_of(i));
+	}
+
+	// decoded straight into the ring, in either wire version; the wire is
+	// row major, so a column major history transposes every skeleton
+	void push(const PoseView &view) {
+		size_t n_people = view.n_people;
+		size_t n_boxes  = view.n_boxes;
+		const size_t i  = append(view.frame_index, n_people, n_boxes);
+		float *kps      = keypoints_of(i);
+		if (layout == Layout::RowMajor) {
+			wire::decode_keypoints(view, n_people, kps);
+		} else {
+			wire::decode_keypoints(view, n_people, decoded.data());
+			for (size_t p = 0; p < n_people; p++) {
+				const float *src = decoded.data() + p * SKELETON_FLOATS;
+				float *dst       = kps + p * SKELETON_FLOATS;
+				for (size_t k = 0; k < SKELETON_FLOATS / 2; k++) {
+					dst[k]                       = src[k * 2];
+					dst[SKELETON_FLOATS / 2 + k] = src[k * 2 + 1];
+				}
+			}
+		}
+		wire::decode_boxes(view, n_boxes, boxes_of(i));
+	}
+
+	// greedy matching of `base` against `other` by distance, nearest pairs
+	// first; `match[i]` is the index in `other` of `base[i]`, or -1
+	void match_nearest(size_t n_base, size_t n_other) {
+		pairs.clear();
+		for (size_t i = 0; i < n_base; i++) {
+			for (size_t j = 0; j < n_other; j++) {
+				const float dx = base_centers[i].x - other_centers[j].x;
+				const float dy = base_centers[i].y - other_centers[j].y;
+				const float d  = dx * dx + dy * dy;
+				if (std::isfinite(d)) {
+					pairs.push_back({d, static_cast<uint32_t>(i), static_cast<uint32_t>(j)});
+				}
+			}
+		}
+		std::sort(pairs.begin(), pairs.end(), [](const Pair &a, const Pair &b) { return a.distance < b.distance; });
+		std::fill_n(match.begin(), n_base, -1);
+		// `other_centers` doubles as the taken flag of the other side
+		for (const auto &p : pairs) {
+			if (match[p.base] == -1 && !std::isnan(other_centers[p.other].x)) {
+				match[p.base]          = static_cast<int32_t>(p.other);
+				other_centers[p.other] = {std::numeric_limits<float>::quiet_NaN(), 0};
+			}
+		}
+	}
+
+	// people and boxes of snapshot `base`, moved towards (or past) snapshot
+	// `other` where they match, by `t` going from `a` (t = 0) to `b` (t = 1)
+	PoseSample blend(size_t a, size_t b, float t, bool is_base_a, SampleKind kind, float *out_kps, uint16_t *out_bbs) {
+		const size_t base      = is_base_a ? a : b;
+		const size_t other     = is_base_a ? b : a;
+		const auto &base_snap  = at(base);
+		const auto &other_snap = at(other);
+		const float *base_kps  = keypoints_of(base);
+		const float *other_kps = keypoints_of(other);
+
+		for (size_t i = 0; i < base_snap.n_people; i++) {
+			base_centers[i] = centroid(base_kps + i * SKELETON_FLOATS, layout);
+		}
+		for (size_t j = 0; j < other_snap.n_people; j++) {
+			other_centers[j] = centroid(other_kps + j * SKELETON_FLOATS, layout);
+		}
+		match_nearest(base_snap.n_people, other_snap.n_people);
+		for (size_t i = 0; i < base_snap.n_people; i++) {
+			const float *p = base_kps + i * SKELETON_FLOATS;
+			float *out     = out_kps + i * SKELETON_FLOATS;
+			if (match[i] == -1) {
+				std::copy_n(p, SKELETON_FLOATS, out);
+				continue;
+			}
+			const float *q        = other_kps + match[i] * SKELETON_FLOATS;
+			const auto [from, to] = is_base_a ? std::pair{p, q} : std::pair{q, p};
+			lerp(from, to, t, out, SKELETON_FLOATS);
+		}
+
+		const uint16_t *base_bbs  = boxes_of(base);
+		const uint16_t *other_bbs = boxes_of(other);
+		for (size_t i = 0; i < base_snap.n_boxes; i++) {
+			base_centers[i] = center_of(base_bbs + i * 4);
+		}
+		for (size_t j = 0; j < other_snap.n_boxes; j++) {
+			other_centers[j] = center_of(other_bbs + j * 4);
+		}
+		match_nearest(base_snap.n_boxes, other_snap.n_boxes);
+		for (size_t i = 0; i < base_snap.n_boxes; i++) {
+			const uint16_t *p = base_bbs + i * 4;
+			uint16_t *out     = out_bbs + i * 4;
+			if (match[i] == -1) {
+				std::copy_n(p, 4, out);
+				continue;
+			}
+			const uint16_t *q     = other_bbs + match[i] * 4;
+			const auto [from, to] = is_base_a ? std::pair{p, q} : std::pair{q, p};
+			for (size_t k = 0; k < 4; k++) {
+				const float v = from[k] + (static_cast<float>(to[k]) - from[k]) * t;
+				out[k]        = static_cast<uint16_t>(std::clamp(std::lround(v), 0L, 65535L));
+			}
+		}
+		return {base_snap.n_people, base_snap.n_boxes, kind};
+	}
+
+	PoseSample copy(size_t i, SampleKind kind, float *out_kps, uint16_t *out_bbs) {
+		const auto &snap = at(i);
+		std::copy_n(keypoints_of(i), snap.n_people * SKELETON_FLOATS, out_kps);
+		std::copy_n(boxes_of(i), snap.n_boxes * 4, out_bbs);
+		return {snap.n_people, snap.n_boxes, kind};
+	}
+
+	PoseSample sample(uint32_t frame_index, uint32_t max_extrapolation, float *out_kps, uint16_t *out_bbs) {
+		if (size == 0 || frame_index < at(0).frame_index) {
+			return {0, 0, SampleKind::None};
+		}
+		const size_t newest = size - 1;
+		const auto last     = at(newest).frame_index;
+		if (frame_index == last) {
+			return copy(newest, SampleKind::Exact, out_kps, out_bbs);
+		}
+		if (frame_index > last) {
+			if (frame_index - last > max_extrapolation) {
+				return {0, 0, SampleKind::None};
+			}
+			if (size == 1) {
+				return copy(newest, SampleKind::Held, out_kps, out_bbs);
+			}
+			const auto prev = at(newest - 1).frame_index;
+			const float t   = static_cast<float>(frame_index - prev) / static_cast<float>(last - prev);
+			return blend(newest - 1, newest, t, false, SampleKind::Extrapolated, out_kps, out_bbs);
+		}
+		// the pair of snapshots around `frame_index`; indices are increasing
+		size_t b = 1;
+		while (at(b).frame_index <= frame_index) {
+			b++;
+		}
+		const size_t a = b - 1;
+		if (at(a).frame_index == frame_index) {
+			return copy(a, SampleKind::Exact, out_kps, out_bbs);
+		}
+		const auto fa = at(a).frame_index;
+		const float t = static_cast<float>(frame_index - fa) / static_cast<float>(at(b).frame_index - fa);
+		// the people of the nearer snapshot are kept
+		return blend(a, b, t, t < 0.5f, SampleKind::Interpolated, out_kps, out_bbs);
+	}
+};
+}
+
+extern "C" {
+aux_img::Status aux_img_history_create(size_t capacity, size_t max_people, aux_img::Layout layout, aux_img::PoseHistory **out) noexcept {
+	return aux_img::guard([&] {
+		if (out == nullptr) {
+			throw std::invalid_argument("out == nullptr");
+		}
+		if (capacity < 2 || max_people == 0) {
+			throw std::invalid_argument("capacity < 2 || max_people == 0");
+		}
+		*out = new aux_img::PoseHistory(capacity, max_people, layout);
+	});
+}
+
+void aux_img_history_destroy(aux_img::PoseHistory *history) noexcept {
+	delete history;
+}
+
+void aux_img_history_clear(aux_img::PoseHistory *history) noexcept {
+	if (history != nullptr) {
+		history->clear();
+	}
+}
+
+aux_img::Status aux_img_history_push(aux_img::PoseHistory *history,
+									 uint32_t frame_index,
+									 const float *keypoints,
+									 size_t n_people,
+									 const uint16_t *boxes,
+									 size_t n_boxes) noexcept {
+	return aux_img::guard([&] {
+		if (history == nullptr) {
+			throw std::invalid_argument("history == nullptr");
+		}
+		if (n_people != 0 && keypoints == nullptr) {
+			throw std::invalid_argument("keypoints == nullptr with n_people != 0");
+		}
+		if (n_boxes != 0 && boxes == nullptr) {
+			throw std::invalid_argument("boxes == nullptr with n_boxes != 0");
+		}
+		history->push(frame_index, keypoints, n_people, boxes, n_boxes);
+	});
+}
+
+aux_img::Status aux_img_history_push_view(aux_img::PoseHistory *history, const aux_img::PoseView *view) noexcept {
+	return aux_img::guard([&] {
+		if (history == nullptr || view == nullptr) {
+			throw std::invalid_argument("history or view == nullptr");
+		}
+		if ((view->n_people != 0 && view->keypoints == nullptr) || (view->n_boxes != 0 && view->boxes == nullptr)) {
+			throw std::invalid_argument("view->keypoints or view->boxes == nullptr");
+		}
+		history->push(*view);
+	});
+}
+
+aux_img::Status aux_img_history_sample(aux_img::PoseHistory *history,
+									   uint32_t frame_index,
+									   uint32_t max_extrapolation,
+									   float *keypoints,
+									   uint16_t *boxes,
+									   aux_img::PoseSample *out) noexcept {
+	return aux_img::guard([&] {
+		if (history == nullptr || keypoints == nullptr || boxes == nullptr || out == nullptr) {
+			throw std::invalid_argument("history, keypoints, boxes or out == nullptr");
+		}
+		*out = history->sample(frame_index, max_extrapolation, keypoints, boxes);
+	});
+}
+}
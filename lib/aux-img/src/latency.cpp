@@ -0,0 +1,152 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <time.h>
+#include <aux.hpp>
+#include "latency.hpp"
+
+namespace aux_img::latency {
+namespace {
+	// log-linear buckets as in HDR histograms: values below 2 * SUB_BUCKETS
+	// are exact, above they fall into one of `SUB_BUCKETS` buckets per power
+	// of two, i.e. within 1 / SUB_BUCKETS (6.25%) of the value
+	constexpr int SUB_BITS         = 4;
+	constexpr uint64_t SUB_BUCKETS = 1 << SUB_BITS;
+	constexpr size_t N_BUCKETS     = 2 * SUB_BUCKETS + (64 - SUB_BITS - 1) * SUB_BUCKETS;
+
+	constexpr size_t bucket_of(uint64_t v) {
+		if (v < 2 * SUB_BUCKETS) {
+			return v;
+		}
+		const int shift = std::bit_width(v) - (SUB_BITS + 1);
+		return 2 * SUB_BUCKETS + (shift - 1) * SUB_BUCKETS + ((v >> shift) - SUB_BUCKETS);
+	}
+
+	// the middle of the values of bucket `i`
+	constexpr uint64_t value_of(size_t i) {
+		if (i < 2 * SUB_BUCKETS) {
+			return i;
+		}
+		const int shift    = static_cast<int>((i - 2 * SUB_BUCKETS) / SUB_BUCKETS) + 1;
+		const uint64_t top = (i - 2 * SUB_BUCKETS) % SUB_BUCKETS + SUB_BUCKETS;
+		return (top << shift) + ((uint64_t{1} << shift) >> 1);
+	}
+
+	static_assert(bucket_of(31) == 31 && bucket_of(32) == 32 && bucket_of(63) == 47 && bucket_of(64) == 48);
+	static_assert(bucket_of(UINT64_MAX) == N_BUCKETS - 1);
+
+	// only counters, so that recording is a few relaxed atomic adds and
+	// reading never blocks it; a report taken while recording may be off by
+	// the samples in flight
+	struct Histogram {
+		std::array<std::atomic<uint64_t>, N_BUCKETS> buckets{};
+		std::atomic<uint64_t> count{0};
+		std::atomic<uint64_t> max{0};
+
+		void record(uint64_t ns) {
+			buckets[bucket_of(ns)].fetch_add(1, std::memory_order_relaxed);
+			count.fetch_add(1, std::memory_order_relaxed);
+			uint64_t m = max.load(std::memory_order_relaxed);
+			while (ns > m && !max.compare_exchange_weak(m, ns, std::memory_order_relaxed)) {
+			}
+		}
+
+		StageLatency report() const {
+			StageLatency out{};
+			out.count  = count.load(std::memory_order_relaxed);
+			out.max_ns = max.load(std::memory_order_relaxed);
+			if (out.count == 0) {
+				return out;
+			}
+			// ranks of the percentiles, from 1
+			const uint64_t p50_rank = std::max<uint64_t>(1, (out.count * 50 + 99) / 100);
+			const uint64_t p99_rank = std::max<uint64_t>(1, (out.count * 99 + 99) / 100);
+			uint64_t seen           = 0;
+			bool has_p50            = false;
+			for (size_t i = 0; i < N_BUCKETS; i++) {
+				seen += buckets[i].load(std::memory_order_relaxed);
+				if (!has_p50 && seen >= p50_rank) {
+					out.p50_ns = std::min(value_of(i), out.max_ns);
+					has_p50    = true;
+				}
+				if (seen >= p99_rank) {
+					out.p99_ns = std::min(value_of(i), out.max_ns);
+					break;
+				}
+			}
+			return out;
+		}
+
+		void reset() {
+			for (auto &b : buckets) {
+				b.store(0, std::memory_order_relaxed);
+			}
+			count.store(0, std::memory_order_relaxed);
+			max.store(0, std::memory_order_relaxed);
+		}
+	};
+
+	std::atomic<bool> enabled{false};
+	std::array<Histogram, STAGE_COUNT> histograms;
+	std::atomic<uint64_t> dropped{0};
+}
+
+uint64_t now_ns() {
+	timespec ts{};
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return static_cast<uint64_t>(ts.tv_sec) * 1'000'000'000 + static_cast<uint64_t>(ts.tv_nsec);
+}
+
+bool is_enabled() {
+	return enabled.load(std::memory_order_relaxed);
+}
+
+void record(Stage stage, uint64_t ns) {
+	const auto i = static_cast<size_t>(stage);
+	if (i < STAGE_COUNT) {
+		histograms[i].record(ns);
+	}
+}
+}
+
+extern "C" {
+uint64_t aux_img_now_ns() noexcept {
+	return aux_img::latency::now_ns();
+}
+
+void aux_img_set_latency_enabled(bool enabled) noexcept {
+	aux_img::latency::enabled.store(enabled, std::memory_order_relaxed);
+}
+
+void aux_img_latency_record(aux_img::Stage stage, uint64_t ns) noexcept {
+	if (aux_img::latency::is_enabled()) {
+		aux_img::latency::record(stage, ns);
+	}
+}
+
+void aux_img_latency_add_dropped(uint64_t n) noexcept {
+	if (aux_img::latency::is_enabled()) {
+		aux_img::latency::dropped.fetch_add(n, std::memory_order_relaxed);
+	}
+}
+
+void aux_img_latency_report(aux_img::LatencyReport *out) noexcept {
+	if (out == nullptr) {
+		return;
+	}
+	for (size_t i = 0; i < aux_img::STAGE_COUNT; i++) {
+		out->stages[i] = aux_img::latency::histograms[i].report();
+	}
+	out->dropped = aux_img::latency::dropped.load(std::memory_order_relaxed);
+}
+
+void aux_img_latency_reset() noexcept {
+	for (auto &h : aux_img::latency::histograms) {
+		h.reset();
+	}
+	aux_img::latency::dropped.store(0, std::memory_order_relaxed);
+}
+}
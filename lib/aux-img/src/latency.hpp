@@ -0,0 +1,33 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <aux.hpp>
+
+// per stage latency histograms, see `aux_img_latency_report`
+namespace aux_img::latency {
+// nanoseconds of the monotonic clock shared with the client
+uint64_t now_ns();
+
+bool is_enabled();
+
+void record(Stage stage, uint64_t ns);
+
+// records the time from its construction to its destruction into `stage`,
+// if enabled at construction
+class Timer {
+public:
+	explicit Timer(Stage stage) : stage(stage), start(is_enabled() ? now_ns() : 0) {}
+	~Timer() {
+		if (start != 0) {
+			record(stage, now_ns() - start);
+		}
+	}
+	Timer(const Timer &)            = delete;
+	Timer &operator=(const Timer &) = delete;
+
+private:
+	Stage stage;
+	uint64_t start;
+};
+}
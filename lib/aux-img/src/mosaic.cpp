@@ -0,0 +1,234 @@
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <stdexcept>
+#include <vector>
+#include <opencv2/imgproc.hpp>
+#include <aux.hpp>
+#include "composite.hpp"
+#include "pool.hpp"
+#include "status.hpp"
+
+namespace aux_img {
+namespace {
+	constexpr size_t CACHE_LINE = 64;
+}
+
+// one output image split into a grid of tiles, one per camera
+//
+// `set_frame` downsamples the frame right away, within the call of the thread
+// receiving it, so that nothing outlives the call (a shared memory frame is
+// rewritten or unmapped after its callback); the downsample is split into
+// stripes on the shared pool. `compose` then only converts every tile with a
+// newer downsample into the image, concurrently on the shared pool
+struct Mosaic {
+	struct Rect {
+		int x = 0, y = 0, cols = 0, rows = 0;
+		bool operator==(const Rect &) const = default;
+	};
+
+	// a downsampled frame, in the format of the frame
+	struct Scaled {
+		cv::Mat mat;
+		PixelFormat pixel_format = PixelFormat::BGR;
+		Rect fitted;
+	};
+
+	struct alignas(CACHE_LINE) Tile {
+		// serializes `set_frame` of the tile, i.e. `back`
+		std::mutex write_mutex;
+		Scaled back;
+		// protected by `mutex`, which is never held during a downsample
+		std::mutex mutex;
+		Scaled staged;
+		bool is_dirty = false;
+		// compose only
+		Scaled front;
+		Rect drawn;
+	};
+
+	MosaicLayout layout;
+	size_t step;
+	std::vector<uint8_t> image;
+	std::unique_ptr<Tile[]> tiles;
+	// tiles taken by the current `compose`
+	std::vector<size_t> pending;
+
+	explicit Mosaic(const MosaicLayout &layout)
+		: layout(layout),
+		  step(aux_img_composite_step(static_cast<uint16_t>(layout.grid_cols * layout.tile_cols), layout.format, true)),
+		  image(step * layout.grid_rows * layout.tile_rows, 0),
+		  tiles(std::make_unique<Tile[]>(size())) {
+		pending.reserve(size());
+	}
+
+	size_t size() const { return static_cast<size_t>(layout.grid_cols) * layout.grid_rows; }
+
+	// the largest rect of the tile with the aspect ratio of the frame, centered
+	Rect fit(const SharedMat &frame) const {
+		const double scale = std::min(static_cast<double>(layout.tile_cols) / frame.cols,
+									  static_cast<double>(layout.tile_rows) / frame.rows);
+		const int cols     = std::clamp(static_cast<int>(std::lround(frame.cols * scale)), 1, int{layout.tile_cols});
+		const int rows     = std::clamp(static_cast<int>(std::lround(frame.rows * scale)), 1, int{layout.tile_rows});
+		return {(layout.tile_cols - cols) / 2, (layout.tile_rows - rows) / 2, cols, rows};
+	}
+
+	// `cv::INTER_AREA` into `dst`, in stripes of output rows on the shared pool
+	//
+	// a stripe starts on a source row that is also the start of an output
+	// row, i.e. at multiples of `src.rows / gcd` rows, so that every stripe
+	// has the scale of the whole frame and the result is the same as a single
+	// `cv::resize`. Sizes without such rows are done in one go
+	static void resize_area(const cv::Mat &src, cv::Mat &dst, const Rect &fitted) {
+		constexpr int MIN_STRIPE_ROWS = 8;
+		dst.create(fitted.rows, fitted.cols, src.type());
+		const int g        = std::gcd(src.rows, fitted.rows);
+		const int unit_dst = fitted.rows / g;
+		const int unit_src = src.rows / g;
+		const auto pool    = shared_pool();
+		// about two stripes per thread, for the uneven ones
+		const int n_stripes = pool == nullptr ? 1 : std::clamp(std::min(static_cast<int>(pool->size()) * 2, fitted.rows / MIN_STRIPE_ROWS), 1, g);
+		if (n_stripes == 1) {
+			cv::resize(src, dst, dst.size(), 0, 0, cv::INTER_AREA);
+			return;
+		}
+		pool->parallel_for(static_cast<size_t>(n_stripes), [&](size_t k) {
+			const int u0 = static_cast<int>(k) * g / n_stripes;
+			const int u1 = static_cast<int>(k + 1) * g / n_stripes;
+			// a view of `dst`, which `cv::resize` writes into as is
+			cv::Mat stripe = dst.rowRange(u0 * unit_dst, u1 * unit_dst);
+			cv::resize(src.rowRange(u0 * unit_src, u1 * unit_src), stripe, stripe.size(), 0, 0, cv::INTER_AREA);
+		});
+	}
+
+	void set_frame(size_t index, const SharedMat &frame) {
+		auto &tile = tiles[index];
+		std::lock_guard write_lk(tile.write_mutex);
+		auto &back        = tile.back;
+		back.fitted       = fit(frame);
+		back.pixel_format = frame.pixel_format;
+		const auto n_src  = static_cast<int>(composite::channels_of(frame.pixel_format));
+		const cv::Mat src(frame.rows, frame.cols, CV_8UC(n_src), frame.data);
+		// area averaging, i.e. no aliasing for the usual 4-8x reduction; the
+		// frame is scaled in its own format and only the tile is converted
+		resize_area(src, back.mat, back.fitted);
+		std::lock_guard lk(tile.mutex);
+		std::swap(tile.staged, back);
+		tile.is_dirty = true;
+	}
+
+	uint8_t *tile_origin(size_t index) {
+		const size_t x = index % layout.grid_cols * layout.tile_cols;
+		const size_t y = index / layout.grid_cols * layout.tile_rows;
+		return image.data() + y * step + x * composite::channels_of(layout.format);
+	}
+
+	void draw(size_t index) {
+		auto &tile         = tiles[index];
+		const auto &front  = tile.front;
+		uint8_t *origin    = tile_origin(index);
+		const size_t n_dst = composite::channels_of(layout.format);
+		if (front.fitted != tile.drawn) {
+			// the letterbox of the previous frame may show otherwise
+			for (int y = 0; y < layout.tile_rows; y++) {
+				std::memset(origin + y * step, 0, layout.tile_cols * n_dst);
+			}
+			tile.drawn = front.fitted;
+		}
+		composite::convert_rows(front.mat.data,
+								front.mat.step,
+								front.pixel_format,
+								origin + front.fitted.y * step + front.fitted.x * n_dst,
+								step,
+								layout.format,
+								front.fitted.rows,
+								front.fitted.cols,
+								false);
+	}
+
+	size_t compose() {
+		pending.clear();
+		for (size_t i = 0; i < size(); i++) {
+			auto &tile = tiles[i];
+			std::lock_guard lk(tile.mutex);
+			if (tile.is_dirty) {
+				pending.push_back(i);
+				std::swap(tile.front, tile.staged);
+				tile.is_dirty = false;
+			}
+		}
+		if (auto pool = shared_pool(); pool != nullptr && pending.size() > 1) {
+			pool->parallel_for(pending.size(), [&](size_t k) { draw(pending[k]); });
+		} else {
+			for (const auto i : pending) {
+				draw(i);
+			}
+		}
+		return pending.size();
+	}
+};
+}
+
+extern "C" {
+aux_img::Status aux_img_mosaic_create(aux_img::MosaicLayout layout, aux_img::Mosaic **out) noexcept {
+	return aux_img::guard([&] {
+		if (out == nullptr) {
+			throw std::invalid_argument("out == nullptr");
+		}
+		if (layout.grid_cols == 0 || layout.grid_rows == 0 || layout.tile_cols == 0 || layout.tile_rows == 0) {
+			throw std::invalid_argument("empty mosaic layout");
+		}
+		if (static_cast<size_t>(layout.grid_cols) * layout.tile_cols > UINT16_MAX ||
+			static_cast<size_t>(layout.grid_rows) * layout.tile_rows > UINT16_MAX) {
+			throw std::invalid_argument("mosaic larger than 65535 pixels");
+		}
+		*out = new aux_img::Mosaic(layout);
+	});
+}
+
+void aux_img_mosaic_destroy(aux_img::Mosaic *mosaic) noexcept {
+	delete mosaic;
+}
+
+aux_img::Status aux_img_mosaic_set_frame(aux_img::Mosaic *mosaic, size_t index, aux_img::SharedMat frame) noexcept {
+	return aux_img::guard([&] {
+		if (mosaic == nullptr) {
+			throw std::invalid_argument("mosaic == nullptr");
+		}
+		if (index >= mosaic->size()) {
+			throw std::invalid_argument("tile index out of range");
+		}
+		if (frame.data == nullptr || frame.rows == 0 || frame.cols == 0) {
+			throw std::invalid_argument("empty frame");
+		}
+		if (!aux_img::composite::is_supported_source(frame)) {
+			throw std::invalid_argument("unsupported frame format");
+		}
+		mosaic->set_frame(index, frame);
+	});
+}
+
+aux_img::Status aux_img_mosaic_compose(aux_img::Mosaic *mosaic, size_t *n_updated) noexcept {
+	return aux_img::guard([&] {
+		if (mosaic == nullptr) {
+			throw std::invalid_argument("mosaic == nullptr");
+		}
+		const auto n = mosaic->compose();
+		if (n_updated != nullptr) {
+			*n_updated = n;
+		}
+	});
+}
+
+aux_img::CompositeTarget aux_img_mosaic_image(aux_img::Mosaic *mosaic) noexcept {
+	if (mosaic == nullptr) {
+		return {nullptr, 0, aux_img::OutputFormat::BGR};
+	}
+	return {mosaic->image.data(), mosaic->step, mosaic->layout.format};
+}
+}
@@ -0,0 +1,131 @@
+#include <atomic>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <aux.hpp>
+#include "pool.hpp"
+#include "status.hpp"
+
+namespace aux_img {
+ThreadPool::ThreadPool(size_t n_threads) {
+	const auto n_workers = n_threads > 1 ? n_threads - 1 : 0;
+	workers.reserve(n_workers);
+	for (size_t i = 0; i < n_workers; i++) {
+		workers.emplace_back([this] { worker_loop(); });
+	}
+}
+
+ThreadPool::~ThreadPool() {
+	{
+		std::lock_guard lk(mutex);
+		is_stopping = true;
+	}
+	cv_start.notify_all();
+	for (auto &w : workers) {
+		w.join();
+	}
+}
+
+void ThreadPool::drain(TaskFn fn, void *ctx, size_t n) {
+	for (auto i = next.fetch_add(1, std::memory_order_relaxed); i < n; i = next.fetch_add(1, std::memory_order_relaxed)) {
+		// a task failing on a worker must not take the process down, nor let
+		// `run` return while the others still use `ctx`
+		try {
+			fn(i, ctx);
+		} catch (...) {
+			std::lock_guard lk(error_mutex);
+			if (!error) {
+				error = std::current_exception();
+			}
+		}
+	}
+}
+
+void ThreadPool::worker_loop() {
+	uint64_t seen = 0;
+	for (;;) {
+		TaskFn fn;
+		void *ctx;
+		size_t n;
+		{
+			std::unique_lock lk(mutex);
+			cv_start.wait(lk, [&] { return is_stopping || generation != seen; });
+			if (is_stopping) {
+				return;
+			}
+			seen = generation;
+			fn   = job_fn;
+			ctx  = job_ctx;
+			n    = job_size;
+			n_active++;
+		}
+		drain(fn, ctx, n);
+		{
+			std::lock_guard lk(mutex);
+			n_active--;
+		}
+		cv_done.notify_one();
+	}
+}
+
+void ThreadPool::run(size_t n, TaskFn fn, void *ctx) {
+	if (n == 0) {
+		return;
+	}
+	std::lock_guard run_lk(run_mutex);
+	if (workers.empty() || n == 1) {
+		for (size_t i = 0; i < n; i++) {
+			fn(i, ctx);
+		}
+		return;
+	}
+	{
+		std::unique_lock lk(mutex);
+		// a worker waking up late for the previous job may still be looking
+		// at `next`
+		cv_done.wait(lk, [&] { return n_active == 0; });
+		job_fn   = fn;
+		job_ctx  = ctx;
+		job_size = n;
+		next.store(0, std::memory_order_relaxed);
+		generation++;
+	}
+	cv_start.notify_all();
+	drain(fn, ctx, n);
+	// every task has been claimed; wait for the ones still running
+	{
+		std::unique_lock lk(mutex);
+		cv_done.wait(lk, [&] { return n_active == 0; });
+	}
+	if (auto e = std::exchange(error, nullptr); e) {
+		std::rethrow_exception(e);
+	}
+}
+
+namespace {
+	std::atomic<std::shared_ptr<ThreadPool>> pool_instance;
+}
+
+std::shared_ptr<ThreadPool> shared_pool() {
+	return pool_instance.load(std::memory_order_acquire);
+}
+}
+
+extern "C" {
+void aux_img_set_num_threads(int n_threads) noexcept {
+	if (n_threads <= 1) {
+		aux_img::pool_instance.store(nullptr, std::memory_order_release);
+		return;
+	}
+	// the previous pool (if any) is kept when the threads cannot be started
+	aux_img::guard([&] {
+		aux_img::pool_instance.store(std::make_shared<aux_img::ThreadPool>(static_cast<size_t>(n_threads)), std::memory_order_release);
+	});
+}
+
+int aux_img_get_num_threads() noexcept {
+	const auto pool = aux_img::shared_pool();
+	return pool == nullptr ? 1 : static_cast<int>(pool->size());
+}
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace aux_img {
+// a persistent pool owned by the library; the calling thread takes part in
+// the work, so a pool of `n` threads owns `n - 1` workers
+//
+// `run` is serialized; it must not be called from within a task
+class ThreadPool {
+public:
+	using TaskFn = void (*)(size_t index, void *ctx);
+
+	explicit ThreadPool(size_t n_threads);
+	~ThreadPool();
+	ThreadPool(const ThreadPool &)            = delete;
+	ThreadPool &operator=(const ThreadPool &) = delete;
+
+	size_t size() const { return workers.size() + 1; }
+
+	// call `fn(i, ctx)` for every i in [0, n), and wait for all of them; the
+	// first exception thrown by a task is rethrown once they are done
+	void run(size_t n, TaskFn fn, void *ctx);
+
+	template <typename F>
+	void parallel_for(size_t n, F &&f) {
+		using Fn = std::remove_reference_t<F>;
+		run(n, [](size_t i, void *ctx) { (*static_cast<Fn *>(ctx))(i); }, &f);
+	}
+
+private:
+	void worker_loop();
+	void drain(TaskFn fn, void *ctx, size_t n);
+
+	std::vector<std::thread> workers;
+	std::mutex run_mutex;
+	std::mutex mutex;
+	std::condition_variable cv_start;
+	std::condition_variable cv_done;
+	// protected by `mutex`
+	uint64_t generation = 0;
+	bool is_stopping    = false;
+	size_t n_active     = 0;
+	// current job
+	TaskFn job_fn            = nullptr;
+	void *job_ctx            = nullptr;
+	size_t job_size          = 0;
+	std::atomic<size_t> next = 0;
+	// first failure of the current job
+	std::mutex error_mutex;
+	std::exception_ptr error;
+};
+
+// the pool set with `aux_img_set_num_threads`, or `nullptr` if drawing is
+// single threaded
+std::shared_ptr<ThreadPool> shared_pool();
+}
@@ -0,0 +1,118 @@
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+#include <opencv2/imgproc.hpp>
+#include <aux.hpp>
+#include "composite.hpp"
+#include "status.hpp"
+#include "target.hpp"
+
+namespace aux_img {
+namespace {
+	constexpr size_t NUM_KEYPOINTS = 133;
+
+	// the frame at the size of `dst`, in its own format; only the small image
+	// is converted afterwards
+	SharedMat scale_frame(const SharedMat &src, const PreviewTarget &dst) {
+		thread_local cv::Mat scaled;
+		const auto channels = static_cast<int>(composite::channels_of(src.pixel_format));
+		const cv::Mat frame(src.rows, src.cols, CV_8UC(channels), src.data);
+		// area averaging is the one without aliasing when shrinking, and
+		// OpenCV vectorizes it (with a fast path for integer factors)
+		const bool is_shrinking = dst.cols <= src.cols && dst.rows <= src.rows;
+		cv::resize(frame, scaled, cv::Size(dst.cols, dst.rows), 0, 0, is_shrinking ? cv::INTER_AREA : cv::INTER_LINEAR);
+		return {scaled.data, dst.rows, dst.cols, src.depth, src.pixel_format};
+	}
+
+	struct ScaledPoses {
+		const float *keypoints;
+		const uint16_t *boxes;
+	};
+
+	ScaledPoses scale_poses(const float *keypoints, size_t n_people, const uint16_t *boxes, size_t n_boxes, Layout layout, float sx, float sy) {
+		thread_local std::vector<float> scaled_keypoints;
+		thread_local std::vector<uint16_t> scaled_boxes;
+		scaled_keypoints.resize(n_people * NUM_KEYPOINTS * 2);
+		scaled_boxes.resize(n_boxes * 4);
+		for (size_t p = 0; p < n_people; p++) {
+			const float *in = keypoints + p * NUM_KEYPOINTS * 2;
+			float *out      = scaled_keypoints.data() + p * NUM_KEYPOINTS * 2;
+			if (layout == Layout::RowMajor) {
+				for (size_t k = 0; k < NUM_KEYPOINTS * 2; k += 2) {
+					out[k]     = in[k] * sx;
+					out[k + 1] = in[k + 1] * sy;
+				}
+			} else {
+				for (size_t k = 0; k < NUM_KEYPOINTS; k++) {
+					out[k]                 = in[k] * sx;
+					out[NUM_KEYPOINTS + k] = in[NUM_KEYPOINTS + k] * sy;
+				}
+			}
+		}
+		for (size_t i = 0; i < n_boxes * 4; i += 2) {
+			scaled_boxes[i]     = static_cast<uint16_t>(std::lround(boxes[i] * sx));
+			scaled_boxes[i + 1] = static_cast<uint16_t>(std::lround(boxes[i + 1] * sy));
+		}
+		return {scaled_keypoints.data(), scaled_boxes.data()};
+	}
+}
+
+void preview_poses(const SharedMat &src,
+				   const PreviewTarget &dst,
+				   const float *keypoints,
+				   size_t n_people,
+				   const uint16_t *boxes,
+				   size_t n_boxes,
+				   const DrawPosesOptions &options,
+				   CullStats &stats) {
+	if (!composite::is_supported_source(src)) {
+		throw std::invalid_argument("unsupported source for a preview");
+	}
+	if (src.data == nullptr || src.rows == 0 || src.cols == 0) {
+		throw std::invalid_argument("empty source");
+	}
+	if (dst.rows == 0 || dst.cols == 0) {
+		throw std::invalid_argument("empty preview");
+	}
+	if (n_people != 0 && keypoints == nullptr) {
+		throw std::invalid_argument("keypoints == nullptr with n_people != 0");
+	}
+	if (n_boxes != 0 && boxes == nullptr) {
+		throw std::invalid_argument("boxes == nullptr with n_boxes != 0");
+	}
+	const float sx     = static_cast<float>(dst.cols) / src.cols;
+	const float sy     = static_cast<float>(dst.rows) / src.rows;
+	const auto poses   = scale_poses(keypoints, n_people, boxes, n_boxes, options.skeleton.layout, sx, sy);
+	const auto preview = scale_frame(src, dst);
+	// radii and thicknesses are left as they are, i.e. in preview pixels
+	composite_poses(preview, CompositeTarget{dst.data, dst.step, dst.format}, poses.keypoints, n_people, poses.boxes, n_boxes, options, stats);
+}
+}
+
+extern "C" {
+aux_img::Status aux_img_preview_poses(aux_img::SharedMat src,
+									  aux_img::PreviewTarget dst,
+									  const float *keypoints,
+									  size_t n_people,
+									  const uint16_t *boxes,
+									  size_t n_boxes,
+									  aux_img::DrawPosesOptions options,
+									  aux_img::CullStats *stats) noexcept {
+	return aux_img::guard([&] {
+		aux_img::CullStats local_stats{};
+		aux_img::preview_poses(src, dst, keypoints, n_people, boxes, n_boxes, options, local_stats);
+		if (stats != nullptr) {
+			*stats = local_stats;
+		}
+	});
+}
+
+aux_img::Vec2f aux_img_preview_scale(aux_img::SharedMat src, aux_img::PreviewTarget dst) noexcept {
+	if (src.rows == 0 || src.cols == 0) {
+		return {0, 0};
+	}
+	return {static_cast<float>(dst.cols) / src.cols, static_cast<float>(dst.rows) / src.rows};
+}
+}
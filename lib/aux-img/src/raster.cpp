@@ -0,0 +1,157 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <opencv2/core.hpp>
+#include "raster.hpp"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace aux_img::raster {
+SpanColor::SpanColor(const cv::Scalar &color) {
+	const auto b = cv::saturate_cast<uint8_t>(color[0]);
+	const auto g = cv::saturate_cast<uint8_t>(color[1]);
+	const auto r = cv::saturate_cast<uint8_t>(color[2]);
+	for (int i = 0; i < 32; i++) {
+		pattern[i * 3]     = b;
+		pattern[i * 3 + 1] = g;
+		pattern[i * 3 + 2] = r;
+	}
+}
+
+DiscMask::DiscMask(int radius) : radius(radius), half_width(std::max(radius, 0) + 1, -1) {
+	if (radius < 0) {
+		return;
+	}
+	// see `Circle` in modules/imgproc/src/drawing.cpp
+	int err = 0, dx = radius, dy = 0, plus = 1, minus = (radius << 1) - 1;
+	while (dx >= dy) {
+		half_width[dy] = std::max(half_width[dy], dx);
+		half_width[dx] = std::max(half_width[dx], dy);
+		dy++;
+		err += plus;
+		plus += 2;
+		int mask = (err <= 0) - 1;
+		err -= minus & mask;
+		dx += mask;
+		minus -= mask & 2;
+	}
+}
+
+bool is_supported(const cv::Mat &mat) {
+	return mat.type() == CV_8UC3;
+}
+
+void fill_span(uint8_t *row, int x0, int x1, const SpanColor &color) {
+	if (x1 < x0) {
+		return;
+	}
+	uint8_t *dst     = row + static_cast<size_t>(x0) * 3;
+	size_t remaining = static_cast<size_t>(x1 - x0 + 1) * 3;
+#if defined(__AVX2__)
+	const auto p0 = _mm256_load_si256(reinterpret_cast<const __m256i *>(color.pattern));
+	const auto p1 = _mm256_load_si256(reinterpret_cast<const __m256i *>(color.pattern + 32));
+	const auto p2 = _mm256_load_si256(reinterpret_cast<const __m256i *>(color.pattern + 64));
+	while (remaining >= 96) {
+		_mm256_storeu_si256(reinterpret_cast<__m256i *>(dst), p0);
+		_mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + 32), p1);
+		_mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + 64), p2);
+		dst += 96;
+		remaining -= 96;
+	}
+	// the pattern is periodic on 48 bytes, so the lower half of each register
+	// carries the same 16 pixels
+	if (remaining >= 48) {
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(dst), _mm256_castsi256_si128(p0));
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(dst + 16), _mm256_extracti128_si256(p0, 1));
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(dst + 32), _mm256_castsi256_si128(p1));
+		dst += 48;
+		remaining -= 48;
+	}
+#elif defined(__SSE2__)
+	const auto p0 = _mm_load_si128(reinterpret_cast<const __m128i *>(color.pattern));
+	const auto p1 = _mm_load_si128(reinterpret_cast<const __m128i *>(color.pattern + 16));
+	const auto p2 = _mm_load_si128(reinterpret_cast<const __m128i *>(color.pattern + 32));
+	while (remaining >= 48) {
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(dst), p0);
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(dst + 16), p1);
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(dst + 32), p2);
+		dst += 48;
+		remaining -= 48;
+	}
+#else
+	while (remaining >= 48) {
+		std::memcpy(dst, color.pattern, 48);
+		dst += 48;
+		remaining -= 48;
+	}
+#endif
+	// always a multiple of 3, and the pattern starts at a pixel boundary
+	std::memcpy(dst, color.pattern, remaining);
+}
+
+void fill_disc(cv::Mat &mat, cv::Point center, const DiscMask &mask, const SpanColor &color) {
+	const int r = mask.radius;
+	if (r < 0) {
+		return;
+	}
+	const int y_begin = std::max(center.y - r, 0);
+	const int y_end   = std::min(center.y + r, mat.rows - 1);
+	for (int y = y_begin; y <= y_end; y++) {
+		const int hw = mask.half_width[std::abs(y - center.y)];
+		const int x0 = std::max(center.x - hw, 0);
+		const int x1 = std::min(center.x + hw, mat.cols - 1);
+		fill_span(mat.ptr<uint8_t>(y), x0, x1, color);
+	}
+}
+
+void thick_line(cv::Mat &mat, cv::Point p0, cv::Point p1, int thickness, const DiscMask &cap, const SpanColor &color, int row_offset) {
+	const double dx = p1.x - p0.x;
+	const double dy = p1.y - p0.y;
+	const double len = std::sqrt(dx * dx + dy * dy);
+	if (len > 0) {
+		// the body is a quad with half width of `thickness / 2`, same as
+		// `ThickLine` in OpenCV; a pixel is covered when its center is inside
+		const double hw = thickness * 0.5;
+		const double nx = -dy / len * hw;
+		const double ny = dx / len * hw;
+		const double qx[4] = {p0.x + nx, p0.x - nx, p1.x - nx, p1.x + nx};
+		const double qy[4] = {p0.y + ny, p0.y - ny, p1.y - ny, p1.y + ny};
+		const double min_y = std::min({qy[0], qy[1], qy[2], qy[3]});
+		const double max_y = std::max({qy[0], qy[1], qy[2], qy[3]});
+		const int y_begin  = std::max(static_cast<int>(std::ceil(min_y)), row_offset);
+		const int y_end    = std::min(static_cast<int>(std::floor(max_y)), row_offset + mat.rows - 1);
+		for (int y = y_begin; y <= y_end; y++) {
+			double xl = INFINITY;
+			double xr = -INFINITY;
+			for (int e = 0; e < 4; e++) {
+				const double ax = qx[e], ay = qy[e];
+				const double bx = qx[(e + 1) % 4], by = qy[(e + 1) % 4];
+				if ((y < ay && y < by) || (y > ay && y > by)) {
+					continue;
+				}
+				if (ay == by) {
+					xl = std::min({xl, ax, bx});
+					xr = std::max({xr, ax, bx});
+					continue;
+				}
+				const double x = ax + (y - ay) * (bx - ax) / (by - ay);
+				xl = std::min(xl, x);
+				xr = std::max(xr, x);
+			}
+			if (xl > xr) {
+				continue;
+			}
+			const int x0 = std::max(static_cast<int>(std::ceil(xl)), 0);
+			const int x1 = std::min(static_cast<int>(std::floor(xr)), mat.cols - 1);
+			fill_span(mat.ptr<uint8_t>(y - row_offset), x0, x1, color);
+		}
+	}
+	const auto offset = cv::Point(0, row_offset);
+	fill_disc(mat, p0 - offset, cap, color);
+	fill_disc(mat, p1 - offset, cap, color);
+}
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <opencv2/core.hpp>
+
+// a dedicated rasterizer for 8 bit, 3 channel images (`PixelFormat::BGR` or
+// `PixelFormat::RGB` with `Depth::U8`)
+//
+// every primitive is decomposed into horizontal spans, which are filled with
+// a pre-expanded color pattern using SSE2/AVX2 stores. Anything else should
+// go through OpenCV.
+namespace aux_img::raster {
+// a color repeated 32 times, i.e. 96 bytes, so that any 16/32 pixel run
+// could be stored with whole vector registers
+struct SpanColor {
+	alignas(32) uint8_t pattern[96];
+
+	SpanColor() = default;
+	explicit SpanColor(const cv::Scalar &color);
+};
+
+// half width of each row of a filled circle, indexed by |dy|
+//
+// produced by the same midpoint algorithm as OpenCV's `Circle` (i.e.
+// `cv::circle` with `thickness < 0`, `LINE_8` and `shift = 0`), so the
+// coverage is pixel identical
+struct DiscMask {
+	int radius = -1;
+	std::vector<int> half_width;
+
+	DiscMask() = default;
+	explicit DiscMask(int radius);
+};
+
+bool is_supported(const cv::Mat &mat);
+
+// fill [x0, x1] (inclusive) of one row; no clipping
+void fill_span(uint8_t *row, int x0, int x1, const SpanColor &color);
+
+void fill_disc(cv::Mat &mat, cv::Point center, const DiscMask &mask, const SpanColor &color);
+
+// thick line with round caps, approximating `cv::line` with `thickness > 1`
+// and `LINE_8`; may differ from OpenCV by one pixel along the edges
+//
+// `cap` should be `DiscMask((thickness + 1) / 2)`. `row_offset` is the row of
+// `mat` in the full image, for drawing into a band: the edges are computed in
+// image coordinates, so a band gets exactly its rows of the whole line
+void thick_line(cv::Mat &mat, cv::Point p0, cv::Point p1, int thickness, const DiscMask &cap, const SpanColor &color, int row_offset = 0);
+}
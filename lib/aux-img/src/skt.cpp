@@ -1,12 +1,29 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bitset>
 #include <cstdint>
 #include <cassert>
-#include <functional>
+#include <cmath>
 #include <format>
+#include <limits>
+#include <memory>
+#include <optional>
 #include <print>
 #include <span>
+#include <vector>
+#include <stdexcept>
 #include <aux.hpp>
 #include <opencv2/core.hpp>
 #include <opencv2/imgproc.hpp>
+#include "band.hpp"
+#include "composite.hpp"
+#include "latency.hpp"
+#include "pool.hpp"
+#include "raster.hpp"
+#include "status.hpp"
+#include "target.hpp"
+#include "yuv.hpp"
 
 #ifndef M_COLOR_SPINE
 #define M_COLOR_SPINE 138, 201, 38
@@ -39,7 +56,7 @@ struct Landmark {
 	uint8_t index;
 	color_t color;
 
-	uint8_t base_0_index() const {
+	constexpr uint8_t base_0_index() const {
 		assert(index > 0);
 		return index - 1;
 	}
@@ -228,12 +245,12 @@ struct Bone {
 	uint8_t end;
 	int color[3];
 
-	uint8_t base_0_start() const {
+	constexpr uint8_t base_0_start() const {
 		assert(start > 0);
 		return start - 1;
 	}
 
-	uint8_t base_0_end() const {
+	constexpr uint8_t base_0_end() const {
 		assert(end > 0);
 		return end - 1;
 	}
@@ -368,114 +385,806 @@ constexpr Bone hand_bones[] = {
 };
 
 
-auto for_each_landmark(std::function<void(Landmark)> callback) -> void {
-	for (const auto &landmark : body_landmarks) {
-		callback(landmark);
+// every distinct color used by the tables above; landmarks and bones refer
+// to it by index so that the `cv::Scalar`s are only built once
+constexpr uint8_t palette[][3] = {
+	{M_COLOR_SPINE},
+	{M_COLOR_ARMS},
+	{M_COLOR_LEGS},
+	{M_COLOR_FINGERS},
+	{M_COLOR_FACE},
+	{M_COLOR_FOOT},
+};
+constexpr auto NUM_COLORS = std::size(palette);
+
+template <typename T>
+constexpr uint8_t palette_index(const T (&color)[3]) {
+	for (size_t i = 0; i < NUM_COLORS; i++) {
+		if (palette[i][0] == color[0] && palette[i][1] == color[1] && palette[i][2] == color[2]) {
+			return static_cast<uint8_t>(i);
+		}
 	}
-	for (const auto &landmark : foot_landmarks) {
-		callback(landmark);
+	// not a constant expression; fails the compilation
+	throw std::invalid_argument("color not in palette");
+}
+
+// structure-of-arrays view of the landmark tables, with 0-based indices
+template <size_t N>
+struct LandmarkTable {
+	std::array<uint8_t, N> index;
+	std::array<uint8_t, N> color;
+};
+
+// structure-of-arrays view of the bone tables, with 0-based indices
+template <size_t N>
+struct BoneTable {
+	std::array<uint8_t, N> start;
+	std::array<uint8_t, N> end;
+	std::array<uint8_t, N> color;
+};
+
+template <size_t... Ns>
+consteval auto flatten_landmarks(const Landmark (&...tables)[Ns]) {
+	LandmarkTable<(Ns + ...)> flat{};
+	size_t i = 0;
+	auto append = [&](const auto &table) {
+		for (const auto &landmark : table) {
+			flat.index[i] = landmark.base_0_index();
+			flat.color[i] = palette_index(landmark.color);
+			i++;
+		}
+	};
+	(append(tables), ...);
+	return flat;
+}
+
+template <size_t... Ns>
+consteval auto flatten_bones(const Bone (&...tables)[Ns]) {
+	BoneTable<(Ns + ...)> flat{};
+	size_t i = 0;
+	auto append = [&](const auto &table) {
+		for (const auto &bone : table) {
+			flat.start[i] = bone.base_0_start();
+			flat.end[i]   = bone.base_0_end();
+			flat.color[i] = palette_index(bone.color);
+			i++;
+		}
+	};
+	(append(tables), ...);
+	return flat;
+}
+
+constexpr auto landmarks = flatten_landmarks(body_landmarks, foot_landmarks, face_landmarks, hand_landmarks);
+constexpr auto bones     = flatten_bones(body_bones, hand_bones);
+static_assert(landmarks.index.size() == NUM_KEYPOINTS);
+
+using Palette = std::array<cv::Scalar, NUM_COLORS>;
+const Palette palette_scalars = [] {
+	Palette scalars;
+	for (size_t i = 0; i < NUM_COLORS; i++) {
+		scalars[i] = cv::Scalar(palette[i][0], palette[i][1], palette[i][2]);
 	}
-	for (const auto &landmark : face_landmarks) {
-		callback(landmark);
+	return scalars;
+}();
+
+using Points = std::array<cv::Point, NUM_KEYPOINTS>;
+
+// subsets of the flat tables, dropped by the level of detail
+constexpr size_t FACE_LANDMARKS_BEGIN = std::size(body_landmarks) + std::size(foot_landmarks);
+constexpr size_t HAND_LANDMARKS_BEGIN = FACE_LANDMARKS_BEGIN + std::size(face_landmarks);
+constexpr size_t HAND_BONES_BEGIN     = std::size(body_bones);
+
+template <Layout L>
+Vec2f keypoint_at(const float *data, size_t i) {
+	if constexpr (L == Layout::RowMajor) {
+		return {data[i * 2], data[i * 2 + 1]};
+	} else {
+		return {data[i], data[NUM_KEYPOINTS + i]};
 	}
-	for (const auto &landmark : hand_landmarks) {
-		callback(landmark);
+}
+
+// row based with shape of (133, 2), or column based with shape of (2, 133)
+//
+// gather and truncate every keypoint once; branch free so that the compiler
+// could vectorize it
+template <Layout L>
+void to_points(const float *__restrict data, Points &pts) {
+	for (size_t i = 0; i < NUM_KEYPOINTS; i++) {
+		if constexpr (L == Layout::RowMajor) {
+			// with stride of 2
+			// https://learn.microsoft.com/en-us/windows/win32/medfound/image-stride
+			pts[i].x = static_cast<int>(data[i * 2]);
+			pts[i].y = static_cast<int>(data[i * 2 + 1]);
+		} else {
+			pts[i].x = static_cast<int>(data[i]);
+			pts[i].y = static_cast<int>(data[NUM_KEYPOINTS + i]);
+		}
 	}
 }
 
-auto for_each_bone(std::function<void(Bone)> callback) -> void {
-	for (const auto &bone : body_bones) {
-		callback(bone);
+// set by `aux_img_set_fast_raster`
+std::atomic<bool> is_fast_raster_enabled = true;
+
+// everything derived from the options and the target, prepared once per call
+// and shared by every person drawn within it
+struct SkeletonStyle {
+	DrawSkeletonOptions options;
+	const Palette *colors;
+	cv::Size frame;
+	// use `raster` instead of OpenCV for landmarks/bones
+	bool is_fast_landmarks;
+	bool is_fast_bones;
+	bool is_lod;
+	// how far outside the frame a primitive could still touch it
+	int landmark_pad;
+	int bone_pad;
+	raster::DiscMask landmark_mask;
+	raster::DiscMask bone_cap;
+	std::array<raster::SpanColor, NUM_COLORS> span_colors;
+
+	// `colors` replaces the palette, e.g. with the labels of a YUV overlay
+	SkeletonStyle(const cv::Mat &mat, const DrawSkeletonOptions &options, const Palette *colors = &palette_scalars)
+		: options(options), colors(colors), frame(mat.cols, mat.rows), is_fast_landmarks(false), is_fast_bones(false),
+		  is_lod(options.face_min_height > 0 || options.hand_min_height > 0),
+		  landmark_pad(options.landmark_radius + std::max(options.landmark_thickness, 0) + 1),
+		  bone_pad((options.bone_thickness + 1) / 2 + 1) {
+		if (!is_fast_raster_enabled.load(std::memory_order_relaxed) || !raster::is_supported(mat)) {
+			return;
+		}
+		// filled discs only; rings go through OpenCV
+		is_fast_landmarks = options.landmark_thickness < 0 && options.landmark_radius >= 0;
+		// `cv::line` uses Bresenham for `thickness <= 1`
+		is_fast_bones = options.bone_thickness > 1;
+		if (is_fast_landmarks) {
+			landmark_mask = raster::DiscMask(options.landmark_radius);
+		}
+		if (is_fast_bones) {
+			bone_cap = raster::DiscMask((options.bone_thickness + 1) / 2);
+		}
+		if (is_fast_landmarks || is_fast_bones) {
+			for (size_t i = 0; i < NUM_COLORS; i++) {
+				span_colors[i] = raster::SpanColor((*colors)[i]);
+			}
+		}
+	}
+};
+
+// keypoints of one person, and which of them survive the culling
+struct Person {
+	Points pts;
+	// not NaN/inf; bones between finite keypoints are clipped to the frame
+	std::bitset<NUM_KEYPOINTS> finite;
+	// finite and close enough to the frame for a landmark to show
+	std::bitset<NUM_KEYPOINTS> visible;
+	bool is_draw_face;
+	bool is_draw_hands;
+};
+
+template <Layout L>
+void to_person(const float *data, const SkeletonStyle &style, Person &person) {
+	if (!style.options.is_cull) {
+		to_points<L>(data, person.pts);
+		person.finite.set();
+		person.visible.set();
+	} else {
+		// far away keypoints only matter for the direction of their bones
+		constexpr float LIMIT = 1 << 20;
+		const auto pad        = static_cast<float>(style.landmark_pad);
+		const auto w          = static_cast<float>(style.frame.width);
+		const auto h          = static_cast<float>(style.frame.height);
+		for (size_t i = 0; i < NUM_KEYPOINTS; i++) {
+			const auto [x, y]     = keypoint_at<L>(data, i);
+			const bool is_finite  = std::isfinite(x) && std::isfinite(y);
+			const bool is_visible = is_finite && x > -pad && x < w + pad && y > -pad && y < h + pad;
+			person.finite[i]      = is_finite;
+			person.visible[i]     = is_visible;
+			person.pts[i]         = is_finite ? cv::Point(static_cast<int>(std::clamp(x, -LIMIT, LIMIT)),
+														  static_cast<int>(std::clamp(y, -LIMIT, LIMIT)))
+											  : cv::Point(0, 0);
+		}
 	}
-	for (const auto &bone : hand_bones) {
-		callback(bone);
+	person.is_draw_face  = true;
+	person.is_draw_hands = true;
+	if (style.is_lod) {
+		// the size of a person is the height spanned by its body and feet
+		int y_min = std::numeric_limits<int>::max();
+		int y_max = std::numeric_limits<int>::min();
+		for (size_t i = 0; i < FACE_LANDMARKS_BEGIN; i++) {
+			const auto k = landmarks.index[i];
+			if (person.finite[k]) {
+				y_min = std::min(y_min, person.pts[k].y);
+				y_max = std::max(y_max, person.pts[k].y);
+			}
+		}
+		const int height     = y_max >= y_min ? y_max - y_min : 0;
+		person.is_draw_face  = height >= style.options.face_min_height;
+		person.is_draw_hands = height >= style.options.hand_min_height;
 	}
 }
 
-void for_each_with_pair(std::span<const float> points, std::function<void(std::tuple<float, float>, int)> callback) {
-	if (points.size() % 2 != 0) {
-		throw std::invalid_argument("points.size() % 2 != 0");
+void to_person(const float *data, const SkeletonStyle &style, Person &person) {
+	if (style.options.layout == Layout::RowMajor) {
+		to_person<Layout::RowMajor>(data, style, person);
+	} else {
+		to_person<Layout::ColMajor>(data, style, person);
 	}
-	for (int i = 0; i < points.size(); i += 2) {
-		callback({points[i], points[i + 1]}, i / 2);
+}
+
+// call `on_bone(p0, p1, color)` and then `on_landmark(p, color)` for every
+// primitive of `person` that survives the level of detail and culling
+template <typename OnBone, typename OnLandmark>
+void for_each_primitive(const Person &person, const SkeletonStyle &style, CullStats &stats, OnBone &&on_bone, OnLandmark &&on_landmark) {
+	const auto &options = style.options;
+	const auto &pts     = person.pts;
+	if (options.is_draw_bones) {
+		const size_t n_bones = person.is_draw_hands ? bones.start.size() : HAND_BONES_BEGIN;
+		const auto clip_rect = cv::Rect(-style.bone_pad, -style.bone_pad, style.frame.width + 2 * style.bone_pad, style.frame.height + 2 * style.bone_pad);
+		for (size_t i = 0; i < n_bones; i++) {
+			auto p0 = pts[bones.start[i]];
+			auto p1 = pts[bones.end[i]];
+			if (options.is_cull) {
+				if (!person.finite[bones.start[i]] || !person.finite[bones.end[i]] || !cv::clipLine(clip_rect, p0, p1)) {
+					stats.bones_culled++;
+					continue;
+				}
+			}
+			on_bone(p0, p1, bones.color[i]);
+			stats.bones_drawn++;
+		}
+		stats.bones_culled += static_cast<uint32_t>(bones.start.size() - n_bones);
 	}
+	if (options.is_draw_landmarks) {
+		for (size_t i = 0; i < landmarks.index.size(); i++) {
+			const auto k         = landmarks.index[i];
+			const bool is_subset = i < FACE_LANDMARKS_BEGIN || (i < HAND_LANDMARKS_BEGIN ? person.is_draw_face : person.is_draw_hands);
+			if (!is_subset || !person.visible[k]) {
+				stats.landmarks_culled++;
+				continue;
+			}
+			on_landmark(pts[k], landmarks.color[i]);
+			stats.landmarks_drawn++;
+		}
+	}
+	stats.people_without_face += !person.is_draw_face;
+	stats.people_without_hands += !person.is_draw_hands;
 }
 
-// row based, with shape of (133, 2)
-void draw_whole_body_landmark_row_based(cv::Mat mat, std::span<const float> points, int radius = 3, int thickness = -1) {
-	if (points.size() != NUM_KEYPOINTS * 2) {
-		throw std::invalid_argument("points.size() != 133 * 2");
+inline void draw_landmark(cv::Mat &mat, cv::Point p, uint8_t color, const SkeletonStyle &style) {
+	if (style.is_fast_landmarks) {
+		raster::fill_disc(mat, p, style.landmark_mask, style.span_colors[color]);
+	} else {
+		cv::circle(mat, p, style.options.landmark_radius, (*style.colors)[color], style.options.landmark_thickness);
 	}
-	for_each_landmark([&points, &mat, radius, thickness](Landmark landmark) {
-		const auto index = landmark.base_0_index();
-		auto x           = static_cast<int>(points[index * 2]);
-		auto y           = static_cast<int>(points[index * 2 + 1]);
-		cv::circle(mat, {x, y}, radius, cv::Scalar(landmark.color[0], landmark.color[1], landmark.color[2]), thickness);
-	});
 }
 
-// column based, with shape of (2, 133)
-void draw_whole_body_landmark_col_based(cv::Mat mat, std::span<const float> points, int radius = 3, int thickness = -1) {
-	if (points.size() != NUM_KEYPOINTS * 2) {
-		throw std::invalid_argument("points.size() != 2 * 133");
-	}
-	for_each_landmark([xs = points.subspan(0, NUM_KEYPOINTS), ys = points.subspan(NUM_KEYPOINTS, NUM_KEYPOINTS),
-					   &mat, radius, thickness](Landmark landmark) {
-		const auto index = landmark.base_0_index();
-		auto x           = static_cast<int>(xs[index]);
-		auto y           = static_cast<int>(ys[index]);
-		cv::circle(mat, {x, y}, radius, cv::Scalar(landmark.color[0], landmark.color[1], landmark.color[2]), thickness);
-	});
+// `p0`/`p1` are in image coordinates; `row_offset` is the row of `mat` in the
+// image, for drawing into a band
+inline void draw_bone(cv::Mat &mat, cv::Point p0, cv::Point p1, uint8_t color, const SkeletonStyle &style, int row_offset = 0) {
+	if (style.is_fast_bones) {
+		raster::thick_line(mat, p0, p1, style.options.bone_thickness, style.bone_cap, style.span_colors[color], row_offset);
+	} else {
+		band::line(mat, row_offset, style.frame.height, p0, p1, (*style.colors)[color], style.options.bone_thickness);
+	}
 }
 
-// row based, with shape of (133, 2)
-void draw_whole_body_skeleton_row_based(cv::Mat mat, std::span<const float> points, int thickness = 2) {
+// draw bones and then landmarks of one person, according to `style`
+void draw_whole_body(cv::Mat &mat, std::span<const float> points, const SkeletonStyle &style, CullStats &stats) {
 	if (points.size() != NUM_KEYPOINTS * 2) {
 		throw std::invalid_argument("points.size() != 133 * 2");
 	}
-	for_each_bone([&points, &mat, thickness](Bone bone) {
-		const auto start_index = bone.base_0_start();
-		const auto end_index   = bone.base_0_end();
-		// with stride of 2
-		// https://learn.microsoft.com/en-us/windows/win32/medfound/image-stride
-		const auto start = cv::Point(static_cast<int>(points[start_index * 2]), static_cast<int>(points[start_index * 2 + 1]));
-		const auto end   = cv::Point(static_cast<int>(points[end_index * 2]), static_cast<int>(points[end_index * 2 + 1]));
-		cv::line(mat, start, end, cv::Scalar(bone.color[0], bone.color[1], bone.color[2]), thickness);
-	});
+	Person person;
+	to_person(points.data(), style, person);
+	for_each_primitive(
+		person, style, stats,
+		[&](cv::Point p0, cv::Point p1, uint8_t color) { draw_bone(mat, p0, p1, color, style); },
+		[&](cv::Point p, uint8_t color) { draw_landmark(mat, p, color, style); });
 }
 
-void draw_whole_body_skeleton_col_based(cv::Mat mat, std::span<const float> points, int thickness = 2) {
-	if (points.size() != NUM_KEYPOINTS * 2) {
-		throw std::invalid_argument("points.size() != 133 * 2");
+struct BoxStyle {
+	cv::Scalar color;
+	int thickness;
+};
+
+// one bone, landmark or box of a batch, already culled and clipped
+struct Primitive {
+	enum class Kind : uint8_t {
+		Bone,
+		Landmark,
+		Box,
+	};
+	Kind kind;
+	// index in `palette`, unused for boxes
+	uint8_t color;
+	cv::Point p0;
+	// unused for landmarks
+	cv::Point p1;
+};
+
+// every primitive of a batch in drawing order, with its vertical extent
+//
+// the storage is owned by the calling thread and reused by the next call
+struct Primitives {
+	std::span<const Primitive> items;
+	std::span<const band::Extent> extents;
+};
+
+Primitives collect_primitives(std::span<const float> keypoints,
+							  size_t n_people,
+							  std::span<const uint16_t> boxes,
+							  size_t n_boxes,
+							  const SkeletonStyle &style,
+							  const BoxStyle &box_style,
+							  CullStats &stats) {
+	constexpr auto stride = NUM_KEYPOINTS * 2;
+	thread_local std::vector<Primitive> primitives;
+	thread_local std::vector<band::Extent> extents;
+	primitives.clear();
+	extents.clear();
+
+	const int box_pad = box_style.thickness > 0 ? (box_style.thickness + 1) / 2 + 1 : 0;
+	Person person;
+	for (size_t p = 0; p < n_people; p++) {
+		to_person(keypoints.subspan(p * stride, stride).data(), style, person);
+		for_each_primitive(
+			person, style, stats,
+			[&](cv::Point p0, cv::Point p1, uint8_t color) {
+				primitives.push_back({Primitive::Kind::Bone, color, p0, p1});
+				extents.push_back(band::extent_of(p0.y, p1.y, style.bone_pad));
+			},
+			[&](cv::Point p, uint8_t color) {
+				primitives.push_back({Primitive::Kind::Landmark, color, p, {}});
+				extents.push_back(band::extent_of(p.y, p.y, style.landmark_pad));
+			});
+	}
+	for (size_t b = 0; b < n_boxes; b++) {
+		// [x1, y1, x2, y2]
+		const auto bb = boxes.subspan(b * 4, 4);
+		primitives.push_back({Primitive::Kind::Box, 0, cv::Point(bb[0], bb[1]), cv::Point(bb[2], bb[3])});
+		extents.push_back(band::extent_of(bb[1], bb[3], box_pad));
+	}
+	return {primitives, extents};
+}
+
+// draw `prim` into the band of rows starting at `band_y`
+inline void draw_primitive(cv::Mat &roi, int band_y, const Primitive &prim, const SkeletonStyle &style, const BoxStyle &box_style) {
+	const auto offset = cv::Point(0, band_y);
+	switch (prim.kind) {
+	case Primitive::Kind::Bone:
+		draw_bone(roi, prim.p0, prim.p1, prim.color, style, band_y);
+		break;
+	case Primitive::Kind::Landmark:
+		draw_landmark(roi, prim.p0 - offset, prim.color, style);
+		break;
+	case Primitive::Kind::Box:
+		cv::rectangle(roi, prim.p0 - offset, prim.p1 - offset, box_style.color, box_style.thickness);
+		break;
 	}
-	for_each_bone([xs = points.subspan(0, NUM_KEYPOINTS), ys = points.subspan(NUM_KEYPOINTS, NUM_KEYPOINTS),
-				   &mat, thickness](Bone bone) {
-		const auto start_index = bone.base_0_start();
-		const auto end_index   = bone.base_0_end();
-		const auto start       = cv::Point(static_cast<int>(xs[start_index]), static_cast<int>(ys[start_index]));
-		const auto end         = cv::Point(static_cast<int>(xs[end_index]), static_cast<int>(ys[end_index]));
-		cv::line(mat, start, end, cv::Scalar(bone.color[0], bone.color[1], bone.color[2]), thickness);
+}
+
+// same output as drawing the people and then the boxes one by one, but
+// rasterized in bands on `pool`; thin bones are traced over the whole frame
+// (`band::line`) and thick ones filled in frame coordinates, so no band
+// boundary shows
+void draw_poses_banded(ThreadPool &pool,
+					   cv::Mat &mat,
+					   std::span<const float> keypoints,
+					   size_t n_people,
+					   std::span<const uint16_t> boxes,
+					   size_t n_boxes,
+					   const SkeletonStyle &style,
+					   const BoxStyle &box_style,
+					   CullStats &stats) {
+	const auto prims = collect_primitives(keypoints, n_people, boxes, n_boxes, style, box_style, stats);
+	band::render(pool, mat, prims.extents, [&](cv::Mat &roi, int band_y, uint32_t k) {
+		draw_primitive(roi, band_y, prims.items[k], style, box_style);
 	});
 }
+
+// draw `n_people` skeletons and then `n_boxes` boxes, on the shared pool if
+// there is one
+void draw_poses(cv::Mat &mat,
+				const float *keypoints,
+				size_t n_people,
+				const uint16_t *boxes,
+				size_t n_boxes,
+				const SkeletonStyle &style,
+				const BoxStyle &box_style,
+				CullStats &stats) {
+	constexpr auto stride = NUM_KEYPOINTS * 2;
+	auto all_points       = std::span(keypoints, n_people * stride);
+	auto all_boxes        = std::span(boxes, n_boxes * 4);
+	if (auto pool = shared_pool(); pool != nullptr) {
+		draw_poses_banded(*pool, mat, all_points, n_people, all_boxes, n_boxes, style, box_style, stats);
+		return;
+	}
+	for (size_t i = 0; i < n_people; i++) {
+		draw_whole_body(mat, all_points.subspan(i * stride, stride), style, stats);
+	}
+	for (size_t i = 0; i < n_boxes; i++) {
+		// [x1, y1, x2, y2]
+		const auto bb = all_boxes.subspan(i * 4, 4);
+		cv::rectangle(mat, cv::Point(bb[0], bb[1]), cv::Point(bb[2], bb[3]), box_style.color, box_style.thickness);
+	}
 }
 
-extern "C" {
-void aux_img_draw_whole_body_skeleton_impl(aux_img::SharedMat mat, const float *data, aux_img::DrawSkeletonOptions options) {
-	cv::Mat cv_mat = aux_img::fromSharedMat(mat);
-	auto points    = std::span(data, aux_img::NUM_KEYPOINTS * 2);
-	if (options.is_draw_bones) {
-		if (options.layout == aux_img::Layout::RowMajor) {
-			aux_img::draw_whole_body_skeleton_row_based(cv_mat, points, options.bone_thickness);
-		} else {
-			aux_img::draw_whole_body_skeleton_col_based(cv_mat, points, options.bone_thickness);
+// a conservative bound of what `draw_poses` could touch: bones never leave
+// the bounding box of their endpoints
+template <Layout L>
+cv::Rect poses_bounds(const float *keypoints, size_t n_people, const uint16_t *boxes, size_t n_boxes, const SkeletonStyle &style, int box_pad) {
+	constexpr float LIMIT = 1 << 20;
+	float x_min = LIMIT, y_min = LIMIT, x_max = -LIMIT, y_max = -LIMIT;
+	for (size_t p = 0; p < n_people; p++) {
+		const float *data = keypoints + p * NUM_KEYPOINTS * 2;
+		for (size_t i = 0; i < NUM_KEYPOINTS; i++) {
+			const auto [x, y] = keypoint_at<L>(data, i);
+			if (std::isfinite(x) && std::isfinite(y)) {
+				x_min = std::min(x_min, x);
+				x_max = std::max(x_max, x);
+				y_min = std::min(y_min, y);
+				y_max = std::max(y_max, y);
+			}
 		}
 	}
-	if (options.is_draw_landmarks) {
-		if (options.layout == aux_img::Layout::RowMajor) {
-			aux_img::draw_whole_body_landmark_row_based(cv_mat, points, options.landmark_radius, options.landmark_thickness);
+	const int pad = std::max(style.landmark_pad, style.bone_pad);
+	auto bounds   = cv::Rect();
+	if (x_min <= x_max) {
+		const auto lo = cv::Point(static_cast<int>(std::clamp(x_min, -LIMIT, LIMIT)) - pad, static_cast<int>(std::clamp(y_min, -LIMIT, LIMIT)) - pad);
+		const auto hi = cv::Point(static_cast<int>(std::clamp(x_max, -LIMIT, LIMIT)) + pad + 1, static_cast<int>(std::clamp(y_max, -LIMIT, LIMIT)) + pad + 1);
+		bounds        = cv::Rect(lo, hi);
+	}
+	for (size_t b = 0; b < n_boxes; b++) {
+		const auto *bb  = boxes + b * 4;
+		const auto rect = cv::Rect(cv::Point(std::min(bb[0], bb[2]) - box_pad, std::min(bb[1], bb[3]) - box_pad),
+								   cv::Point(std::max(bb[0], bb[2]) + box_pad + 1, std::max(bb[1], bb[3]) + box_pad + 1));
+		bounds          = bounds.empty() ? rect : (bounds | rect);
+	}
+	return bounds;
+}
+
+bool is_same_options(const DrawSkeletonOptions &a, const DrawSkeletonOptions &b) {
+	return a.layout == b.layout && a.is_draw_landmarks == b.is_draw_landmarks && a.is_draw_bones == b.is_draw_bones &&
+		   a.landmark_radius == b.landmark_radius && a.landmark_thickness == b.landmark_thickness &&
+		   a.bone_thickness == b.bone_thickness && a.face_min_height == b.face_min_height &&
+		   a.hand_min_height == b.hand_min_height && a.is_cull == b.is_cull;
+}
+
+// `style_for` is what a canvas keeps between calls
+struct SkeletonCache {
+	DrawSkeletonOptions options;
+	bool is_fast_raster;
+	std::optional<SkeletonStyle> style;
+
+	// the style of `options`, rebuilt only if they (or the fast raster
+	// switch) changed since the last call; the frame shape never does
+	const SkeletonStyle &style_for(const cv::Mat &mat, const DrawSkeletonOptions &options) {
+		const bool is_fast = is_fast_raster_enabled.load(std::memory_order_relaxed);
+		if (!style || is_fast != is_fast_raster || !is_same_options(options, this->options)) {
+			style.emplace(mat, options);
+			this->options  = options;
+			is_fast_raster = is_fast;
+		}
+		return *style;
+	}
+
+};
+
+std::shared_ptr<SkeletonCache> make_skeleton_cache() {
+	return std::make_shared<SkeletonCache>();
+}
+
+// `draw_poses` on any supported frame; YUV frames go through an overlay
+void draw_poses(Target &target,
+				const float *keypoints,
+				size_t n_people,
+				const uint16_t *boxes,
+				size_t n_boxes,
+				const DrawSkeletonOptions &options,
+				const cv::Scalar &box_color,
+				int box_thickness,
+				CullStats &stats) {
+	const latency::Timer timer(Stage::Overlay);
+	if (n_people != 0 && keypoints == nullptr) {
+		throw std::invalid_argument("keypoints == nullptr with n_people != 0");
+	}
+	if (n_boxes != 0 && boxes == nullptr) {
+		throw std::invalid_argument("boxes == nullptr with n_boxes != 0");
+	}
+	const auto box_style = BoxStyle{box_color, box_thickness};
+	if (!target.is_yuv) {
+		if (auto *cache = target.skeleton_cache.get(); cache != nullptr) {
+			draw_poses(target.mat, keypoints, n_people, boxes, n_boxes, cache->style_for(target.mat, options), box_style, stats);
 		} else {
-			aux_img::draw_whole_body_landmark_col_based(cv_mat, points, options.landmark_radius, options.landmark_thickness);
+			draw_poses(target.mat, keypoints, n_people, boxes, n_boxes, SkeletonStyle(target.mat, options), box_style, stats);
 		}
+		return;
+	}
+	yuv::Overlay overlay(target.shared);
+	Palette labels;
+	for (size_t i = 0; i < NUM_COLORS; i++) {
+		labels[i] = overlay.label_of(palette_scalars[i]);
+	}
+	// always culled: only the labels within `poses_bounds` are resolved (and
+	// cleared), which leaves out non-finite keypoints, so a bone to one of
+	// them would stay in the label image and show on later frames. Culling
+	// drops exactly those, and clips the rest, which draws the same pixels.
+	auto culled          = options;
+	culled.is_cull       = true;
+	const auto style     = SkeletonStyle(overlay.labels(), culled, &labels);
+	const auto box_label = BoxStyle{overlay.label_of(box_style.color), box_style.thickness};
+	draw_poses(overlay.labels(), keypoints, n_people, boxes, n_boxes, style, box_label, stats);
+	const int box_pad = box_style.thickness > 0 ? (box_style.thickness + 1) / 2 + 1 : 0;
+	overlay.resolve(options.layout == Layout::RowMajor
+						? poses_bounds<Layout::RowMajor>(keypoints, n_people, boxes, n_boxes, style, box_pad)
+						: poses_bounds<Layout::ColMajor>(keypoints, n_people, boxes, n_boxes, style, box_pad));
+}
+
+// copy `src` into `out` band by band, drawing the primitives of each band
+// right after it is converted; `colors`/`box_style` are in the order of
+// `dst_format`
+void composite_poses(const SharedMat &src,
+					 cv::Mat &out,
+					 OutputFormat dst_format,
+					 const float *keypoints,
+					 size_t n_people,
+					 const uint16_t *boxes,
+					 size_t n_boxes,
+					 const SkeletonStyle &style,
+					 const BoxStyle &box_style,
+					 CullStats &stats) {
+	constexpr auto stride = NUM_KEYPOINTS * 2;
+	const auto prims      = collect_primitives(std::span(keypoints, n_people * stride), n_people,
+											   std::span(boxes, n_boxes * 4), n_boxes, style, box_style, stats);
+	const size_t src_step = static_cast<size_t>(src.cols) * composite::channels_of(src.pixel_format);
+	const auto pool       = shared_pool();
+	band::render_all(
+		pool.get(), out, prims.extents,
+		[&](cv::Mat &roi, int band_y, bool is_busy) {
+			// a band without primitives is never read back by us
+			composite::convert_rows(src.data + band_y * src_step, src_step, src.pixel_format,
+									roi.data, roi.step, dst_format, roi.rows, roi.cols, !is_busy);
+		},
+		[&](cv::Mat &roi, int band_y, uint32_t k) {
+			draw_primitive(roi, band_y, prims.items[k], style, box_style);
+		});
+}
+
+// `aux_img_composite_poses_impl`, validating its arguments
+void composite_poses(const SharedMat &src,
+					 const CompositeTarget &dst,
+					 const float *keypoints,
+					 size_t n_people,
+					 const uint16_t *boxes,
+					 size_t n_boxes,
+					 const DrawPosesOptions &options,
+					 CullStats &stats) {
+	const latency::Timer timer(Stage::Composite);
+	if (!composite::is_supported_source(src)) {
+		throw std::invalid_argument(std::format("Unsupported source pixel format {} and depth {}",
+												pixel_format_to_string(src.pixel_format),
+												depth_to_string(src.depth)));
+	}
+	const size_t channels = composite::channels_of(dst.format);
+	if (dst.data == nullptr || dst.step < src.cols * channels) {
+		throw std::invalid_argument("dst.data == nullptr || dst.step < cols * channels");
 	}
+	if (n_people != 0 && keypoints == nullptr) {
+		throw std::invalid_argument("keypoints == nullptr with n_people != 0");
+	}
+	if (n_boxes != 0 && boxes == nullptr) {
+		throw std::invalid_argument("boxes == nullptr with n_boxes != 0");
+	}
+	auto out = cv::Mat(src.rows, src.cols, CV_8UC(static_cast<int>(channels)), dst.data, dst.step);
+	// the palette is BGR; swap it for RGBA, and make it opaque
+	const bool is_rgb = dst.format == OutputFormat::RGBA;
+	auto in_order     = [&](const cv::Scalar &bgr) {
+		return is_rgb ? cv::Scalar(bgr[2], bgr[1], bgr[0], 255) : cv::Scalar(bgr[0], bgr[1], bgr[2], 255);
+	};
+	Palette colors;
+	for (size_t i = 0; i < NUM_COLORS; i++) {
+		colors[i] = in_order(palette_scalars[i]);
+	}
+	const auto box_color = in_order(cv::Scalar(options.bounding_box_color.x, options.bounding_box_color.y, options.bounding_box_color.z));
+	composite_poses(src, out, dst.format, keypoints, n_people, boxes, n_boxes,
+					SkeletonStyle(out, options.skeleton, &colors),
+					{box_color, options.bounding_box_thickness},
+					stats);
+}
+
+// color as exported in `GeometryBuffer`
+using Rgba = std::array<uint8_t, 4>;
+
+constexpr Rgba palette_rgba(size_t i) {
+	return {palette[i][0], palette[i][1], palette[i][2], 255};
+}
+
+Rgba to_rgba(const Vec3d &color) {
+	return {cv::saturate_cast<uint8_t>(color.x), cv::saturate_cast<uint8_t>(color.y), cv::saturate_cast<uint8_t>(color.z), 255};
+}
+
+// room needed by one person in a `GeometryBuffer`
+struct GeometryCount {
+	size_t segments;
+	size_t discs;
+	size_t quads;
 };
+
+bool has_room(const GeometryBuffer &out, const GeometryCount &count) {
+	return out.n_segments + count.segments <= out.segments_capacity &&
+		   out.n_discs + count.discs <= out.discs_capacity &&
+		   out.n_quads + count.quads <= out.quads_capacity;
+}
+
+GeometryCount skeleton_geometry_count(const DrawSkeletonOptions &options) {
+	return {options.is_draw_bones ? bones.start.size() : 0,
+			options.is_draw_landmarks ? landmarks.index.size() : 0,
+			0};
+}
+
+template <Layout L>
+void export_whole_body(const float *data, const DrawSkeletonOptions &options, GeometryBuffer &out) {
+	if (options.is_draw_bones) {
+		const auto thickness = static_cast<float>(options.bone_thickness);
+		for (size_t i = 0; i < bones.start.size(); i++) {
+			auto &seg = out.segments[out.n_segments++];
+			seg       = {keypoint_at<L>(data, bones.start[i]), keypoint_at<L>(data, bones.end[i]), thickness, {}};
+			std::ranges::copy(palette_rgba(bones.color[i]), seg.color);
+		}
+	}
+	if (options.is_draw_landmarks) {
+		const auto radius    = static_cast<float>(options.landmark_radius);
+		const auto thickness = static_cast<float>(options.landmark_thickness);
+		for (size_t i = 0; i < landmarks.index.size(); i++) {
+			auto &disc = out.discs[out.n_discs++];
+			disc       = {keypoint_at<L>(data, landmarks.index[i]), radius, thickness, {}};
+			std::ranges::copy(palette_rgba(landmarks.color[i]), disc.color);
+		}
+	}
+}
+
+void export_whole_body(const float *data, const DrawSkeletonOptions &options, GeometryBuffer &out) {
+	if (options.layout == Layout::RowMajor) {
+		export_whole_body<Layout::RowMajor>(data, options, out);
+	} else {
+		export_whole_body<Layout::ColMajor>(data, options, out);
+	}
+}
+
+void export_quad(Vec2f p0, Vec2f p1, const Rgba &color, int thickness, GeometryBuffer &out) {
+	auto &quad = out.quads[out.n_quads++];
+	quad       = {p0, p1, static_cast<float>(thickness), {}};
+	std::ranges::copy(color, quad.color);
+}
+}
+
+extern "C" {
+void aux_img_draw_whole_body_skeleton_impl(aux_img::SharedMat mat, const float *data, aux_img::DrawSkeletonOptions options) noexcept {
+	aux_img::guard([&] {
+		auto target = aux_img::Target(mat);
+		aux_img::CullStats stats{};
+		aux_img::draw_poses(target, data, 1, nullptr, 0, options, {}, 0, stats);
+	});
+}
+
+void aux_img_draw_poses_batch_impl(aux_img::SharedMat mat,
+								   const float *keypoints,
+								   size_t n_people,
+								   const uint16_t *boxes,
+								   size_t n_boxes,
+								   aux_img::DrawPosesOptions options,
+								   aux_img::CullStats *stats) noexcept {
+	aux_img::guard([&] {
+		auto target          = aux_img::Target(mat);
+		const auto box_color = cv::Scalar(options.bounding_box_color.x, options.bounding_box_color.y, options.bounding_box_color.z);
+		aux_img::CullStats local_stats{};
+		aux_img::draw_poses(target, keypoints, n_people, boxes, n_boxes, options.skeleton, box_color, options.bounding_box_thickness, local_stats);
+		if (stats != nullptr) {
+			*stats = local_stats;
+		}
+	});
+}
+
+size_t aux_img_composite_step(uint16_t cols, aux_img::OutputFormat format, bool is_row_aligned) noexcept {
+	const size_t step = static_cast<size_t>(cols) * aux_img::composite::channels_of(format);
+	return is_row_aligned ? (step + 3) & ~size_t{3} : step;
+}
+
+void aux_img_composite_poses_impl(aux_img::SharedMat src,
+							 aux_img::CompositeTarget dst,
+							 const float *keypoints,
+							 size_t n_people,
+							 const uint16_t *boxes,
+							 size_t n_boxes,
+							 aux_img::DrawPosesOptions options,
+							 aux_img::CullStats *stats) noexcept {
+	aux_img::guard([&] {
+		aux_img::CullStats local_stats{};
+		aux_img::composite_poses(src, dst, keypoints, n_people, boxes, n_boxes, options, local_stats);
+		if (stats != nullptr) {
+			*stats = local_stats;
+		}
+	});
+}
+
+void aux_img_set_fast_raster(bool enabled) noexcept {
+	aux_img::is_fast_raster_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+bool aux_img_export_whole_body_skeleton(const float *data, aux_img::DrawSkeletonOptions options, aux_img::GeometryBuffer *out) noexcept {
+	// nothing below allocates or throws
+	if (data == nullptr || out == nullptr) {
+		aux_img::set_last_error(aux_img::Status::InvalidArgument, "data == nullptr || out == nullptr");
+		return false;
+	}
+	if (!aux_img::has_room(*out, aux_img::skeleton_geometry_count(options))) {
+		return false;
+	}
+	aux_img::export_whole_body(data, options, *out);
+	return true;
+}
+
+bool aux_img_export_rectangle(aux_img::Vec2i start, aux_img::Vec2i end, aux_img::Vec3d color, int thickness, aux_img::GeometryBuffer *out) noexcept {
+	if (out == nullptr) {
+		aux_img::set_last_error(aux_img::Status::InvalidArgument, "out == nullptr");
+		return false;
+	}
+	if (!aux_img::has_room(*out, {0, 0, 1})) {
+		return false;
+	}
+	aux_img::export_quad({static_cast<float>(start.x), static_cast<float>(start.y)},
+						 {static_cast<float>(end.x), static_cast<float>(end.y)},
+						 aux_img::to_rgba(color), thickness, *out);
+	return true;
+}
+
+bool aux_img_export_poses_batch(const float *keypoints,
+								size_t n_people,
+								const uint16_t *boxes,
+								size_t n_boxes,
+								aux_img::DrawPosesOptions options,
+								aux_img::GeometryBuffer *out) noexcept {
+	if ((n_people != 0 && keypoints == nullptr) || (n_boxes != 0 && boxes == nullptr) || out == nullptr) {
+		aux_img::set_last_error(aux_img::Status::InvalidArgument, "keypoints, boxes or out == nullptr");
+		return false;
+	}
+	const auto per_person = aux_img::skeleton_geometry_count(options.skeleton);
+	if (!aux_img::has_room(*out, {per_person.segments * n_people, per_person.discs * n_people, n_boxes})) {
+		return false;
+	}
+	constexpr auto stride = aux_img::NUM_KEYPOINTS * 2;
+	for (size_t i = 0; i < n_people; i++) {
+		aux_img::export_whole_body(keypoints + i * stride, options.skeleton, *out);
+	}
+	const auto box_color = aux_img::to_rgba(options.bounding_box_color);
+	for (size_t i = 0; i < n_boxes; i++) {
+		// [x1, y1, x2, y2]
+		const uint16_t *bb = boxes + i * 4;
+		aux_img::export_quad({static_cast<float>(bb[0]), static_cast<float>(bb[1])},
+							 {static_cast<float>(bb[2]), static_cast<float>(bb[3])},
+							 box_color, options.bounding_box_thickness, *out);
+	}
+	return true;
+}
+
+void aux_img_rasterize_geometry(aux_img::SharedMat mat, const aux_img::GeometryBuffer *geometry) noexcept {
+	aux_img::guard([&] {
+		if (geometry == nullptr) {
+			throw std::invalid_argument("geometry == nullptr");
+		}
+		cv::Mat cv_mat = aux_img::fromSharedMat(mat);
+		auto to_point  = [](aux_img::Vec2f p) { return cv::Point(static_cast<int>(p.x), static_cast<int>(p.y)); };
+		auto to_scalar = [](const uint8_t (&c)[4]) { return cv::Scalar(c[0], c[1], c[2]); };
+		for (uint32_t i = 0; i < geometry->n_segments; i++) {
+			const auto &seg = geometry->segments[i];
+			cv::line(cv_mat, to_point(seg.p0), to_point(seg.p1), to_scalar(seg.color), static_cast<int>(seg.thickness));
+		}
+		for (uint32_t i = 0; i < geometry->n_discs; i++) {
+			const auto &disc = geometry->discs[i];
+			cv::circle(cv_mat, to_point(disc.center), static_cast<int>(disc.radius), to_scalar(disc.color), static_cast<int>(disc.thickness));
+		}
+		for (uint32_t i = 0; i < geometry->n_quads; i++) {
+			const auto &quad = geometry->quads[i];
+			cv::rectangle(cv_mat, to_point(quad.p0), to_point(quad.p1), to_scalar(quad.color), static_cast<int>(quad.thickness));
+		}
+	});
+}
 }
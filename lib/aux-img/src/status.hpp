@@ -0,0 +1,38 @@
+#pragma once
+
+#include <exception>
+#include <new>
+#include <stdexcept>
+#include <opencv2/core.hpp>
+#include <aux.hpp>
+
+// nothing may be thrown through the C ABI; every `extern "C"` function runs
+// its body through `guard`, which turns an exception into a `Status` and
+// keeps its message for `aux_img_last_error`
+namespace aux_img {
+// the message is copied into storage owned by the calling thread
+void set_last_error(Status status, const char *message) noexcept;
+
+template <typename F>
+Status guard(F &&f) noexcept {
+	try {
+		f();
+		return Status::Ok;
+	} catch (const std::invalid_argument &e) {
+		set_last_error(Status::InvalidArgument, e.what());
+		return Status::InvalidArgument;
+	} catch (const std::bad_alloc &e) {
+		set_last_error(Status::OutOfMemory, e.what());
+		return Status::OutOfMemory;
+	} catch (const cv::Exception &e) {
+		set_last_error(Status::OpenCVError, e.what());
+		return Status::OpenCVError;
+	} catch (const std::exception &e) {
+		set_last_error(Status::Unknown, e.what());
+		return Status::Unknown;
+	} catch (...) {
+		set_last_error(Status::Unknown, "unknown exception");
+		return Status::Unknown;
+	}
+}
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <opencv2/core.hpp>
+#include <aux.hpp>
+
+namespace aux_img {
+// skeleton styles kept by a canvas between calls; defined in `skt.cpp`
+struct SkeletonCache;
+
+// a validated `SharedMat`, with everything derived from its format
+//
+// built per call by the legacy entry points, and once by `aux_img_canvas_*`
+struct Target {
+	SharedMat shared;
+	// YUV formats are drawn through `yuv::Overlay`, and have no header
+	bool is_yuv;
+	cv::Mat mat;
+	// only set for a canvas
+	std::shared_ptr<SkeletonCache> skeleton_cache;
+
+	// throws `std::invalid_argument` for an unsupported format/depth
+	explicit Target(SharedMat shared);
+
+	// point to the next frame of the same shape and format
+	void rebind(uint8_t *data);
+};
+
+void put_text(Target &target, const char *text, cv::Point org, const cv::Scalar &color, double scale, int thickness, bool bottomLeftOrigin);
+
+void rectangle(Target &target, cv::Point start, cv::Point end, const cv::Scalar &color, int thickness);
+
+void draw_poses(Target &target,
+				const float *keypoints,
+				size_t n_people,
+				const uint16_t *boxes,
+				size_t n_boxes,
+				const DrawSkeletonOptions &options,
+				const cv::Scalar &box_color,
+				int box_thickness,
+				CullStats &stats);
+
+// throws `std::invalid_argument` for an unsupported source or a short `dst.step`
+void composite_poses(const SharedMat &src,
+					 const CompositeTarget &dst,
+					 const float *keypoints,
+					 size_t n_people,
+					 const uint16_t *boxes,
+					 size_t n_boxes,
+					 const DrawPosesOptions &options,
+					 CullStats &stats);
+
+// `composite_poses` into a smaller (or larger) `dst`, with the poses scaled
+void preview_poses(const SharedMat &src,
+				   const PreviewTarget &dst,
+				   const float *keypoints,
+				   size_t n_people,
+				   const uint16_t *boxes,
+				   size_t n_boxes,
+				   const DrawPosesOptions &options,
+				   CullStats &stats);
+
+std::shared_ptr<SkeletonCache> make_skeleton_cache();
+
+// field by field, as the struct has padding
+bool is_same_options(const DrawSkeletonOptions &a, const DrawSkeletonOptions &b);
+
+struct Canvas {
+	Target target;
+};
+
+// the target of `canvas`; throws if it is null
+Target &target_of(Canvas *canvas);
+}
@@ -0,0 +1,217 @@
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+#include <aux.hpp>
+#include "status.hpp"
+#include "text.hpp"
+
+namespace aux_img::text {
+namespace {
+constexpr auto FONT = cv::FONT_HERSHEY_SIMPLEX;
+// printable ASCII; anything else is drawn as '?', like `cv::putText`
+constexpr char FIRST_GLYPH = ' ';
+constexpr char LAST_GLYPH  = '~';
+constexpr size_t N_GLYPHS  = LAST_GLYPH - FIRST_GLYPH + 1;
+// bounds of the simplex glyphs at scale 1, relative to the baseline, with
+// some slack; the composed strings are trimmed afterwards
+constexpr double ASCENT  = 36;
+constexpr double DESCENT = 16;
+// atlases of other (scale, thickness) pairs are dropped beyond this
+constexpr size_t MAX_ATLASES = 8;
+
+struct Style {
+	double scale;
+	int thickness;
+	bool operator==(const Style &) const = default;
+};
+
+// every printable glyph of one style, side by side in one mask
+//
+// the cell of a glyph spans its advance plus `pad` on both sides, from
+// `ascent` above the baseline to `descent` below it
+struct Atlas {
+	Style style;
+	int pad;
+	int ascent;
+	int descent;
+	cv::Mat mask;
+	std::array<int, N_GLYPHS> cell_x;
+	std::array<double, N_GLYPHS> advance;
+
+	explicit Atlas(Style style)
+		: style(style), pad(std::max(style.thickness, 1) + 2),
+		  ascent(static_cast<int>(std::ceil(ASCENT * style.scale)) + pad),
+		  descent(static_cast<int>(std::ceil(DESCENT * style.scale)) + pad) {
+		int width = 0;
+		for (size_t i = 0; i < N_GLYPHS; i++) {
+			const char glyph[] = {static_cast<char>(FIRST_GLYPH + i), '\0'};
+			// the simplex bearings are integers, so this is the exact advance
+			int baseline = 0;
+			advance[i]   = cv::getTextSize(glyph, FONT, 1.0, 0, &baseline).width * style.scale;
+			cell_x[i]    = width;
+			width += static_cast<int>(std::ceil(advance[i])) + 2 * pad;
+		}
+		mask = cv::Mat::zeros(ascent + descent, width, CV_8UC1);
+		for (size_t i = 0; i < N_GLYPHS; i++) {
+			const char glyph[] = {static_cast<char>(FIRST_GLYPH + i), '\0'};
+			cv::putText(mask, glyph, cv::Point(cell_x[i] + pad, ascent), FONT, style.scale, cv::Scalar(255), style.thickness, cv::LINE_8);
+		}
+	}
+
+	cv::Rect cell(size_t i) const {
+		return {cell_x[i], 0, static_cast<int>(std::ceil(advance[i])) + 2 * pad, mask.rows};
+	}
+};
+
+struct Key {
+	std::string text;
+	Style style;
+	bool operator==(const Key &) const = default;
+};
+
+struct KeyHash {
+	size_t operator()(const Key &key) const {
+		auto h = std::hash<std::string>{}(key.text);
+		h ^= std::hash<double>{}(key.style.scale) + 0x9e3779b97f4a7c15 + (h << 6) + (h >> 2);
+		h ^= std::hash<int>{}(key.style.thickness) + 0x9e3779b97f4a7c15 + (h << 6) + (h >> 2);
+		return h;
+	}
+};
+
+// glyph index per character, decoding UTF-8 so that a multi-byte character
+// is a single '?'
+void to_glyphs(const char *text, std::vector<uint8_t> &glyphs) {
+	glyphs.clear();
+	for (auto s = reinterpret_cast<const uint8_t *>(text); *s != '\0'; s++) {
+		const auto c = *s;
+		if ((c & 0xC0) == 0x80) {
+			// continuation byte
+			continue;
+		}
+		const bool is_printable = c >= FIRST_GLYPH && c <= LAST_GLYPH;
+		glyphs.push_back(static_cast<uint8_t>((is_printable ? c : '?') - FIRST_GLYPH));
+	}
+}
+
+Label compose(const Atlas &atlas, const std::vector<uint8_t> &glyphs) {
+	double width = 0;
+	for (auto g : glyphs) {
+		width += atlas.advance[g];
+	}
+	auto mask = cv::Mat(atlas.mask.rows, static_cast<int>(std::ceil(width)) + 2 * atlas.pad, CV_8UC1, cv::Scalar(0));
+	double x  = 0;
+	for (auto g : glyphs) {
+		const auto cell = atlas.cell(g);
+		const auto dst  = cv::Rect(static_cast<int>(std::lround(x)), 0, cell.width, cell.height) & cv::Rect(0, 0, mask.cols, mask.rows);
+		auto roi        = mask(dst);
+		// the padding of neighbouring cells overlaps
+		cv::max(roi, atlas.mask(cv::Rect(cell.x, 0, dst.width, dst.height)), roi);
+		x += atlas.advance[g];
+	}
+	const auto bounds = cv::boundingRect(mask);
+	if (bounds.empty()) {
+		return {};
+	}
+	// the cell origin is at (pad, ascent)
+	return {mask(bounds).clone(), cv::Point(bounds.x - atlas.pad, bounds.y - atlas.ascent)};
+}
+
+class Cache {
+public:
+	std::shared_ptr<const Label> get(const char *text, Style style) {
+		std::lock_guard lock(mutex);
+		key.text  = text;
+		key.style = style;
+		if (auto it = index.find(key); it != index.end()) {
+			lru.splice(lru.begin(), lru, it->second);
+			return it->second->second;
+		}
+		to_glyphs(text, glyphs);
+		auto label = std::make_shared<const Label>(compose(atlas(style), glyphs));
+		if (capacity == 0) {
+			return label;
+		}
+		lru.emplace_front(key, label);
+		index.emplace(key, lru.begin());
+		trim();
+		return label;
+	}
+
+	void set_capacity(size_t n) {
+		std::lock_guard lock(mutex);
+		capacity = n;
+		trim();
+	}
+
+private:
+	using Entry = std::pair<Key, std::shared_ptr<const Label>>;
+
+	const Atlas &atlas(Style style) {
+		for (auto it = atlases.begin(); it != atlases.end(); ++it) {
+			if (it->style == style) {
+				atlases.splice(atlases.begin(), atlases, it);
+				return atlases.front();
+			}
+		}
+		atlases.emplace_front(style);
+		if (atlases.size() > MAX_ATLASES) {
+			atlases.pop_back();
+		}
+		return atlases.front();
+	}
+
+	void trim() {
+		while (lru.size() > capacity) {
+			index.erase(lru.back().first);
+			lru.pop_back();
+		}
+	}
+
+	std::mutex mutex;
+	size_t capacity = 256;
+	// most recently used first
+	std::list<Entry> lru;
+	std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> index;
+	std::list<Atlas> atlases;
+	// scratch, reused between calls
+	Key key;
+	std::vector<uint8_t> glyphs;
+};
+
+Cache &cache() {
+	static Cache instance;
+	return instance;
+}
+}
+
+std::shared_ptr<const Label> label(const char *text, double scale, int thickness) {
+	return cache().get(text, {scale, thickness});
+}
+
+void blit(cv::Mat &mat, const Label &label, cv::Point org, const cv::Scalar &color, int row_offset) {
+	const auto top_left = org + label.offset - cv::Point(0, row_offset);
+	const auto rect     = cv::Rect(top_left, label.mask.size()) & cv::Rect(0, 0, mat.cols, mat.rows);
+	if (rect.empty()) {
+		return;
+	}
+	mat(rect).setTo(color, label.mask(rect - top_left));
+}
+
+void set_cache_capacity(size_t capacity) {
+	cache().set_capacity(capacity);
+}
+}
+
+extern "C" {
+void aux_img_set_text_cache_capacity(size_t capacity) noexcept {
+	aux_img::guard([&] { aux_img::text::set_cache_capacity(capacity); });
+}
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <opencv2/core.hpp>
+
+// cached text rendering with `cv::FONT_HERSHEY_SIMPLEX`
+//
+// `cv::putText` strokes every glyph as polylines on every call. Instead,
+// glyphs are rasterized once per (scale, thickness) into an atlas, strings
+// are composed from the atlas into a coverage mask, and the masks of recent
+// strings are kept in an LRU, so that a repeated label is a masked copy.
+//
+// glyphs are placed at whole pixels, so a composed string could differ from
+// `cv::putText` by a pixel in places
+namespace aux_img::text {
+// a rendered string; `mask` is 8 bit coverage, with its top left corner at
+// `offset` from the origin of the text
+struct Label {
+	cv::Mat mask;
+	cv::Point offset;
+};
+
+// the label of `text` with its baseline at (0, 0); safe to call concurrently
+std::shared_ptr<const Label> label(const char *text, double scale, int thickness);
+
+// paint `color` through the part of `label` at `org` that lies in `mat`
+//
+// `row_offset` is the row of `mat` in the full image, for drawing into a band
+void blit(cv::Mat &mat, const Label &label, cv::Point org, const cv::Scalar &color, int row_offset = 0);
+
+// the number of strings kept; 0 disables the string cache (glyphs are still
+// cached)
+void set_cache_capacity(size_t capacity);
+}
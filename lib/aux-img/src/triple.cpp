@@ -0,0 +1,158 @@
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <stdexcept>
+#include <vector>
+#include <aux.hpp>
+#include "status.hpp"
+#include "wire.hpp"
+
+namespace aux_img {
+namespace {
+	constexpr size_t SKELETON_FLOATS = 133 * 2;
+	constexpr size_t CACHE_LINE      = 64;
+}
+
+// three slots: one being written by the producer (`back`), one being read by
+// the consumer (`front`) and one in between, whose index is kept in `state`
+// together with whether it holds poses the consumer has not read yet
+//
+// publishing swaps `back` with the middle slot and reading swaps `front`
+// with it, each with one atomic exchange, so neither side ever waits or
+// sees a slot the other one is using
+struct PoseBuffer {
+	static constexpr uint8_t INDEX_MASK = 0b011;
+	static constexpr uint8_t FRESH      = 0b100;
+
+	struct alignas(CACHE_LINE) Slot {
+		uint32_t frame_index = 0;
+		uint32_t n_people    = 0;
+		uint32_t n_boxes     = 0;
+		std::vector<float> keypoints;
+		std::vector<uint16_t> boxes;
+	};
+
+	size_t max_people;
+	Slot slots[3];
+	// the middle slot, and `FRESH`
+	alignas(CACHE_LINE) std::atomic<uint8_t> state{2};
+	// producer side
+	alignas(CACHE_LINE) uint8_t back = 0;
+	std::atomic<uint64_t> published{0};
+	std::atomic<uint64_t> dropped{0};
+	// consumer side
+	alignas(CACHE_LINE) uint8_t front = 1;
+	std::atomic<uint64_t> read_fresh{0};
+
+	explicit PoseBuffer(size_t max_people) : max_people(max_people) {
+		for (auto &slot : slots) {
+			slot.keypoints.resize(max_people * SKELETON_FLOATS);
+			slot.boxes.resize(max_people * 4);
+		}
+	}
+
+	// the slot to write the next poses into; people past `max_people` are
+	// dropped
+	Slot &begin_write(uint32_t frame_index, size_t n_people, size_t n_boxes) {
+		auto &slot       = slots[back];
+		slot.frame_index = frame_index;
+		slot.n_people    = static_cast<uint32_t>(std::min(n_people, max_people));
+		slot.n_boxes     = static_cast<uint32_t>(std::min(n_boxes, max_people));
+		return slot;
+	}
+
+	void publish() {
+		const auto previous = state.exchange(back | FRESH, std::memory_order_acq_rel);
+		back                = previous & INDEX_MASK;
+		published.fetch_add(1, std::memory_order_relaxed);
+		if ((previous & FRESH) != 0) {
+			// replaced before the consumer got to it
+			dropped.fetch_add(1, std::memory_order_relaxed);
+		}
+	}
+
+	PoseFrame read() {
+		const bool is_fresh = (state.load(std::memory_order_acquire) & FRESH) != 0;
+		if (is_fresh) {
+			front = state.exchange(front, std::memory_order_acq_rel) & INDEX_MASK;
+			read_fresh.fetch_add(1, std::memory_order_relaxed);
+		}
+		const auto &slot = slots[front];
+		return {slot.frame_index, slot.n_people, slot.n_boxes, is_fresh, slot.keypoints.data(), slot.boxes.data()};
+	}
+};
+}
+
+extern "C" {
+aux_img::Status aux_img_pose_buffer_create(size_t max_people, aux_img::PoseBuffer **out) noexcept {
+	return aux_img::guard([&] {
+		if (out == nullptr) {
+			throw std::invalid_argument("out == nullptr");
+		}
+		if (max_people == 0) {
+			throw std::invalid_argument("max_people == 0");
+		}
+		*out = new aux_img::PoseBuffer(max_people);
+	});
+}
+
+void aux_img_pose_buffer_destroy(aux_img::PoseBuffer *buffer) noexcept {
+	delete buffer;
+}
+
+aux_img::Status aux_img_pose_buffer_write(aux_img::PoseBuffer *buffer,
+										  uint32_t frame_index,
+										  const float *keypoints,
+										  size_t n_people,
+										  const uint16_t *boxes,
+										  size_t n_boxes) noexcept {
+	return aux_img::guard([&] {
+		if (buffer == nullptr) {
+			throw std::invalid_argument("buffer == nullptr");
+		}
+		if ((n_people != 0 && keypoints == nullptr) || (n_boxes != 0 && boxes == nullptr)) {
+			throw std::invalid_argument("keypoints or boxes == nullptr");
+		}
+		auto &slot = buffer->begin_write(frame_index, n_people, n_boxes);
+		std::copy_n(keypoints, slot.n_people * aux_img::SKELETON_FLOATS, slot.keypoints.data());
+		std::copy_n(boxes, slot.n_boxes * 4, slot.boxes.data());
+		buffer->publish();
+	});
+}
+
+aux_img::Status aux_img_pose_buffer_write_view(aux_img::PoseBuffer *buffer, const aux_img::PoseView *view) noexcept {
+	return aux_img::guard([&] {
+		if (buffer == nullptr || view == nullptr) {
+			throw std::invalid_argument("buffer or view == nullptr");
+		}
+		if ((view->n_people != 0 && view->keypoints == nullptr) || (view->n_boxes != 0 && view->boxes == nullptr)) {
+			throw std::invalid_argument("view->keypoints or view->boxes == nullptr");
+		}
+		auto &slot = buffer->begin_write(view->frame_index, view->n_people, view->n_boxes);
+		// decoded straight into the slot, in either wire version
+		aux_img::wire::decode_keypoints(*view, slot.n_people, slot.keypoints.data());
+		aux_img::wire::decode_boxes(*view, slot.n_boxes, slot.boxes.data());
+		buffer->publish();
+	});
+}
+
+aux_img::Status aux_img_pose_buffer_read(aux_img::PoseBuffer *buffer, aux_img::PoseFrame *out) noexcept {
+	return aux_img::guard([&] {
+		if (buffer == nullptr || out == nullptr) {
+			throw std::invalid_argument("buffer or out == nullptr");
+		}
+		*out = buffer->read();
+	});
+}
+
+void aux_img_pose_buffer_stats(const aux_img::PoseBuffer *buffer, aux_img::PoseBufferStats *out) noexcept {
+	if (buffer == nullptr || out == nullptr) {
+		return;
+	}
+	*out = {buffer->published.load(std::memory_order_relaxed),
+			buffer->dropped.load(std::memory_order_relaxed),
+			buffer->read_fresh.load(std::memory_order_relaxed)};
+}
+}
@@ -0,0 +1,90 @@
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+#include <aux.hpp>
+#include "status.hpp"
+#include "target.hpp"
+#include "wire.hpp"
+
+namespace aux_img {
+namespace {
+	// the keypoints and boxes of `view` as arrays, decoded into storage owned
+	// by the calling thread (reused by the next call); row major, as on the
+	// wire, whatever the layout of the options
+	struct Staged {
+		const float *keypoints;
+		const uint16_t *boxes;
+	};
+
+	Staged stage(const PoseView &view) {
+		if ((view.n_people != 0 && view.keypoints == nullptr) || (view.n_boxes != 0 && view.boxes == nullptr)) {
+			throw std::invalid_argument("view.keypoints or view.boxes == nullptr");
+		}
+		thread_local std::vector<float> keypoints;
+		thread_local std::vector<uint16_t> boxes;
+		keypoints.resize(view.n_people * wire::NUM_KEYPOINTS * 2);
+		boxes.resize(view.n_boxes * 4);
+		wire::decode_keypoints(view, view.n_people, keypoints.data());
+		wire::decode_boxes(view, view.n_boxes, boxes.data());
+		return {keypoints.data(), boxes.data()};
+	}
+
+	const PoseView &checked(const PoseView *view) {
+		if (view == nullptr) {
+			throw std::invalid_argument("view == nullptr");
+		}
+		return *view;
+	}
+}
+}
+
+extern "C" {
+aux_img::Status aux_img_pose_view_parse(const uint8_t *data, size_t size, aux_img::PoseView *out) noexcept {
+	return aux_img::guard([&] {
+		if (out == nullptr) {
+			throw std::invalid_argument("out == nullptr");
+		}
+		*out = aux_img::wire::parse(data, size);
+	});
+}
+
+aux_img::Status aux_img_canvas_draw_pose_view(aux_img::Canvas *canvas,
+											  const aux_img::PoseView *view,
+											  aux_img::DrawPosesOptions options,
+											  aux_img::CullStats *stats) noexcept {
+	return aux_img::guard([&] {
+		// staged row major
+		options.skeleton.layout = aux_img::Layout::RowMajor;
+
+		auto &target         = aux_img::target_of(canvas);
+		const auto &v        = aux_img::checked(view);
+		const auto staged    = aux_img::stage(v);
+		const auto box_color = cv::Scalar(options.bounding_box_color.x, options.bounding_box_color.y, options.bounding_box_color.z);
+		aux_img::CullStats local_stats{};
+		aux_img::draw_poses(target, staged.keypoints, v.n_people, staged.boxes, v.n_boxes, options.skeleton, box_color, options.bounding_box_thickness, local_stats);
+		if (stats != nullptr) {
+			*stats = local_stats;
+		}
+	});
+}
+
+aux_img::Status aux_img_composite_pose_view(aux_img::SharedMat src,
+											aux_img::CompositeTarget dst,
+											const aux_img::PoseView *view,
+											aux_img::DrawPosesOptions options,
+											aux_img::CullStats *stats) noexcept {
+	return aux_img::guard([&] {
+		// staged row major
+		options.skeleton.layout = aux_img::Layout::RowMajor;
+
+		const auto &v     = aux_img::checked(view);
+		const auto staged = aux_img::stage(v);
+		aux_img::CullStats local_stats{};
+		aux_img::composite_poses(src, dst, staged.keypoints, v.n_people, staged.boxes, v.n_boxes, options, local_stats);
+		if (stats != nullptr) {
+			*stats = local_stats;
+		}
+	});
+}
+}
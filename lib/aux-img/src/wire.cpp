@@ -0,0 +1,276 @@
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <format>
+#include <limits>
+#include <stdexcept>
+#include <aux.hpp>
+#include "status.hpp"
+#include "wire.hpp"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace aux_img::wire {
+namespace {
+	constexpr size_t SKELETON_FLOATS = NUM_KEYPOINTS * 2;
+	constexpr size_t BOX_SIZE        = 4 * sizeof(uint16_t);
+
+	constexpr size_t V1_HEADER_SIZE   = 4 + 1 + 1;
+	constexpr size_t V1_SKELETON_SIZE = SKELETON_FLOATS * sizeof(float);
+
+	// "PV2" then 0xff; as a v1 frame index that is 0xff325650, i.e. 4.5
+	// years of frames at 30 fps
+	constexpr uint8_t V2_MAGIC[4]     = {'P', 'V', '2', 0xff};
+	constexpr size_t V2_HEADER_SIZE   = 4 + 4 + 2 + 2;
+	// origin x, y and step x, y
+	constexpr size_t V2_ANCHOR_SIZE   = 4 * sizeof(float);
+	constexpr size_t V2_SKELETON_SIZE = V2_ANCHOR_SIZE + SKELETON_FLOATS * sizeof(uint16_t);
+	constexpr uint16_t V2_MISSING     = 0xffff;
+	constexpr uint16_t V2_MAX_LEVEL   = V2_MISSING - 1;
+
+	PoseView parse_v1(const uint8_t *data, size_t size) {
+		PoseView view{};
+		view.version = 1;
+		std::memcpy(&view.frame_index, data, sizeof(view.frame_index));
+		view.n_people         = data[4];
+		view.n_boxes          = data[5];
+		const size_t expected = V1_HEADER_SIZE + view.n_people * V1_SKELETON_SIZE + view.n_boxes * BOX_SIZE;
+		if (size < expected) {
+			throw std::invalid_argument(std::format("pose message of {} bytes, expected {} for {} skeletons and {} boxes",
+													size, expected, view.n_people, view.n_boxes));
+		}
+		view.keypoints = data + V1_HEADER_SIZE;
+		view.boxes     = view.keypoints + view.n_people * V1_SKELETON_SIZE;
+		return view;
+	}
+
+	PoseView parse_v2(const uint8_t *data, size_t size) {
+		if (size < V2_HEADER_SIZE) {
+			throw std::invalid_argument(std::format("v2 pose message of {} bytes, expected at least {}", size, V2_HEADER_SIZE));
+		}
+		PoseView view{};
+		view.version = 2;
+		uint16_t n_people = 0, n_boxes = 0;
+		std::memcpy(&view.frame_index, data + 4, sizeof(view.frame_index));
+		std::memcpy(&n_people, data + 8, sizeof(n_people));
+		std::memcpy(&n_boxes, data + 10, sizeof(n_boxes));
+		view.n_people = n_people;
+		view.n_boxes  = n_boxes;
+		if (size < encoded_size(n_people, n_boxes)) {
+			throw std::invalid_argument(std::format("v2 pose message of {} bytes, expected {} for {} skeletons and {} boxes",
+													size, encoded_size(n_people, n_boxes), n_people, n_boxes));
+		}
+		view.keypoints   = data + V2_HEADER_SIZE;
+		view.confidences = view.keypoints + n_people * V2_SKELETON_SIZE;
+		view.boxes       = view.confidences + n_people * NUM_KEYPOINTS;
+		return view;
+	}
+
+	// one v2 skeleton: origin + level * step for x and y, as they alternate;
+	// the missing level becomes all ones, i.e. NaN
+	void decode_skeleton(const uint8_t *in, float *out) {
+		float anchor[4];
+		std::memcpy(anchor, in, sizeof(anchor));
+		const uint8_t *levels = in + V2_ANCHOR_SIZE;
+		size_t k              = 0;
+#if defined(__AVX2__)
+		const auto origin  = _mm256_setr_ps(anchor[0], anchor[1], anchor[0], anchor[1], anchor[0], anchor[1], anchor[0], anchor[1]);
+		const auto step    = _mm256_setr_ps(anchor[2], anchor[3], anchor[2], anchor[3], anchor[2], anchor[3], anchor[2], anchor[3]);
+		const auto missing = _mm256_set1_epi32(V2_MISSING);
+		for (; k + 8 <= SKELETON_FLOATS; k += 8) {
+			const auto q       = _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(levels + k * 2)));
+			const auto v       = _mm256_add_ps(origin, _mm256_mul_ps(_mm256_cvtepi32_ps(q), step));
+			const auto is_none = _mm256_castsi256_ps(_mm256_cmpeq_epi32(q, missing));
+			_mm256_storeu_ps(out + k, _mm256_or_ps(v, is_none));
+		}
+#elif defined(__SSE2__)
+		const auto origin  = _mm_setr_ps(anchor[0], anchor[1], anchor[0], anchor[1]);
+		const auto step    = _mm_setr_ps(anchor[2], anchor[3], anchor[2], anchor[3]);
+		const auto missing = _mm_set1_epi16(static_cast<short>(V2_MISSING));
+		const auto zero    = _mm_setzero_si128();
+		for (; k + 8 <= SKELETON_FLOATS; k += 8) {
+			const auto q       = _mm_loadu_si128(reinterpret_cast<const __m128i *>(levels + k * 2));
+			const auto is_none = _mm_cmpeq_epi16(q, missing);
+			const auto lo      = _mm_add_ps(origin, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(q, zero)), step));
+			const auto hi      = _mm_add_ps(origin, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(q, zero)), step));
+			_mm_storeu_ps(out + k, _mm_or_ps(lo, _mm_castsi128_ps(_mm_unpacklo_epi16(is_none, is_none))));
+			_mm_storeu_ps(out + k + 4, _mm_or_ps(hi, _mm_castsi128_ps(_mm_unpackhi_epi16(is_none, is_none))));
+		}
+#endif
+		for (; k < SKELETON_FLOATS; k++) {
+			uint16_t q = 0;
+			std::memcpy(&q, levels + k * 2, sizeof(q));
+			out[k] = q == V2_MISSING ? std::numeric_limits<float>::quiet_NaN() : anchor[k % 2] + static_cast<float>(q) * anchor[2 + k % 2];
+		}
+	}
+
+	// the range of the finite values of one axis, as origin and step
+	void fit_axis(const float *keypoints, size_t axis, float &origin, float &step) {
+		float lo = std::numeric_limits<float>::infinity();
+		float hi = -lo;
+		for (size_t k = axis; k < SKELETON_FLOATS; k += 2) {
+			if (std::isfinite(keypoints[k])) {
+				lo = std::min(lo, keypoints[k]);
+				hi = std::max(hi, keypoints[k]);
+			}
+		}
+		if (lo > hi) {
+			origin = 0;
+			step   = 0;
+			return;
+		}
+		origin = lo;
+		step   = (hi - lo) / V2_MAX_LEVEL;
+	}
+
+	uint16_t quantize(float v, float origin, float step) {
+		if (!std::isfinite(v)) {
+			return V2_MISSING;
+		}
+		if (step == 0) {
+			return 0;
+		}
+		return static_cast<uint16_t>(std::clamp(std::lround((v - origin) / step), 0L, long{V2_MAX_LEVEL}));
+	}
+}
+
+PoseView parse(const uint8_t *data, size_t size) {
+	if (data == nullptr || size < V1_HEADER_SIZE) {
+		throw std::invalid_argument(std::format("pose message of {} bytes, expected at least {}", size, V1_HEADER_SIZE));
+	}
+	if (std::memcmp(data, V2_MAGIC, sizeof(V2_MAGIC)) == 0) {
+		return parse_v2(data, size);
+	}
+	return parse_v1(data, size);
+}
+
+void decode_keypoints(const PoseView &view, size_t n_people, float *out) {
+	n_people = std::min<size_t>(n_people, view.n_people);
+	if (n_people == 0) {
+		return;
+	}
+	if (view.version != 2) {
+		// unaligned, hence bytes
+		std::memcpy(out, view.keypoints, n_people * V1_SKELETON_SIZE);
+		return;
+	}
+	for (size_t p = 0; p < n_people; p++) {
+		decode_skeleton(view.keypoints + p * V2_SKELETON_SIZE, out + p * SKELETON_FLOATS);
+	}
+}
+
+void decode_confidences(const PoseView &view, size_t n_people, float *out) {
+	n_people = std::min<size_t>(n_people, view.n_people);
+	if (view.version != 2) {
+		std::fill_n(out, n_people * NUM_KEYPOINTS, 1.0f);
+		return;
+	}
+	for (size_t i = 0; i < n_people * NUM_KEYPOINTS; i++) {
+		out[i] = view.confidences[i] * (1.0f / 255);
+	}
+}
+
+void decode_boxes(const PoseView &view, size_t n_boxes, uint16_t *out) {
+	n_boxes = std::min<size_t>(n_boxes, view.n_boxes);
+	if (n_boxes != 0) {
+		std::memcpy(out, view.boxes, n_boxes * BOX_SIZE);
+	}
+}
+
+size_t encoded_size(size_t n_people, size_t n_boxes) {
+	return V2_HEADER_SIZE + n_people * (V2_SKELETON_SIZE + NUM_KEYPOINTS) + n_boxes * BOX_SIZE;
+}
+
+size_t encode(uint32_t frame_index,
+			  const float *keypoints,
+			  const float *confidences,
+			  size_t n_people,
+			  const uint16_t *boxes,
+			  size_t n_boxes,
+			  uint8_t *out,
+			  size_t capacity) {
+	if (n_people > UINT16_MAX || n_boxes > UINT16_MAX) {
+		throw std::invalid_argument(std::format("{} skeletons and {} boxes, at most 65535 each", n_people, n_boxes));
+	}
+	const size_t size = encoded_size(n_people, n_boxes);
+	if (out == nullptr || capacity < size) {
+		throw std::invalid_argument(std::format("{} bytes for a pose message of {}", capacity, size));
+	}
+	const auto n_people16 = static_cast<uint16_t>(n_people);
+	const auto n_boxes16  = static_cast<uint16_t>(n_boxes);
+	std::memcpy(out, V2_MAGIC, sizeof(V2_MAGIC));
+	std::memcpy(out + 4, &frame_index, sizeof(frame_index));
+	std::memcpy(out + 8, &n_people16, sizeof(n_people16));
+	std::memcpy(out + 10, &n_boxes16, sizeof(n_boxes16));
+	uint8_t *skeletons = out + V2_HEADER_SIZE;
+	uint8_t *scores    = skeletons + n_people * V2_SKELETON_SIZE;
+	for (size_t p = 0; p < n_people; p++) {
+		const float *in = keypoints + p * SKELETON_FLOATS;
+		float anchor[4];
+		fit_axis(in, 0, anchor[0], anchor[2]);
+		fit_axis(in, 1, anchor[1], anchor[3]);
+		uint8_t *dst = skeletons + p * V2_SKELETON_SIZE;
+		std::memcpy(dst, anchor, sizeof(anchor));
+		for (size_t k = 0; k < SKELETON_FLOATS; k++) {
+			const uint16_t q = quantize(in[k], anchor[k % 2], anchor[2 + k % 2]);
+			std::memcpy(dst + V2_ANCHOR_SIZE + k * 2, &q, sizeof(q));
+		}
+	}
+	for (size_t i = 0; i < n_people * NUM_KEYPOINTS; i++) {
+		const float c = confidences == nullptr ? 1.0f : confidences[i];
+		scores[i]     = static_cast<uint8_t>(std::lround(std::clamp(std::isfinite(c) ? c : 0.0f, 0.0f, 1.0f) * 255));
+	}
+	if (n_boxes != 0) {
+		std::memcpy(scores + n_people * NUM_KEYPOINTS, boxes, n_boxes * BOX_SIZE);
+	}
+	return size;
+}
+}
+
+extern "C" {
+aux_img::Status aux_img_pose_view_decode(const aux_img::PoseView *view, float *keypoints, uint16_t *boxes, float *confidences) noexcept {
+	return aux_img::guard([&] {
+		if (view == nullptr) {
+			throw std::invalid_argument("view == nullptr");
+		}
+		if ((view->n_people != 0 && keypoints == nullptr) || (view->n_boxes != 0 && boxes == nullptr)) {
+			throw std::invalid_argument("keypoints or boxes == nullptr");
+		}
+		aux_img::wire::decode_keypoints(*view, view->n_people, keypoints);
+		aux_img::wire::decode_boxes(*view, view->n_boxes, boxes);
+		if (confidences != nullptr) {
+			aux_img::wire::decode_confidences(*view, view->n_people, confidences);
+		}
+	});
+}
+
+size_t aux_img_pose_encoded_size(size_t n_people, size_t n_boxes) noexcept {
+	return aux_img::wire::encoded_size(n_people, n_boxes);
+}
+
+aux_img::Status aux_img_pose_encode(uint32_t frame_index,
+									const float *keypoints,
+									const float *confidences,
+									size_t n_people,
+									const uint16_t *boxes,
+									size_t n_boxes,
+									uint8_t *out,
+									size_t capacity,
+									size_t *size) noexcept {
+	return aux_img::guard([&] {
+		if ((n_people != 0 && keypoints == nullptr) || (n_boxes != 0 && boxes == nullptr)) {
+			throw std::invalid_argument("keypoints or boxes == nullptr");
+		}
+		const auto n = aux_img::wire::encode(frame_index, keypoints, confidences, n_people, boxes, n_boxes, out, capacity);
+		if (size != nullptr) {
+			*size = n;
+		}
+	});
+}
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <aux.hpp>
+
+// the pose message, in either version; see `PoseView` for the layouts
+//
+// everything downstream of a view (staging, the history, the triple buffer)
+// decodes through here, straight into the row major floats the draw kernels
+// consume, so no consumer cares which version was received
+namespace aux_img::wire {
+constexpr size_t NUM_KEYPOINTS = 133;
+
+// throws `std::invalid_argument` for a short or malformed message
+PoseView parse(const uint8_t *data, size_t size);
+
+// the first `n_people` skeletons, 133 * 2 floats each; a missing keypoint of
+// a v2 message is NaN, as it was before encoding
+void decode_keypoints(const PoseView &view, size_t n_people, float *out);
+
+// the first `n_people` sets of 133 confidences in [0, 1]; 1 for v1, which
+// carries none
+void decode_confidences(const PoseView &view, size_t n_people, float *out);
+
+void decode_boxes(const PoseView &view, size_t n_boxes, uint16_t *out);
+
+size_t encoded_size(size_t n_people, size_t n_boxes);
+
+// `confidences` may be null, i.e. all 1; returns the size written, throws if
+// `capacity` is short of `encoded_size`
+size_t encode(uint32_t frame_index,
+			  const float *keypoints,
+			  const float *confidences,
+			  size_t n_people,
+			  const uint16_t *boxes,
+			  size_t n_boxes,
+			  uint8_t *out,
+			  size_t capacity);
+}
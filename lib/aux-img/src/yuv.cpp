@@ -0,0 +1,196 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <format>
+#include <stdexcept>
+#include <opencv2/core.hpp>
+#include <aux.hpp>
+#include "yuv.hpp"
+
+namespace aux_img::yuv {
+namespace {
+uint8_t to_u8(double v) {
+	return static_cast<uint8_t>(std::clamp(std::lround(v), 0L, 255L));
+}
+
+// mix the chroma of `n` pixels into one sample: the overlay where drawn, and
+// the existing sample elsewhere
+struct ChromaSum {
+	int u       = 0;
+	int v       = 0;
+	int n_drawn = 0;
+
+	void add(uint8_t label, const std::array<std::array<uint8_t, 3>, 256> &colors, uint8_t u0, uint8_t v0) {
+		if (label == 0) {
+			u += u0;
+			v += v0;
+		} else {
+			u += colors[label][1];
+			v += colors[label][2];
+			n_drawn++;
+		}
+	}
+
+	// write the mean of `n` pixels back, if any of them was drawn
+	void store(int n, uint8_t &u0, uint8_t &v0) const {
+		if (n_drawn == 0) {
+			return;
+		}
+		u0 = static_cast<uint8_t>((u + n / 2) / n);
+		v0 = static_cast<uint8_t>((v + n / 2) / n);
+	}
+};
+}
+
+bool is_yuv(PixelFormat pixel_format) {
+	switch (pixel_format) {
+	case PixelFormat::YUV:
+	case PixelFormat::YUYV:
+	case PixelFormat::NV12:
+	case PixelFormat::I420:
+		return true;
+	default:
+		return false;
+	}
+}
+
+std::array<uint8_t, 3> from_bgr(const cv::Scalar &bgr) {
+	const double b = bgr[0];
+	const double g = bgr[1];
+	const double r = bgr[2];
+	return {to_u8(16 + 0.257 * r + 0.504 * g + 0.098 * b),
+			to_u8(128 - 0.148 * r - 0.291 * g + 0.439 * b),
+			to_u8(128 + 0.439 * r - 0.368 * g - 0.071 * b)};
+}
+
+void validate(const SharedMat &mat) {
+	if (!is_yuv(mat.pixel_format) || mat.depth != Depth::U8) {
+		throw std::invalid_argument(std::format("Unsupported YUV pixel format {} and depth {}",
+												pixel_format_to_string(mat.pixel_format),
+												depth_to_string(mat.depth)));
+	}
+	const bool is_odd_cols = mat.cols % 2 != 0;
+	const bool is_odd_rows = mat.rows % 2 != 0;
+	if ((mat.pixel_format == PixelFormat::YUYV && is_odd_cols) ||
+		((mat.pixel_format == PixelFormat::NV12 || mat.pixel_format == PixelFormat::I420) && (is_odd_cols || is_odd_rows))) {
+		throw std::invalid_argument(std::format("{} requires even dimensions, got {}x{}",
+												pixel_format_to_string(mat.pixel_format), mat.cols, mat.rows));
+	}
+}
+
+Overlay::Overlay(SharedMat mat) : mat(mat) {
+	validate(mat);
+	// kept zeroed between calls, so that only the dirty part is touched
+	thread_local cv::Mat labels;
+	if (labels.rows != mat.rows || labels.cols != mat.cols) {
+		labels = cv::Mat::zeros(mat.rows, mat.cols, CV_8UC1);
+	}
+	label_mat = &labels;
+	colors[0] = {0, 0, 0};
+}
+
+cv::Scalar Overlay::label_of(const cv::Scalar &color) {
+	for (int i = 1; i < n_colors; i++) {
+		if (bgr[i] == color) {
+			return cv::Scalar(i);
+		}
+	}
+	if (n_colors == 256) {
+		throw std::invalid_argument("more than 255 colors in one call");
+	}
+	bgr[n_colors]    = color;
+	colors[n_colors] = from_bgr(color);
+	return cv::Scalar(n_colors++);
+}
+
+void Overlay::resolve(cv::Rect dirty) {
+	auto &labels = *label_mat;
+	dirty &= cv::Rect(0, 0, mat.cols, mat.rows);
+	if (dirty.empty()) {
+		return;
+	}
+	// whole chroma samples
+	const int x0 = dirty.x & ~1;
+	const int y0 = dirty.y & ~1;
+	const int x1 = std::min((dirty.x + dirty.width + 1) & ~1, static_cast<int>(mat.cols));
+	const int y1 = std::min((dirty.y + dirty.height + 1) & ~1, static_cast<int>(mat.rows));
+	const size_t cols = mat.cols;
+	const size_t rows = mat.rows;
+
+	switch (mat.pixel_format) {
+	case PixelFormat::YUV:
+		for (int y = dirty.y; y < dirty.y + dirty.height; y++) {
+			const auto *l = labels.ptr<uint8_t>(y);
+			auto *row     = mat.data + y * cols * 3;
+			for (int x = dirty.x; x < dirty.x + dirty.width; x++) {
+				if (l[x] != 0) {
+					std::copy_n(colors[l[x]].data(), 3, row + x * 3);
+				}
+			}
+		}
+		break;
+	case PixelFormat::YUYV:
+		for (int y = dirty.y; y < dirty.y + dirty.height; y++) {
+			const auto *l = labels.ptr<uint8_t>(y);
+			auto *row     = mat.data + y * cols * 2;
+			for (int x = x0; x < x1; x += 2) {
+				if ((l[x] | l[x + 1]) == 0) {
+					continue;
+				}
+				// Y0 U Y1 V
+				auto *px = row + x * 2;
+				ChromaSum sum;
+				sum.add(l[x], colors, px[1], px[3]);
+				sum.add(l[x + 1], colors, px[1], px[3]);
+				sum.store(2, px[1], px[3]);
+				if (l[x] != 0) {
+					px[0] = colors[l[x]][0];
+				}
+				if (l[x + 1] != 0) {
+					px[2] = colors[l[x + 1]][0];
+				}
+			}
+		}
+		break;
+	case PixelFormat::NV12:
+	case PixelFormat::I420: {
+		auto *chroma  = mat.data + rows * cols;
+		const bool is_nv12 = mat.pixel_format == PixelFormat::NV12;
+		for (int y = y0; y < y1; y += 2) {
+			const auto *l0 = labels.ptr<uint8_t>(y);
+			const auto *l1 = labels.ptr<uint8_t>(y + 1);
+			auto *luma0    = mat.data + y * cols;
+			auto *luma1    = luma0 + cols;
+			const auto cy  = static_cast<size_t>(y / 2);
+			for (int x = x0; x < x1; x += 2) {
+				if ((l0[x] | l0[x + 1] | l1[x] | l1[x + 1]) == 0) {
+					continue;
+				}
+				const auto cx = static_cast<size_t>(x / 2);
+				// NV12 interleaves U and V; I420 has a U plane then a V plane
+				uint8_t &u = is_nv12 ? chroma[cy * cols + cx * 2] : chroma[cy * (cols / 2) + cx];
+				uint8_t &v = is_nv12 ? chroma[cy * cols + cx * 2 + 1] : chroma[(rows / 2) * (cols / 2) + cy * (cols / 2) + cx];
+				ChromaSum sum;
+				for (const auto *l : {l0, l1}) {
+					sum.add(l[x], colors, u, v);
+					sum.add(l[x + 1], colors, u, v);
+				}
+				sum.store(4, u, v);
+				for (int dx = 0; dx < 2; dx++) {
+					if (l0[x + dx] != 0) {
+						luma0[x + dx] = colors[l0[x + dx]][0];
+					}
+					if (l1[x + dx] != 0) {
+						luma1[x + dx] = colors[l1[x + dx]][0];
+					}
+				}
+			}
+		}
+		break;
+	}
+	default:
+		break;
+	}
+	labels(cv::Rect(x0, y0, x1 - x0, y1 - y0)).setTo(cv::Scalar(0));
+}
+}
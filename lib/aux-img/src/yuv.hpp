@@ -0,0 +1,59 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <opencv2/core.hpp>
+#include <aux.hpp>
+
+// drawing into YUV frames without converting them
+//
+// primitives are rasterized with OpenCV into an 8 bit label image of the
+// frame size, where every label is a color converted to YUV once per call.
+// The labels are then resolved into the frame: luma is written per pixel,
+// and each subsampled chroma sample becomes the mean of the chroma of the
+// pixels it covers, i.e. of the overlay where drawn and of the existing
+// chroma elsewhere.
+//
+// layouts, all `Depth::U8` and row-contiguous:
+// - `YUV`: packed 4:4:4, Y U V per pixel
+// - `YUYV`: packed 4:2:2, Y0 U Y1 V per pair of pixels; even `cols`
+// - `NV12`: 4:2:0, Y plane then an interleaved UV plane; even `rows`/`cols`
+// - `I420`: 4:2:0, Y plane then U plane then V plane; even `rows`/`cols`
+namespace aux_img::yuv {
+bool is_yuv(PixelFormat pixel_format);
+
+// BT.601 limited range, from a `cv::Scalar` in BGR order
+std::array<uint8_t, 3> from_bgr(const cv::Scalar &bgr);
+
+// throws `std::invalid_argument` if `mat` is not a supported YUV frame
+void validate(const SharedMat &mat);
+
+class Overlay {
+public:
+	// see `validate`
+	explicit Overlay(SharedMat mat);
+	Overlay(const Overlay &)            = delete;
+	Overlay &operator=(const Overlay &) = delete;
+
+	// zero (transparent) outside of what has been drawn since the last
+	// `resolve`; owned by the calling thread
+	cv::Mat &labels() { return *label_mat; }
+
+	// the label to draw `bgr` with, as a scalar for OpenCV; throws if more
+	// than 255 distinct colors are used in one call
+	cv::Scalar label_of(const cv::Scalar &bgr);
+
+	// write the labels within `dirty` into the frame, and clear them
+	//
+	// everything drawn must be within `dirty`
+	void resolve(cv::Rect dirty);
+
+private:
+	SharedMat mat;
+	cv::Mat *label_mat;
+	// indexed by label; 0 is transparent
+	std::array<std::array<uint8_t, 3>, 256> colors;
+	std::array<cv::Scalar, 256> bgr;
+	int n_colors = 1;
+};
+}
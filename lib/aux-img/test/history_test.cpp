@@ -0,0 +1,183 @@
+// the pose history in both layouts, fed from the same v1 and v2 messages
+//
+// every message is pushed into a `RowMajor` and a `ColMajor` history: the
+// samples must be exact transposes of each other (NaN where the other has
+// NaN), v1 samples equal to the keypoints sent, and both samples drawn with
+// their layout give the same frame. The view itself is composited with
+// either layout option too, which a view ignores. Every case is reported;
+// exits with 1 if any failed.
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <print>
+#include <vector>
+#include <aux.hpp>
+
+namespace {
+constexpr size_t NUM_KEYPOINTS = 133;
+constexpr size_t STRIDE        = NUM_KEYPOINTS * 2;
+constexpr size_t N_PEOPLE      = 3;
+constexpr uint16_t COLS        = 320;
+constexpr uint16_t ROWS        = 240;
+constexpr uint32_t FRAME_INDEX = 42;
+
+// row major people spread over the frame, one keypoint missing each
+std::vector<float> make_keypoints() {
+	std::vector<float> keypoints(N_PEOPLE * STRIDE);
+	for (size_t p = 0; p < N_PEOPLE; p++) {
+		for (size_t k = 0; k < NUM_KEYPOINTS; k++) {
+			keypoints[p * STRIDE + k * 2]     = 20.25f + static_cast<float>((k * 37 + p * 91) % 280);
+			keypoints[p * STRIDE + k * 2 + 1] = 10.5f + static_cast<float>((k * 53 + p * 17) % 220);
+		}
+		keypoints[p * STRIDE + (p * 11 % NUM_KEYPOINTS) * 2]     = NAN;
+		keypoints[p * STRIDE + (p * 11 % NUM_KEYPOINTS) * 2 + 1] = NAN;
+	}
+	return keypoints;
+}
+
+const std::vector<uint16_t> BOXES = {10, 20, 110, 200, 150, 30, 300, 230};
+
+std::vector<uint8_t> encode_v1(const std::vector<float> &keypoints) {
+	const size_t n_boxes = BOXES.size() / 4;
+	std::vector<uint8_t> message(4 + 1 + 1 + keypoints.size() * sizeof(float) + BOXES.size() * sizeof(uint16_t));
+	uint8_t *out = message.data();
+	std::memcpy(out, &FRAME_INDEX, 4);
+	out[4] = static_cast<uint8_t>(N_PEOPLE);
+	out[5] = static_cast<uint8_t>(n_boxes);
+	std::memcpy(out + 6, keypoints.data(), keypoints.size() * sizeof(float));
+	std::memcpy(out + 6 + keypoints.size() * sizeof(float), BOXES.data(), BOXES.size() * sizeof(uint16_t));
+	return message;
+}
+
+std::vector<uint8_t> encode_v2(const std::vector<float> &keypoints) {
+	const size_t n_boxes = BOXES.size() / 4;
+	std::vector<uint8_t> message(aux_img_pose_encoded_size(N_PEOPLE, n_boxes));
+	size_t size = 0;
+	if (aux_img_pose_encode(FRAME_INDEX, keypoints.data(), nullptr, N_PEOPLE, BOXES.data(), n_boxes, message.data(), message.size(), &size) != aux_img::Status::Ok) {
+		std::println("FAIL encode: {}", aux_img_last_error());
+		return {};
+	}
+	message.resize(size);
+	return message;
+}
+
+bool is_same(float a, float b) {
+	return a == b || (std::isnan(a) && std::isnan(b));
+}
+
+struct Sample {
+	aux_img::PoseSample info{};
+	std::vector<float> keypoints = std::vector<float>(N_PEOPLE * STRIDE);
+	std::vector<uint16_t> boxes  = std::vector<uint16_t>(N_PEOPLE * 4);
+};
+
+// the view pushed into a new history of `layout`, sampled at its frame
+bool sample_view(const aux_img::PoseView &view, aux_img::Layout layout, Sample &out) {
+	aux_img::PoseHistory *history = nullptr;
+	if (aux_img_history_create(4, N_PEOPLE, layout, &history) != aux_img::Status::Ok) {
+		std::println("FAIL history_create: {}", aux_img_last_error());
+		return false;
+	}
+	const bool ok = aux_img_history_push_view(history, &view) == aux_img::Status::Ok &&
+					aux_img_history_sample(history, FRAME_INDEX, 0, out.keypoints.data(), out.boxes.data(), &out.info) == aux_img::Status::Ok;
+	if (!ok) {
+		std::println("FAIL history: {}", aux_img_last_error());
+	}
+	aux_img_history_destroy(history);
+	return ok;
+}
+
+aux_img::DrawPosesOptions draw_options(aux_img::Layout layout) {
+	return {{layout, true, true, 3, -1, 2, 0, 0, true}, {0, 250, 0}, 2};
+}
+
+std::vector<uint8_t> draw(const Sample &sample, aux_img::Layout layout) {
+	std::vector<uint8_t> buffer(static_cast<size_t>(COLS) * ROWS * 3, 0);
+	const aux_img::SharedMat mat{buffer.data(), ROWS, COLS, aux_img::Depth::U8, aux_img::PixelFormat::BGR};
+	aux_img_draw_poses_batch_impl(mat, sample.keypoints.data(), sample.info.n_people, sample.boxes.data(), sample.info.n_boxes, draw_options(layout), nullptr);
+	return buffer;
+}
+
+std::vector<uint8_t> composite(const aux_img::PoseView &view, aux_img::Layout layout) {
+	std::vector<uint8_t> frame(static_cast<size_t>(COLS) * ROWS * 3, 0);
+	const aux_img::SharedMat src{frame.data(), ROWS, COLS, aux_img::Depth::U8, aux_img::PixelFormat::BGR};
+	const size_t step = aux_img_composite_step(COLS, aux_img::OutputFormat::BGR, true);
+	std::vector<uint8_t> out(step * ROWS, 0);
+	if (aux_img_composite_pose_view(src, {out.data(), step, aux_img::OutputFormat::BGR}, &view, draw_options(layout), nullptr) != aux_img::Status::Ok) {
+		std::println("FAIL composite_pose_view: {}", aux_img_last_error());
+		return {};
+	}
+	return out;
+}
+
+// 0 if the case passed
+int check(const char *name, const std::vector<uint8_t> &message, const std::vector<float> &sent) {
+	aux_img::PoseView view{};
+	if (message.empty() || aux_img_pose_view_parse(message.data(), message.size(), &view) != aux_img::Status::Ok) {
+		std::println("FAIL {}: parse: {}", name, aux_img_last_error());
+		return 1;
+	}
+	Sample row, col;
+	if (!sample_view(view, aux_img::Layout::RowMajor, row) || !sample_view(view, aux_img::Layout::ColMajor, col)) {
+		return 1;
+	}
+	int n_failed = 0;
+	if (row.info.n_people != N_PEOPLE || col.info.n_people != N_PEOPLE || row.info.n_boxes != BOXES.size() / 4 || col.info.n_boxes != BOXES.size() / 4) {
+		std::println("FAIL {}: {}/{} people and {}/{} boxes", name, row.info.n_people, col.info.n_people, row.info.n_boxes, col.info.n_boxes);
+		return 1;
+	}
+	size_t n_transposed = 0;
+	size_t n_sent       = 0;
+	for (size_t p = 0; p < N_PEOPLE; p++) {
+		const float *r = row.keypoints.data() + p * STRIDE;
+		const float *c = col.keypoints.data() + p * STRIDE;
+		for (size_t k = 0; k < NUM_KEYPOINTS; k++) {
+			n_transposed += !is_same(r[k * 2], c[k]) || !is_same(r[k * 2 + 1], c[NUM_KEYPOINTS + k]);
+			n_sent += !is_same(r[k * 2], sent[p * STRIDE + k * 2]) || !is_same(r[k * 2 + 1], sent[p * STRIDE + k * 2 + 1]);
+		}
+	}
+	if (n_transposed != 0) {
+		std::println("FAIL {}: {} keypoints of the column major sample are not the transpose of the row major one", name, n_transposed);
+		n_failed++;
+	}
+	// v2 is quantized; its accuracy is for wire_test
+	if (view.version == 1 && n_sent != 0) {
+		std::println("FAIL {}: {} keypoints differ from the ones sent", name, n_sent);
+		n_failed++;
+	}
+	if (row.boxes != col.boxes || !std::equal(BOXES.begin(), BOXES.end(), row.boxes.begin())) {
+		std::println("FAIL {}: boxes differ", name);
+		n_failed++;
+	}
+	const auto drawn = draw(row, aux_img::Layout::RowMajor);
+	if (drawn != draw(col, aux_img::Layout::ColMajor)) {
+		std::println("FAIL {}: the samples drawn with their layout differ", name);
+		n_failed++;
+	}
+	if (std::all_of(drawn.begin(), drawn.end(), [](uint8_t v) { return v == 0; })) {
+		std::println("FAIL {}: nothing drawn", name);
+		n_failed++;
+	}
+	const auto composited = composite(view, aux_img::Layout::RowMajor);
+	if (composited.empty() || composited != composite(view, aux_img::Layout::ColMajor)) {
+		std::println("FAIL {}: the view composited with either layout differs", name);
+		n_failed++;
+	}
+	return n_failed;
+}
+}
+
+int main() {
+	const auto keypoints = make_keypoints();
+	int n_failed         = 0;
+	n_failed += check("v1", encode_v1(keypoints), keypoints);
+	n_failed += check("v2", encode_v2(keypoints), keypoints);
+	if (n_failed != 0) {
+		return EXIT_FAILURE;
+	}
+	std::println("history_test: ok");
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,97 @@
+// the pose triple buffer under contention, briefly; `auximg_bench --stress`
+// measures the same handoff for longer
+//
+// a producer publishes `N_WRITES` poses as fast as it can, every value of a
+// publish (keypoints, boxes, the number of people) derived from its frame
+// index, while a consumer reads in a loop. A read must never mix two
+// publishes, fresh frame indices never go back, and once both are done every
+// publish is either dropped or read: `published == dropped + read_fresh`.
+// Exits with 1 if any of it does not hold.
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <print>
+#include <thread>
+#include <vector>
+#include <aux.hpp>
+
+namespace {
+constexpr size_t NUM_KEYPOINTS = 133;
+constexpr size_t MAX_PEOPLE    = 4;
+constexpr uint32_t N_WRITES    = 200'000;
+
+// people of publish `f`, so that a count from another publish shows too
+uint32_t people_of(uint32_t f) {
+	return 1 + f % MAX_PEOPLE;
+}
+
+float value_of(uint32_t f) {
+	return static_cast<float>(f & 0xffffff);
+}
+
+bool is_consistent(const aux_img::PoseFrame &frame) {
+	const auto f = frame.frame_index;
+	if (frame.n_people != people_of(f) || frame.n_boxes != people_of(f)) {
+		return false;
+	}
+	const size_t n_floats = frame.n_people * NUM_KEYPOINTS * 2;
+	return std::all_of(frame.keypoints, frame.keypoints + n_floats, [&](float v) { return v == value_of(f); }) &&
+		   std::all_of(frame.boxes, frame.boxes + frame.n_boxes * 4, [&](uint16_t v) { return v == static_cast<uint16_t>(f); });
+}
+}
+
+int main() {
+	aux_img::PoseBuffer *buffer = nullptr;
+	if (aux_img_pose_buffer_create(MAX_PEOPLE, &buffer) != aux_img::Status::Ok) {
+		std::println("FAIL create: {}", aux_img_last_error());
+		return EXIT_FAILURE;
+	}
+	std::atomic<bool> is_done{false};
+	std::thread producer([&] {
+		std::vector<float> keypoints(MAX_PEOPLE * NUM_KEYPOINTS * 2);
+		std::vector<uint16_t> boxes(MAX_PEOPLE * 4);
+		for (uint32_t f = 1; f <= N_WRITES; f++) {
+			std::fill(keypoints.begin(), keypoints.end(), value_of(f));
+			std::fill(boxes.begin(), boxes.end(), static_cast<uint16_t>(f));
+			aux_img_pose_buffer_write(buffer, f, keypoints.data(), people_of(f), boxes.data(), people_of(f));
+		}
+		is_done = true;
+	});
+
+	size_t n_fresh      = 0;
+	size_t n_torn       = 0;
+	size_t n_backwards  = 0;
+	uint32_t last_index = 0;
+	auto read_once      = [&] {
+		aux_img::PoseFrame frame{};
+		aux_img_pose_buffer_read(buffer, &frame);
+		if (!frame.is_fresh) {
+			return;
+		}
+		n_fresh++;
+		n_torn += !is_consistent(frame);
+		n_backwards += frame.frame_index <= last_index;
+		last_index = frame.frame_index;
+	};
+	while (!is_done.load(std::memory_order_acquire)) {
+		read_once();
+	}
+	producer.join();
+	// the last publish, if still pending
+	read_once();
+
+	aux_img::PoseBufferStats stats{};
+	aux_img_pose_buffer_stats(buffer, &stats);
+	aux_img_pose_buffer_destroy(buffer);
+	std::println("pose_buffer_test: {} published, {} dropped, {} read ({} fresh reads seen), {} torn, {} out of order",
+				 stats.published, stats.dropped, stats.read_fresh, n_fresh, n_torn, n_backwards);
+	const bool ok = n_torn == 0 && n_backwards == 0 && stats.published == N_WRITES && stats.read_fresh == n_fresh &&
+					stats.published == stats.dropped + stats.read_fresh && last_index == N_WRITES;
+	if (!ok) {
+		std::println("FAIL");
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,165 @@
+// the span rasterizer against OpenCV (`aux_img_set_fast_raster(false)`), and
+// the banded drawing of the pool against a single thread
+//
+// the same poses are drawn both ways into BGR U8 frames: landmarks must be
+// pixel identical, and bones may only differ by one pixel along the edges,
+// i.e. every pixel one output has must be within one pixel in the other.
+// Drawn in bands, with either rasterizer and any bone thickness (1 is
+// Bresenham), the frame must be the same as drawn on one thread. Every case
+// is reported; exits with 1 if any failed.
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <print>
+#include <vector>
+#include <aux.hpp>
+
+namespace {
+constexpr size_t NUM_KEYPOINTS = 133;
+constexpr uint16_t COLS        = 320;
+constexpr uint16_t ROWS        = 240;
+constexpr size_t CHANNELS      = 3;
+
+// xorshift32, so that the keypoints are the same on every platform
+struct Rng {
+	uint32_t state;
+	uint32_t next() {
+		state ^= state << 13;
+		state ^= state >> 17;
+		state ^= state << 5;
+		return state;
+	}
+	// [0, 1)
+	float uniform() { return static_cast<float>(next() >> 8) / static_cast<float>(1 << 24); }
+};
+
+// people scattered over the frame and a margin around it, so that some bones
+// and landmarks are clipped at the borders
+std::vector<float> make_keypoints(size_t n_people, aux_img::Layout layout) {
+	constexpr float MARGIN = 24;
+	std::vector<float> keypoints(n_people * NUM_KEYPOINTS * 2);
+	Rng rng{0x9e3779b9u};
+	for (size_t p = 0; p < n_people; p++) {
+		float *kps = keypoints.data() + p * NUM_KEYPOINTS * 2;
+		for (size_t k = 0; k < NUM_KEYPOINTS; k++) {
+			const float x = -MARGIN + rng.uniform() * (COLS + 2 * MARGIN);
+			const float y = -MARGIN + rng.uniform() * (ROWS + 2 * MARGIN);
+			if (layout == aux_img::Layout::RowMajor) {
+				kps[k * 2]     = x;
+				kps[k * 2 + 1] = y;
+			} else {
+				kps[k]                 = x;
+				kps[NUM_KEYPOINTS + k] = y;
+			}
+		}
+	}
+	return keypoints;
+}
+
+std::vector<uint8_t> draw(const std::vector<float> &keypoints, size_t n_people, const aux_img::DrawSkeletonOptions &options, bool is_fast) {
+	std::vector<uint8_t> buffer(static_cast<size_t>(COLS) * ROWS * CHANNELS, 0);
+	const aux_img::SharedMat mat{buffer.data(), ROWS, COLS, aux_img::Depth::U8, aux_img::PixelFormat::BGR};
+	aux_img_set_fast_raster(is_fast);
+	aux_img_draw_poses_batch_impl(mat, keypoints.data(), n_people, nullptr, 0, {options, {}, 0}, nullptr);
+	aux_img_set_fast_raster(true);
+	return buffer;
+}
+
+const uint8_t *pixel_at(const std::vector<uint8_t> &buffer, int x, int y) {
+	return buffer.data() + (static_cast<size_t>(y) * COLS + x) * CHANNELS;
+}
+
+bool is_same_pixel(const uint8_t *a, const uint8_t *b) {
+	return a[0] == b[0] && a[1] == b[1] && a[2] == b[2];
+}
+
+// whether the pixel of `a` at (x, y) is also in `b`, at most one pixel away
+bool is_within_one_pixel(const std::vector<uint8_t> &a, const std::vector<uint8_t> &b, int x, int y) {
+	const uint8_t *expected = pixel_at(a, x, y);
+	for (int dy = -1; dy <= 1; dy++) {
+		for (int dx = -1; dx <= 1; dx++) {
+			const int nx = x + dx, ny = y + dy;
+			if (nx >= 0 && nx < COLS && ny >= 0 && ny < ROWS && is_same_pixel(expected, pixel_at(b, nx, ny))) {
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+struct Comparison {
+	size_t mismatched = 0;
+	// mismatches more than one pixel away from any pixel of the same color
+	size_t off_edge = 0;
+};
+
+Comparison compare(const std::vector<uint8_t> &fast, const std::vector<uint8_t> &reference) {
+	Comparison result;
+	for (int y = 0; y < ROWS; y++) {
+		for (int x = 0; x < COLS; x++) {
+			if (is_same_pixel(pixel_at(fast, x, y), pixel_at(reference, x, y))) {
+				continue;
+			}
+			result.mismatched++;
+			result.off_edge += !is_within_one_pixel(fast, reference, x, y) || !is_within_one_pixel(reference, fast, x, y);
+		}
+	}
+	return result;
+}
+}
+
+int main() {
+	constexpr size_t N_PEOPLE = 3;
+	int n_failed              = 0;
+	for (const int n_threads : {1, 4}) {
+		// the banded path of the pool must agree as well
+		aux_img_set_num_threads(n_threads);
+		for (const auto layout : {aux_img::Layout::RowMajor, aux_img::Layout::ColMajor}) {
+			const auto keypoints = make_keypoints(N_PEOPLE, layout);
+			for (const int radius : {0, 1, 2, 3, 5, 8}) {
+				const aux_img::DrawSkeletonOptions options{layout, true, false, radius, -1, 2, 0, 0, true};
+				const auto result = compare(draw(keypoints, N_PEOPLE, options, true), draw(keypoints, N_PEOPLE, options, false));
+				if (result.mismatched != 0) {
+					std::println("FAIL landmarks/threads={}/{}/r={}: {} pixels differ", n_threads, layout == aux_img::Layout::RowMajor ? "row" : "col", radius, result.mismatched);
+					n_failed++;
+				}
+			}
+			for (const int thickness : {2, 3, 4, 7}) {
+				const aux_img::DrawSkeletonOptions options{layout, false, true, 0, -1, thickness, 0, 0, true};
+				const auto result = compare(draw(keypoints, N_PEOPLE, options, true), draw(keypoints, N_PEOPLE, options, false));
+				if (result.off_edge != 0) {
+					std::println("FAIL bones/threads={}/{}/t={}: {} of {} differing pixels are not along an edge", n_threads, layout == aux_img::Layout::RowMajor ? "row" : "col", thickness, result.off_edge, result.mismatched);
+					n_failed++;
+				}
+			}
+		}
+	}
+	for (const bool is_fast : {true, false}) {
+		for (const auto layout : {aux_img::Layout::RowMajor, aux_img::Layout::ColMajor}) {
+			const auto keypoints = make_keypoints(N_PEOPLE, layout);
+			for (const int thickness : {1, 2, 3, 7}) {
+				// rings go through OpenCV either way
+				for (const int landmark_thickness : {-1, 1}) {
+					const aux_img::DrawSkeletonOptions options{layout, true, true, 3, landmark_thickness, thickness, 0, 0, true};
+					aux_img_set_num_threads(1);
+					const auto serial = draw(keypoints, N_PEOPLE, options, is_fast);
+					for (const int n_threads : {2, 4}) {
+						aux_img_set_num_threads(n_threads);
+						const auto result = compare(draw(keypoints, N_PEOPLE, options, is_fast), serial);
+						if (result.mismatched != 0) {
+							std::println("FAIL banded/{}/threads={}/{}/t={}/lt={}: {} pixels differ from one thread", is_fast ? "fast" : "opencv", n_threads,
+										 layout == aux_img::Layout::RowMajor ? "row" : "col", thickness, landmark_thickness, result.mismatched);
+							n_failed++;
+						}
+					}
+				}
+			}
+		}
+	}
+	aux_img_set_num_threads(1);
+	if (n_failed != 0) {
+		return EXIT_FAILURE;
+	}
+	std::println("raster_test: ok");
+	return EXIT_SUCCESS;
+}
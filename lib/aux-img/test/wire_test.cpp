@@ -0,0 +1,202 @@
+// the v2 pose message round trip: `aux_img_pose_encode`, then
+// `aux_img_pose_view_parse` and `aux_img_pose_view_decode`
+//
+// a person count that is not a multiple of 8, a skeleton without extent, an
+// all missing one and NaN keypoints scattered over the rest: every finite
+// keypoint must come back within half a step of its axis (plus the rounding
+// of the float arithmetic), every NaN as NaN, confidences within half a level
+// and boxes exactly. A v1 message must come back exactly. Every case is
+// reported; exits with 1 if any failed.
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <print>
+#include <vector>
+#include <aux.hpp>
+
+namespace {
+constexpr size_t NUM_KEYPOINTS = 133;
+constexpr size_t STRIDE        = NUM_KEYPOINTS * 2;
+constexpr size_t N_PEOPLE      = 11;
+constexpr size_t N_BOXES       = 5;
+constexpr uint32_t FRAME_INDEX = 0x01020304;
+// of the v2 layout, see `PoseView`
+constexpr size_t V2_HEADER_SIZE   = 12;
+constexpr size_t V2_SKELETON_SIZE = 4 * sizeof(float) + STRIDE * sizeof(uint16_t);
+constexpr float V2_MAX_LEVEL      = 65534;
+
+// xorshift32, so that the poses are the same on every platform
+struct Rng {
+	uint32_t state;
+	uint32_t next() {
+		state ^= state << 13;
+		state ^= state >> 17;
+		state ^= state << 5;
+		return state;
+	}
+	// [0, 1)
+	float uniform() { return static_cast<float>(next() >> 8) / static_cast<float>(1 << 24); }
+};
+
+struct Poses {
+	std::vector<float> keypoints   = std::vector<float>(N_PEOPLE * STRIDE);
+	std::vector<float> confidences = std::vector<float>(N_PEOPLE * NUM_KEYPOINTS);
+	std::vector<uint16_t> boxes    = std::vector<uint16_t>(N_BOXES * 4);
+};
+
+// person 0 has no extent and person 1 no keypoint at all; the others are of
+// every size, partly off screen, with about one keypoint in 16 missing
+Poses make_poses() {
+	Poses poses;
+	Rng rng{0x9e3779b9u};
+	for (size_t p = 0; p < N_PEOPLE; p++) {
+		float *kps       = poses.keypoints.data() + p * STRIDE;
+		const float size = 10.0f + rng.uniform() * 2000;
+		const float x0   = -200 + rng.uniform() * 2000;
+		const float y0   = -200 + rng.uniform() * 1200;
+		for (size_t k = 0; k < NUM_KEYPOINTS; k++) {
+			const bool is_missing = p == 1 || (p > 1 && rng.next() % 16 == 0);
+			kps[k * 2]            = p == 0 ? 50.5f : x0 + rng.uniform() * size;
+			kps[k * 2 + 1]        = p == 0 ? 60.25f : y0 + rng.uniform() * size;
+			if (is_missing) {
+				kps[k * 2]     = NAN;
+				kps[k * 2 + 1] = NAN;
+			}
+			poses.confidences[p * NUM_KEYPOINTS + k] = rng.uniform();
+		}
+	}
+	for (auto &v : poses.boxes) {
+		v = static_cast<uint16_t>(rng.next());
+	}
+	return poses;
+}
+
+std::vector<uint8_t> encode_v1(const Poses &poses) {
+	std::vector<uint8_t> message(4 + 1 + 1 + poses.keypoints.size() * sizeof(float) + poses.boxes.size() * sizeof(uint16_t));
+	uint8_t *out = message.data();
+	std::memcpy(out, &FRAME_INDEX, 4);
+	out[4] = static_cast<uint8_t>(N_PEOPLE);
+	out[5] = static_cast<uint8_t>(N_BOXES);
+	std::memcpy(out + 6, poses.keypoints.data(), poses.keypoints.size() * sizeof(float));
+	std::memcpy(out + 6 + poses.keypoints.size() * sizeof(float), poses.boxes.data(), poses.boxes.size() * sizeof(uint16_t));
+	return message;
+}
+
+struct Decoded {
+	aux_img::PoseView view{};
+	std::vector<float> keypoints   = std::vector<float>(N_PEOPLE * STRIDE);
+	std::vector<float> confidences = std::vector<float>(N_PEOPLE * NUM_KEYPOINTS);
+	std::vector<uint16_t> boxes    = std::vector<uint16_t>(N_BOXES * 4);
+};
+
+bool decode(const char *name, const std::vector<uint8_t> &message, Decoded &out) {
+	if (aux_img_pose_view_parse(message.data(), message.size(), &out.view) != aux_img::Status::Ok ||
+		aux_img_pose_view_decode(&out.view, out.keypoints.data(), out.boxes.data(), out.confidences.data()) != aux_img::Status::Ok) {
+		std::println("FAIL {}: {}", name, aux_img_last_error());
+		return false;
+	}
+	if (out.view.frame_index != FRAME_INDEX || out.view.n_people != N_PEOPLE || out.view.n_boxes != N_BOXES) {
+		std::println("FAIL {}: frame {}, {} people and {} boxes", name, out.view.frame_index, out.view.n_people, out.view.n_boxes);
+		return false;
+	}
+	return true;
+}
+
+// 0 if the case passed
+int check_v2(const Poses &poses) {
+	std::vector<uint8_t> message(aux_img_pose_encoded_size(N_PEOPLE, N_BOXES));
+	size_t size = 0;
+	if (aux_img_pose_encode(FRAME_INDEX, poses.keypoints.data(), poses.confidences.data(), N_PEOPLE, poses.boxes.data(), N_BOXES,
+							message.data(), message.size(), &size) != aux_img::Status::Ok ||
+		size != message.size()) {
+		std::println("FAIL v2: encode: {}", aux_img_last_error());
+		return 1;
+	}
+	Decoded decoded;
+	if (!decode("v2", message, decoded)) {
+		return 1;
+	}
+	if (decoded.view.version != 2) {
+		std::println("FAIL v2: read as version {}", decoded.view.version);
+		return 1;
+	}
+	int n_failed = 0;
+	for (size_t p = 0; p < N_PEOPLE; p++) {
+		// origin x, y and step x, y of the skeleton
+		float anchor[4];
+		std::memcpy(anchor, message.data() + V2_HEADER_SIZE + p * V2_SKELETON_SIZE, sizeof(anchor));
+		size_t n_off  = 0;
+		size_t n_nan  = 0;
+		float max_err = 0;
+		for (size_t k = 0; k < STRIDE; k++) {
+			const float sent = poses.keypoints[p * STRIDE + k];
+			const float got  = decoded.keypoints[p * STRIDE + k];
+			if (std::isnan(sent) || std::isnan(got)) {
+				n_nan += std::isnan(sent) != std::isnan(got);
+				continue;
+			}
+			const float step   = anchor[2 + k % 2];
+			const float extent = step * V2_MAX_LEVEL;
+			const float err    = std::abs(got - sent);
+			max_err            = std::max(max_err, err);
+			n_off += err > step / 2 + 4 * FLT_EPSILON * (std::abs(anchor[k % 2]) + extent);
+		}
+		if (n_off != 0 || n_nan != 0) {
+			std::println("FAIL v2/person {}: {} values off by more than half a step ({}, {}; max {}), {} NaN mismatches",
+						 p, n_off, anchor[2], anchor[3], max_err, n_nan);
+			n_failed++;
+		}
+	}
+	size_t n_confidences_off = 0;
+	for (size_t i = 0; i < poses.confidences.size(); i++) {
+		n_confidences_off += std::abs(decoded.confidences[i] - poses.confidences[i]) > 0.5f / 255 + FLT_EPSILON;
+	}
+	if (n_confidences_off != 0) {
+		std::println("FAIL v2: {} confidences off by more than half a level", n_confidences_off);
+		n_failed++;
+	}
+	if (decoded.boxes != poses.boxes) {
+		std::println("FAIL v2: boxes differ");
+		n_failed++;
+	}
+	return n_failed;
+}
+
+int check_v1(const Poses &poses) {
+	Decoded decoded;
+	if (!decode("v1", encode_v1(poses), decoded)) {
+		return 1;
+	}
+	int n_failed = 0;
+	// bitwise, NaN included
+	if (decoded.view.version != 1 || std::memcmp(decoded.keypoints.data(), poses.keypoints.data(), poses.keypoints.size() * sizeof(float)) != 0) {
+		std::println("FAIL v1: keypoints differ from the ones sent");
+		n_failed++;
+	}
+	if (std::any_of(decoded.confidences.begin(), decoded.confidences.end(), [](float c) { return c != 1.0f; })) {
+		std::println("FAIL v1: confidences are not all 1");
+		n_failed++;
+	}
+	if (decoded.boxes != poses.boxes) {
+		std::println("FAIL v1: boxes differ");
+		n_failed++;
+	}
+	return n_failed;
+}
+}
+
+int main() {
+	const auto poses = make_poses();
+	int n_failed     = 0;
+	n_failed += check_v2(poses);
+	n_failed += check_v1(poses);
+	if (n_failed != 0) {
+		return EXIT_FAILURE;
+	}
+	std::println("wire_test: ok");
+	return EXIT_SUCCESS;
+}
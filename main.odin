@@ -1,14 +1,21 @@
 package main
+import "base:intrinsics"
 import "base:runtime"
 import "components/cvmmap"
+import "components/reactor"
+import "components/record"
 import "core:c"
 import "core:flags"
 import "core:fmt"
 import "core:log"
+import "core:math"
+import "core:mem"
 import "core:os"
 import "core:slice"
+import "core:strings"
 import "core:sync"
 import "core:sys/posix"
+import "core:time"
 import aux "lib/aux-img"
 import aux_info "lib/aux-img/info"
 import aux_skt "lib/aux-img/socket"
@@ -40,16 +47,60 @@ check_and_unset :: proc(flag: ^bool) -> bool {
 	return r
 }
 
-gui_main :: proc(instance_name: string) {
+gl_texture_from_bgr_buffer :: proc(buffer: []u8, width: u32, height: u32) -> u32 {
+	// Create a OpenGL texture identifier
+	tid: u32
+	gl.GenTextures(1, &tid)
+	gl.BindTexture(gl.TEXTURE_2D, tid)
+	// Setup filtering parameters for display
+	gl.TexParameteri(gl.TEXTURE_2D, gl.TEXTURE_MIN_FILTER, gl.LINEAR)
+	gl.TexParameteri(gl.TEXTURE_2D, gl.TEXTURE_MAG_FILTER, gl.LINEAR)
+	// Upload pixels into texture
+	gl.PixelStorei(gl.UNPACK_ROW_LENGTH, 0)
+	// https://docs.gl/gl3/glTexImage2D
+	// https://github.com/drbrain/opengl/blob/master/ext/opengl/gl-enums.h
+	// https://stackoverflow.com/questions/4745264/opengl-gl-bgr-not-working-for-texture-internal-format
+	gl.TexImage2D(
+		gl.TEXTURE_2D,
+		0,
+		gl.RGB,
+		cast(i32)width,
+		cast(i32)height,
+		0,
+		gl.BGR,
+		gl.UNSIGNED_BYTE,
+		raw_data(buffer),
+	)
+	return tid
+}
+
+max_width_retain_ar :: proc(target_max_width: f32, width: f32, height: f32) -> (f32, f32) {
+	aspect_ratio := width / height
+	new_width := width
+	new_height := height
+	if width > target_max_width {
+		new_width = target_max_width
+		new_height = new_width / aspect_ratio
+	}
+	return new_width, new_height
+}
+
+// with `record_path`, what is received is also appended to it
+gui_main :: proc(instance_name: string, is_dispatch_to_worker: bool, preview_width: int, record_path: string) {
 	context.logger = log.create_console_logger(log.Level.Debug)
-	assert(cast(bool)glfw.Init(), "failed to initialize GLFW")
-	defer glfw.Terminate()
 
 	zmq_ctx := zmq.ctx_new()
 	defer zmq.ctx_term(zmq_ctx)
+	// one thread for both sockets
+	event_loop := reactor.create(is_dispatch_to_worker)
+	defer reactor.destroy(event_loop)
+	// closed once both clients are stopped
+	recorder := open_recorder(record_path)
+	defer close_recorder(recorder)
 
 	client := cvmmap.create(instance_name, zmq_ctx)
 	log.info("created")
+	aux.set_latency_enabled(true)
 	defer {
 		cvmmap.destroy(client)
 		log.info("cv-mmap client destroyed")
@@ -66,29 +117,50 @@ gui_main :: proc(instance_name: string) {
 	}
 
 	SharedPoseInfo :: struct {
-		mutex: sync.Mutex,
-		data:  Maybe(aux_info.PoseInfo),
+		// handed from the socket thread to the frame thread without locking,
+		// so that neither waits for the other
+		buffer:   aux.PoseBuffer,
+		// the pose stream is usually slower than the camera, and behind it;
+		// frames are drawn with the poses sampled at their own index. Only
+		// touched by the frame thread.
+		history:  aux_info.History,
+		// nil unless recording
+		recorder: ^record.Recorder,
 	}
-	pose_info := SharedPoseInfo{sync.Mutex{}, nil}
-	on_bin_frame :: proc(info: aux_info.PoseInfo, user_data: rawptr) -> bool {
+	pose_buffer: aux.PoseBuffer
+	pose_buffer_status := aux.pose_buffer_create(32, &pose_buffer)
+	assert(pose_buffer_status == .Ok, "failed to create pose buffer")
+	defer aux.pose_buffer_destroy(pose_buffer)
+	history, history_ok := aux_info.history_make(8, 32)
+	assert(history_ok, "failed to create pose history")
+	pose_info := SharedPoseInfo{pose_buffer, history, recorder}
+	defer aux_info.history_destroy(&pose_info.history)
+	// copied from the received message straight into a free slot
+	on_bin_frame :: proc(view: ^aux_info.PoseView, user_data: rawptr) {
 		shared_pose_info := cast(^SharedPoseInfo)user_data
-		if sync.mutex_guard(&shared_pose_info.mutex) {
-			if data, ok := shared_pose_info.data.?; ok {
-				aux_info.destroy(&data)
+		aux.pose_buffer_write_view(shared_pose_info.buffer, view)
+	}
+	bin_client.on_view = on_bin_frame
+	bin_client.user_data = &pose_info
+	if recorder != nil {
+		// the message as received, whichever version it is
+		bin_client.on_message = proc(data: []u8, user_data: rawptr) {
+			shared_pose_info := cast(^SharedPoseInfo)user_data
+			// a malformed message has no frame index to be found by
+			view, ok := aux_info.parse_view(data)
+			if !ok {
+				return
 			}
-			shared_pose_info.data = info
+			record.append_pose(shared_pose_info.recorder, view.frame_index, data)
 		}
-		return true
 	}
-	bin_client.on_info = on_bin_frame
-	bin_client.user_data = &pose_info
 
 	if err := aux_skt.init(bin_client); err != nil {
 		log.errorf("failed to initialize aux-skt client: %v", err)
 		assert(false, "failed to initialize aux-skt client")
 	}
 
-	if err := aux_skt.start(bin_client); err != nil {
+	if err := aux_skt.start(bin_client, event_loop); err != nil {
 		log.errorf("failed to start aux-skt client: %v", err)
 		assert(false, "failed to start aux-skt client")
 	}
@@ -97,50 +169,6 @@ gui_main :: proc(instance_name: string) {
 		log.info("bin socket stopped")
 	}
 
-	// Set Window Hints
-	// https://www.glfw.org/docs/latest/window_guide.html#window_hints
-	glfw.WindowHint(glfw.CONTEXT_VERSION_MAJOR, GL_MAJOR_VERSION)
-	glfw.WindowHint(glfw.CONTEXT_VERSION_MINOR, GL_MINOR_VERSION)
-	glfw.WindowHint(glfw.OPENGL_PROFILE, glfw.OPENGL_CORE_PROFILE)
-	glfw.WindowHint(glfw.OPENGL_FORWARD_COMPAT, 1)
-	glfw.WindowHint(glfw.RESIZABLE, 1)
-
-	// https://stackoverflow.com/questions/66299684/how-to-prevent-glfw-window-from-showing-up-right-in-creating
-	// https://github.com/glfw/glfw/commit/cd8df53d96a3f05ab66032fbaa69b3eead7f6295
-	glfw.WindowHint_bool(glfw.VISIBLE, true)
-	glfw.WindowHint_bool(glfw.DECORATED, true)
-	glfw.WindowHint_bool(glfw.FLOATING, false)
-	window := glfw.CreateWindow(640, 800, "Hello", nil, nil)
-	assert(window != nil, "Failed to create window")
-	defer glfw.DestroyWindow(window)
-	glfw.MakeContextCurrent(window)
-	glfw.SwapInterval(1) // vsync
-
-	gl.load_up_to(GL_MAJOR_VERSION, GL_MINOR_VERSION, proc(p: rawptr, name: cstring) {
-		(cast(^rawptr)p)^ = glfw.GetProcAddress(name)
-	})
-
-	im.CHECKVERSION()
-	im.CreateContext()
-	defer im.DestroyContext()
-	io := im.GetIO()
-	io.ConfigFlags += {.NavEnableKeyboard, .NavEnableGamepad}
-
-	when !DISABLE_DOCKING {
-		io.ConfigFlags += {.DockingEnable}
-		io.ConfigFlags += {.ViewportsEnable}
-
-		style := im.GetStyle()
-		style.WindowRounding = 0
-		style.Colors[im.Col.WindowBg].w = 1
-	}
-
-	im.StyleColorsDark()
-	assert(imgui_impl_glfw.InitForOpenGL(window, true), "failed to initialize ImGui GLFW")
-	defer imgui_impl_glfw.Shutdown()
-	assert(imgui_impl_opengl3.Init(GLSL_VERSION), "failed to initialize ImGui OpenGL3")
-	defer imgui_impl_opengl3.Shutdown()
-
 	TextureInfo :: struct {
 		// if it's nil, it will use the shared memory buffer
 		// directly;
@@ -157,6 +185,22 @@ gui_main :: proc(instance_name: string) {
 		texture_index:  u32,
 		info:           TextureInfo,
 		pose_info:      ^SharedPoseInfo,
+		client:         ^cvmmap.CvMmapClient,
+		// of the frame in the texture buffer, for the `Total` stage
+		published_ns:   u64,
+		// to count frames never delivered
+		frame_index:    u32,
+		// frames wider than this are scaled down to it first; 0 never does
+		preview_width:  u16,
+		recorder:       ^record.Recorder,
+		// guards `info` against the frame thread replacing it on a resize
+		mutex:          sync.Mutex,
+		// texture buffers replaced by a resize, freed by the render thread
+		// once it no longer uploads from them
+		retired:        [dynamic][]u8,
+		// render thread only; the size of the GL texture
+		texture_width:  u32,
+		texture_height: u32,
 	}
 
 	render_ctx := VideoRenderContext {
@@ -166,89 +210,101 @@ gui_main :: proc(instance_name: string) {
 		0,
 		TextureInfo{nil, nil, 0, 0},
 		&pose_info,
+		client,
+		0,
+		0,
+		u16(preview_width),
+		recorder,
+		{},
+		nil,
+		0,
+		0,
 	}
-	gl_texture_from_bgr_buffer :: proc(buffer: []u8, width: u32, height: u32) -> u32 {
-		// Create a OpenGL texture identifier
-		tid: u32
-		gl.GenTextures(1, &tid)
-		gl.BindTexture(gl.TEXTURE_2D, tid)
-		// Setup filtering parameters for display
-		gl.TexParameteri(gl.TEXTURE_2D, gl.TEXTURE_MIN_FILTER, gl.LINEAR)
-		gl.TexParameteri(gl.TEXTURE_2D, gl.TEXTURE_MAG_FILTER, gl.LINEAR)
-		// Upload pixels into texture
-		gl.PixelStorei(gl.UNPACK_ROW_LENGTH, 0)
-		// https://docs.gl/gl3/glTexImage2D
-		// https://github.com/drbrain/opengl/blob/master/ext/opengl/gl-enums.h
-		// https://stackoverflow.com/questions/4745264/opengl-gl-bgr-not-working-for-texture-internal-format
-		gl.TexImage2D(
-			gl.TEXTURE_2D,
-			0,
-			gl.RGB,
-			cast(i32)width,
-			cast(i32)height,
-			0,
-			gl.BGR,
-			gl.UNSIGNED_BYTE,
-			raw_data(buffer),
-		)
-		return tid
+	// after the client is stopped; without `MODIFY_IMAGE` the buffer is the
+	// shared memory
+	defer {
+		if render_ctx.info.allocator != nil {
+			delete(render_ctx.info.texture_buffer)
+		}
+		for buffer in render_ctx.retired {
+			delete(buffer)
+		}
+		delete(render_ctx.retired)
 	}
-
 	client.on_frame = proc(metadata: cvmmap.FrameMetadata, buffer: []u8, user_data: rawptr) {
 		info := metadata.info
 		frame_index := metadata.frame_index
 		ctx_opt := cast(^VideoRenderContext)user_data
 		pose_info := ctx_opt.pose_info
 		assert(ctx_opt != nil, "invalid user_data")
+		timing := ctx_opt.client.timing
+		record_delivery(timing)
+		if ctx_opt.frame_index != 0 && frame_index > ctx_opt.frame_index + 1 {
+			aux.latency_add_dropped(u64(frame_index - ctx_opt.frame_index - 1))
+		}
+		ctx_opt.frame_index = frame_index
+		ctx_opt.published_ns = timing.published_ns
+		if ctx_opt.recorder != nil {
+			record.append_frame(ctx_opt.recorder, metadata, buffer)
+		}
 		when !MODIFY_IMAGE {
-			ctx_opt.info = TextureInfo{nil, buffer, u32(info.width), u32(info.height)}
+			if sync.mutex_guard(&ctx_opt.mutex) {
+				ctx_opt.info = TextureInfo{nil, buffer, u32(info.width), u32(info.height)}
+			}
 		} else {
-			modify :: proc(
-				data: rawptr,
-				info: cvmmap.FrameInfo,
-				pose_info: ^SharedPoseInfo,
-				frame_index: u32,
-			) {
-				mat := aux.SharedMat {
-					data,
-					info.height,
-					info.width,
-					aux.Depth(info.depth),
-					aux.PixelFormat(info.pixel_format),
-				}
-				opts := aux_info.DrawPoseOptions {
-					landmark_radius        = 5,
-					landmark_thickness     = -1,
-					bone_thickness         = 2,
-					bounding_box_thickness = 5,
-					bounding_box_color     = {0, 250, 0},
-				}
-				if sync.mutex_guard(&pose_info.mutex) {
-					if data, ok := pose_info.data.?; ok {
-						in_range :: proc(val: u32, min: u32, max: u32) -> bool {
-							return val >= min && val <= max
-						}
-						if in_range(data.frame_index, frame_index - 6, frame_index + 6) {
-							aux_info.draw(mat, &data, opts)
-						}
+			mat := aux.SharedMat {
+				raw_data(buffer),
+				info.height,
+				info.width,
+				aux.Depth(info.depth),
+				aux.PixelFormat(info.pixel_format),
+			}
+			opts := aux_info.DrawPoseOptions {
+				landmark_radius        = 5,
+				landmark_thickness     = -1,
+				bone_thickness         = 2,
+				bounding_box_thickness = 5,
+				bounding_box_color     = {0, 250, 0},
+				face_min_height        = 64,
+				hand_min_height        = 96,
+				is_cull                = true,
+			}
+			// the texture is only as large as it is shown; 0 keeps the frame size
+			cols, rows := info.width, info.height
+			if ctx_opt.preview_width != 0 && info.width > ctx_opt.preview_width {
+				cols = ctx_opt.preview_width
+				rows = u16(max(1, int(info.height) * int(cols) / int(info.width)))
+			}
+			// rows padded to 4 bytes, i.e. the default `GL_UNPACK_ALIGNMENT`
+			step := aux.composite_step(cols, .BGR, true)
+			size := int(step) * int(rows)
+			// the first frame, or the producer changed the resolution; the
+			// render thread recreates the texture when it sees the new size
+			if !ctx_opt._has_info_init || ctx_opt.info.width != u32(cols) || ctx_opt.info.height != u32(rows) {
+				texture_buffer := make([]u8, size)
+				if sync.mutex_guard(&ctx_opt.mutex) {
+					if ctx_opt.info.texture_buffer != nil {
+						append(&ctx_opt.retired, ctx_opt.info.texture_buffer)
 					}
+					ctx_opt.info = TextureInfo{context.allocator, texture_buffer, u32(cols), u32(rows)}
 				}
 			}
-			if !ctx_opt._has_info_init {
-				loc_buf := make([]u8, len(buffer))
-				copy(loc_buf, buffer)
-				ctx_opt.info = TextureInfo {
-					context.allocator,
-					loc_buf,
-					u32(info.width),
-					u32(info.height),
-				}
-				modify(raw_data(ctx_opt.info.texture_buffer), info, pose_info, frame_index)
-			} else {
-				assert(ctx_opt.info.texture_buffer != nil, "invalid texture buffer")
-				assert(len(ctx_opt.info.texture_buffer) == len(buffer), "invalid buffer size")
-				copy(ctx_opt.info.texture_buffer, buffer)
-				modify(raw_data(ctx_opt.info.texture_buffer), info, pose_info, frame_index)
+			assert(ctx_opt.info.texture_buffer != nil, "invalid texture buffer")
+			assert(len(ctx_opt.info.texture_buffer) == size, "invalid buffer size")
+			// read the shared memory once, converting it into the texture buffer
+			// (scaled down first for a preview) and drawing the overlay on top
+			dst := aux.CompositeTarget{raw_data(ctx_opt.info.texture_buffer), step, .BGR}
+			preview := aux.PreviewTarget{dst.data, step, rows, cols, .BGR}
+			newest: aux.PoseFrame
+			if aux.pose_buffer_read(pose_info.buffer, &newest) == .Ok && newest.is_fresh {
+				aux_info.history_push_frame(&pose_info.history, &newest)
+			}
+			// up to 6 frames past the newest poses, as before
+			data := aux_info.history_sample(&pose_info.history, frame_index, 6)
+			if cols == info.width {
+				aux_info.composite(mat, dst, data, opts)
+			} else if _, status := aux_info.preview(mat, preview, data, aux_info.scale_draw_options(opts, f32(cols) / f32(info.width))); status != .Ok {
+				log.errorf("failed to draw the preview: %s", aux.last_error())
 			}
 		}
 		if !ctx_opt._has_info_init {
@@ -257,33 +313,79 @@ gui_main :: proc(instance_name: string) {
 		ctx_opt.is_dirty = true
 	}
 	client.user_data = &render_ctx
-	if err := cvmmap.start(client); err != nil {
+	when MODIFY_IMAGE {
+		// the frame is read once into the texture buffer; if the producer
+		// overwrote it meanwhile, the newer frame is read instead
+		client.consistency = .Retry
+		client.max_retries = 2
+	}
+	// ring slots are checked whatever the consistency
+	client.on_torn = proc(metadata: cvmmap.FrameMetadata, user_data: rawptr) {
+		ctx_opt := cast(^VideoRenderContext)user_data
+		// recorded by `on_frame` before the check, e.g. ahead of its retry
+		if ctx_opt.recorder != nil {
+			record.retract_frame(ctx_opt.recorder, metadata)
+		}
+		when MODIFY_IMAGE {
+			// keep showing the previous frame; the first one is shown anyway
+			if ctx_opt._has_gl_init {
+				ctx_opt.is_dirty = false
+			}
+		}
+	}
+	if err := cvmmap.start(client, event_loop); err != nil {
 		log.errorf("failed to start cv-mmap client: %v", err)
 		assert(false, "failed to start cv-mmap client")
 	}
 	defer {
 		cvmmap.stop(client)
-		log.info("cv-mmap client stopped")
+		log.infof("cv-mmap client stopped; %v", cvmmap.consistency_stats(client))
 	}
+	reactor.start(event_loop)
+	// before the clients are stopped
+	defer reactor.stop(event_loop)
 
 	handle_texture :: proc(self: ^VideoRenderContext) {
 		if !self._has_info_init {
 			return
 		}
+		info: TextureInfo
+		if sync.mutex_guard(&self.mutex) {
+			info = self.info
+			// no upload reads them anymore
+			for buffer in self.retired {
+				delete(buffer)
+			}
+			clear(&self.retired)
+		}
+		if self._has_gl_init && (info.width != self.texture_width || info.height != self.texture_height) {
+			// the resolution changed; a texture of the new size instead
+			log.infof("texture resized; %dx%d -> %dx%d", self.texture_width, self.texture_height, info.width, info.height)
+			gl.DeleteTextures(1, &self.texture_index)
+			self._has_gl_init = false
+			self.is_dirty = true
+		}
 		if !self._has_gl_init {
-			assert(self.info.texture_buffer != nil, "invalid texture buffer")
+			assert(info.texture_buffer != nil, "invalid texture buffer")
 			assert(self.is_dirty, "invalid dirty state, expecting true")
-			self.texture_index = gl_texture_from_bgr_buffer(
-				self.info.texture_buffer,
-				self.info.width,
-				self.info.height,
-			)
+			self.texture_index = gl_texture_from_bgr_buffer(info.texture_buffer, info.width, info.height)
+			self.texture_width = info.width
+			self.texture_height = info.height
 			self._has_gl_init = true
 			self.is_dirty = false
 			return
 		}
 
 		if check_and_unset(&self.is_dirty) {
+			// the CPU side only, i.e. the driver taking the buffer
+			upload_start := aux.now_ns()
+			defer {
+				now := aux.now_ns()
+				aux.latency_record(.Upload, now - upload_start)
+				if self.published_ns != 0 {
+					aux.latency_record(.Total, now - self.published_ns)
+				}
+			}
 			// https://learnopengl.com/Getting-started/Textures
 			// https://github.com/ocornut/imgui/wiki/Image-Loading-and-Displaying-Examples
 			// glTexSubImage2D to update the texture (I'm assuming the parameters are the same)
@@ -293,26 +395,86 @@ gui_main :: proc(instance_name: string) {
 				0,
 				0,
 				0,
-				cast(i32)self.info.width,
-				cast(i32)self.info.height,
+				cast(i32)info.width,
+				cast(i32)info.height,
 				gl.BGR,
 				gl.UNSIGNED_BYTE,
-				raw_data(self.info.texture_buffer),
+				raw_data(info.texture_buffer),
 			)
 		}
 	}
 
-	max_width_retain_ar :: proc(target_max_width: f32, width: f32, height: f32) -> (f32, f32) {
-		aspect_ratio := width / height
-		new_width := width
-		new_height := height
-		if width > target_max_width {
-			new_width = target_max_width
-			new_height = new_width / aspect_ratio
+	draw := proc(target_width: f32, user_data: rawptr) {
+		render_ctx := cast(^VideoRenderContext)user_data
+		handle_texture(render_ctx)
+		if render_ctx._has_gl_init {
+			width, height := max_width_retain_ar(
+				target_width,
+				cast(f32)render_ctx.texture_width,
+				cast(f32)render_ctx.texture_height,
+			)
+			im.Image(
+				cast(im.TextureID)(uintptr(render_ctx.texture_index)),
+				im.Vec2{width, height},
+			)
 		}
-		return new_width, new_height
+	}
+	gui_run("Hello", draw, &render_ctx)
+}
+
+// called within the window of `gui_run` every frame, with the width it has
+// for images; GL calls are fine
+GuiDraw_Proc :: proc(target_width: f32, user_data: rawptr)
+
+// the window, ImGui and the render loop, until the window is closed
+gui_run :: proc(title: cstring, draw: GuiDraw_Proc, user_data: rawptr) {
+	assert(cast(bool)glfw.Init(), "failed to initialize GLFW")
+	defer glfw.Terminate()
+
+	// Set Window Hints
+	// https://www.glfw.org/docs/latest/window_guide.html#window_hints
+	glfw.WindowHint(glfw.CONTEXT_VERSION_MAJOR, GL_MAJOR_VERSION)
+	glfw.WindowHint(glfw.CONTEXT_VERSION_MINOR, GL_MINOR_VERSION)
+	glfw.WindowHint(glfw.OPENGL_PROFILE, glfw.OPENGL_CORE_PROFILE)
+	glfw.WindowHint(glfw.OPENGL_FORWARD_COMPAT, 1)
+	glfw.WindowHint(glfw.RESIZABLE, 1)
+
+	// https://stackoverflow.com/questions/66299684/how-to-prevent-glfw-window-from-showing-up-right-in-creating
+	// https://github.com/glfw/glfw/commit/cd8df53d96a3f05ab66032fbaa69b3eead7f6295
+	glfw.WindowHint_bool(glfw.VISIBLE, true)
+	glfw.WindowHint_bool(glfw.DECORATED, true)
+	glfw.WindowHint_bool(glfw.FLOATING, false)
+	window := glfw.CreateWindow(640, 800, title, nil, nil)
+	assert(window != nil, "Failed to create window")
+	defer glfw.DestroyWindow(window)
+	glfw.MakeContextCurrent(window)
+	glfw.SwapInterval(1) // vsync
+
+	gl.load_up_to(GL_MAJOR_VERSION, GL_MINOR_VERSION, proc(p: rawptr, name: cstring) {
+		(cast(^rawptr)p)^ = glfw.GetProcAddress(name)
+	})
+
+	im.CHECKVERSION()
+	im.CreateContext()
+	defer im.DestroyContext()
+	io := im.GetIO()
+	io.ConfigFlags += {.NavEnableKeyboard, .NavEnableGamepad}
+
+	when !DISABLE_DOCKING {
+		io.ConfigFlags += {.DockingEnable}
+		io.ConfigFlags += {.ViewportsEnable}
+
+		style := im.GetStyle()
+		style.WindowRounding = 0
+		style.Colors[im.Col.WindowBg].w = 1
 	}
 
+	im.StyleColorsDark()
+	assert(imgui_impl_glfw.InitForOpenGL(window, true), "failed to initialize ImGui GLFW")
+	defer imgui_impl_glfw.Shutdown()
+	assert(imgui_impl_opengl3.Init(GLSL_VERSION), "failed to initialize ImGui OpenGL3")
+	defer imgui_impl_opengl3.Shutdown()
+
 	// call this function in the imgui loop, when targeting a window
 	imgui_follow_glfw_window :: proc(window: glfw.WindowHandle) {
 		pos_x, pos_y := glfw.GetWindowPos(window)
@@ -329,7 +491,6 @@ gui_main :: proc(instance_name: string) {
 		imgui_impl_glfw.NewFrame()
 		im.NewFrame()
 
-		handle_texture(&render_ctx)
 		// https://github.com/ocornut/imgui/issues/3693
 		// https://github.com/ocornut/imgui/issues/5277
 		if im.Begin("Window containing a quit button", flags = {.NoResize}) {
@@ -347,17 +508,7 @@ gui_main :: proc(instance_name: string) {
 			if im.Button("quit me!") {
 				glfw.SetWindowShouldClose(window, true)
 			}
-			if render_ctx._has_gl_init {
-				width, height := max_width_retain_ar(
-					target_width,
-					cast(f32)render_ctx.info.width,
-					cast(f32)render_ctx.info.height,
-				)
-				im.Image(
-					cast(im.TextureID)(uintptr(render_ctx.texture_index)),
-					im.Vec2{width, height},
-				)
-			}
+			draw(target_width, user_data)
 		}
 		im.End()
 
@@ -379,9 +530,196 @@ gui_main :: proc(instance_name: string) {
 	}
 }
 
-cli_main :: proc(instance_name: string) {
+// every camera of `instance_names` in one texture, one tile each, received
+// on a single reactor thread; no poses are drawn
+mosaic_main :: proc(instance_names: []string, tile_width: int, is_dispatch_to_worker: bool) {
+	context.logger = log.create_console_logger(log.Level.Debug)
+
+	n := len(instance_names)
+	grid_cols := int(math.ceil(math.sqrt(f64(n))))
+	grid_rows := (n + grid_cols - 1) / grid_cols
+	layout := aux.MosaicLayout {
+		grid_cols = u16(grid_cols),
+		grid_rows = u16(grid_rows),
+		tile_cols = u16(tile_width),
+		// 16:9, the usual camera
+		tile_rows = u16(tile_width * 9 / 16),
+		format    = .BGR,
+	}
+	mosaic: aux.Mosaic
+	status := aux.mosaic_create(layout, &mosaic)
+	assert(status == .Ok, fmt.tprintf("failed to create mosaic: %s", aux.last_error()))
+	defer aux.mosaic_destroy(mosaic)
+
+	MosaicContext :: struct {
+		mosaic:        aux.Mosaic,
+		width:         u32,
+		height:        u32,
+		texture_index: u32,
+	}
+	mosaic_ctx := MosaicContext {
+		mosaic = mosaic,
+		width  = u32(grid_cols * int(layout.tile_cols)),
+		height = u32(grid_rows * int(layout.tile_rows)),
+	}
+
+	multi := cvmmap.multi_create(instance_names, nil, is_dispatch_to_worker)
+	defer cvmmap.multi_destroy(multi)
+	if index, err := cvmmap.multi_init(multi); err != nil {
+		log.errorf("failed to initialize cv-mmap client %s: %v", instance_names[index], err)
+		assert(false, "failed to initialize cv-mmap clients")
+	}
+	// scaled right away, as the buffer is only valid during the callback
+	multi.on_frame = proc(index: int, metadata: cvmmap.FrameMetadata, buffer: []u8, user_data: rawptr) {
+		info := metadata.info
+		mat := aux.SharedMat {
+			raw_data(buffer),
+			info.height,
+			info.width,
+			aux.Depth(info.depth),
+			aux.PixelFormat(info.pixel_format),
+		}
+		if aux.mosaic_set_frame(cast(aux.Mosaic)user_data, c.size_t(index), mat) != .Ok {
+			log.errorf("[%d] %s", index, aux.last_error())
+		}
+	}
+	multi.user_data = rawptr(mosaic)
+	if index, err := cvmmap.multi_start(multi); err != nil {
+		log.errorf("failed to start cv-mmap client %s: %v", instance_names[index], err)
+		assert(false, "failed to start cv-mmap clients")
+	}
+	defer cvmmap.multi_stop(multi)
+
+	draw := proc(target_width: f32, user_data: rawptr) {
+		self := cast(^MosaicContext)user_data
+		image := aux.mosaic_image(self.mosaic)
+		if self.texture_index == 0 {
+			self.texture_index = gl_texture_from_bgr_buffer((cast([^]u8)image.data)[:int(image.step) * int(self.height)], self.width, self.height)
+		}
+		n_updated: c.size_t
+		if aux.mosaic_compose(self.mosaic, &n_updated) == .Ok && n_updated > 0 {
+			gl.BindTexture(gl.TEXTURE_2D, self.texture_index)
+			gl.TexSubImage2D(
+				gl.TEXTURE_2D,
+				0,
+				0,
+				0,
+				cast(i32)self.width,
+				cast(i32)self.height,
+				gl.BGR,
+				gl.UNSIGNED_BYTE,
+				image.data,
+			)
+		}
+		width, height := max_width_retain_ar(target_width, f32(self.width), f32(self.height))
+		im.Image(cast(im.TextureID)(uintptr(self.texture_index)), im.Vec2{width, height})
+	}
+	gui_run("Mosaic", draw, &mosaic_ctx)
+}
+
+// nil for an empty `path`
+open_recorder :: proc(path: string) -> ^record.Recorder {
+	if path == "" {
+		return nil
+	}
+	recorder, err := record.recorder_create(path)
+	assert(err == nil, fmt.tprintf("failed to record to %s: %v", path, err))
+	return recorder
+}
+
+// after everything appending to it is stopped
+close_recorder :: proc(recorder: ^record.Recorder) {
+	if recorder == nil {
+		return
+	}
+	stats := record.recorder_stats(recorder)
+	if err := record.recorder_close(recorder); err != nil {
+		log.errorf("failed to finish the recording: %v", err)
+	}
+	log.infof(
+		"recorded %d frames (%d torn) and %d pose messages (%.1f MiB), stalled %.1f ms",
+		stats.frames,
+		stats.torn,
+		stats.poses,
+		f64(stats.bytes) / (1 << 20),
+		f64(stats.stalled_ns) / 1e6,
+	)
+}
+
+// the `Receive` and `Dispatch` stages of the frame in `on_frame`
+record_delivery :: proc(timing: cvmmap.FrameTiming) {
+	if timing.published_ns != 0 {
+		aux.latency_record(.Receive, timing.received_ns - timing.published_ns)
+	}
+	aux.latency_record(.Dispatch, aux.now_ns() - timing.received_ns)
+}
+
+log_latency_report :: proc() {
+	report: aux.LatencyReport
+	aux.latency_report(&report)
+	for stage in aux.Stage {
+		l := report.stages[stage]
+		if l.count == 0 {
+			continue
+		}
+		log.infof(
+			"%v: n=%d p50 %.1f us p99 %.1f us max %.1f us",
+			stage,
+			l.count,
+			f64(l.p50_ns) / 1e3,
+			f64(l.p99_ns) / 1e3,
+			f64(l.max_ns) / 1e3,
+		)
+	}
+	log.infof("dropped: %d", report.dropped)
+}
+
+// what `cli_main` measures with `is_bench`, for frames of `cvmmap-synth`
+// (which start with their publish time)
+CliBench :: struct {
+	start:        time.Tick,
+	frames:       int,
+	// gaps in the frame index, i.e. dropped by CONFLATE or overwritten
+	dropped:      int,
+	last_index:   u32,
+	latencies_ns: [dynamic]i64,
+	client:       ^cvmmap.CvMmapClient,
+}
+
+cli_bench_report :: proc(bench: ^CliBench) {
+	elapsed := time.duration_seconds(time.tick_since(bench.start))
+	slice.sort(bench.latencies_ns[:])
+	percentile :: proc(sorted: []i64, q: f64) -> f64 {
+		if len(sorted) == 0 {
+			return 0
+		}
+		return f64(sorted[int(q * f64(len(sorted) - 1))]) / 1e3
+	}
+	l := bench.latencies_ns[:]
+	log.infof(
+		"bench: %d frames in %.2f s (%.1f fps), %d dropped (%.2f%%)",
+		bench.frames,
+		elapsed,
+		f64(bench.frames) / elapsed,
+		bench.dropped,
+		100 * f64(bench.dropped) / max(f64(bench.frames + bench.dropped), 1),
+	)
+	log.infof(
+		"bench: publish to on_frame us p50 %.1f p90 %.1f p99 %.1f max %.1f",
+		percentile(l, 0.5),
+		percentile(l, 0.9),
+		percentile(l, 0.99),
+		percentile(l, 1),
+	)
+}
+
+// with `stats_interval > 0`, the latency of every stage is logged that often;
+// with `record_path` (and not `is_bench`), frames are recorded instead of
+// logged
+cli_main :: proc(instance_name: string, is_bench: bool, stats_interval: time.Duration, record_path: string) {
 	lk := sync.Mutex{}
 	@(static) cv := sync.Cond{}
+	@(static) is_interrupted: bool
 	context.logger = log.create_console_logger(log.Level.Debug)
 
 	// for logging in the signal handler
@@ -391,6 +729,7 @@ cli_main :: proc(instance_name: string) {
 	posix.signal(posix.Signal.SIGINT, proc "c" (sig: posix.Signal) {
 		context = ctx^
 		log.infof("signal={}", sig)
+		intrinsics.atomic_store(&is_interrupted, true)
 		sync.cond_signal(&cv)
 	})
 	log.info("signal handler set")
@@ -402,9 +741,55 @@ cli_main :: proc(instance_name: string) {
 		log.info("destroyed")
 	}
 	on_frame := proc(metadata: cvmmap.FrameMetadata, buffer: []u8, user_data: rawptr) {
+		record_delivery((cast(^cvmmap.CvMmapClient)user_data).timing)
 		log.infof("[{}] FrameInfo={}; Len={}", metadata.frame_index, metadata.info, len(buffer))
 	}
 	client.on_frame = on_frame
+	client.user_data = client
+	CliRecording :: struct {
+		client:   ^cvmmap.CvMmapClient,
+		recorder: ^record.Recorder,
+	}
+	recording := CliRecording{client, nil}
+	if record_path != "" && !is_bench {
+		recording.recorder = open_recorder(record_path)
+		client.on_frame = proc(metadata: cvmmap.FrameMetadata, buffer: []u8, user_data: rawptr) {
+			recording := cast(^CliRecording)user_data
+			record_delivery(recording.client.timing)
+			record.append_frame(recording.recorder, metadata, buffer)
+		}
+		client.on_torn = proc(metadata: cvmmap.FrameMetadata, user_data: rawptr) {
+			record.retract_frame((cast(^CliRecording)user_data).recorder, metadata)
+		}
+		client.user_data = &recording
+	}
+	// once the client is stopped
+	defer close_recorder(recording.recorder)
+	bench := CliBench{}
+	if is_bench {
+		// allocated up front, so that the callback never allocates
+		bench.latencies_ns = make([dynamic]i64, 0, 1 << 20)
+		bench.client = client
+		client.on_frame = proc(metadata: cvmmap.FrameMetadata, buffer: []u8, user_data: rawptr) {
+			now := cvmmap.now_ns()
+			bench := cast(^CliBench)user_data
+			record_delivery(bench.client.timing)
+			if bench.frames == 0 {
+				bench.start = time.tick_now()
+			} else if metadata.frame_index > bench.last_index + 1 {
+				bench.dropped += int(metadata.frame_index - bench.last_index - 1)
+			}
+			bench.frames += 1
+			bench.last_index = metadata.frame_index
+			if len(buffer) >= size_of(u64) && len(bench.latencies_ns) < cap(bench.latencies_ns) {
+				published: u64
+				mem.copy(&published, raw_data(buffer), size_of(u64))
+				append(&bench.latencies_ns, i64(now - published))
+			}
+		}
+		client.user_data = &bench
+	}
+	defer delete(bench.latencies_ns)
 	err := cvmmap.init(client)
 	assert(err == nil, fmt.tprintf("failed to initialize cv-mmap client: %v", err))
 	log.info("initialized")
@@ -414,10 +799,22 @@ cli_main :: proc(instance_name: string) {
 	assert(err == nil, fmt.tprintf("failed to start cv-mmap client: %v", err))
 	defer {
 		cvmmap.stop(client)
-		log.info("stopped")
+		log.infof("stopped; %v", cvmmap.consistency_stats(client))
+		if is_bench {
+			cli_bench_report(&bench)
+		}
 	}
 
-	sync.cond_wait(&cv, &lk)
+	if stats_interval <= 0 {
+		sync.cond_wait(&cv, &lk)
+		return
+	}
+	aux.set_latency_enabled(true)
+	for !intrinsics.atomic_load(&is_interrupted) {
+		if !sync.cond_wait_with_timeout(&cv, &lk, stats_interval) {
+			log_latency_report()
+		}
+	}
 }
 
 
@@ -425,16 +822,34 @@ cli_main :: proc(instance_name: string) {
 // https://pkg.odin-lang.org/core/flags/
 main :: proc() {
 	Options :: struct {
-		cli:           bool `usage:"run in cli mode"`,
-		instance_name: string `usage:"instance name"`,
+		cli:            bool `usage:"run in cli mode"`,
+		instance_name:  string `usage:"instance name"`,
+		draw_threads:   int `usage:"threads used to draw the overlay or the mosaic (<= 1 draws on a single thread)"`,
+		bench:          bool `usage:"with -cli, report latency, drops and fps of frames from cvmmap-synth"`,
+		stats_interval: f64 `usage:"with -cli, log the latency of every stage every this many seconds"`,
+		worker:         bool `usage:"run the socket callbacks on a worker thread instead of the reactor thread"`,
+		instances:      string `usage:"comma separated instance names, shown together as a mosaic"`,
+		tile_width:     int `usage:"with -instances, the width of a camera in the mosaic (default 480)"`,
+		preview_width:  int `usage:"scale wider frames down to this before drawing (default 640); 0 keeps the full resolution"`,
+		record:         string `usage:"append the frames and pose messages received to this file, see tools/cvmmap-replay (not with -instances)"`,
 	}
 	parse_style: flags.Parsing_Style = .Odin
-	opts := Options{}
+	opts := Options {
+		tile_width    = 480,
+		preview_width = 640,
+	}
 	flags.parse_or_exit(&opts, os.args, parse_style)
+	if opts.draw_threads > 1 {
+		aux.set_num_threads(c.int(opts.draw_threads))
+	}
 	// https://github.com/odin-lang/Odin/blob/16eca1ded12373cd5a106d20796458a374940771/examples/demo/demo.odin#L1397
 	if opts.cli {
-		cli_main(opts.instance_name)
+		cli_main(opts.instance_name, opts.bench, time.Duration(opts.stats_interval * f64(time.Second)), opts.record)
+	} else if opts.instances != "" {
+		instance_names := strings.split(opts.instances, ",")
+		defer delete(instance_names)
+		mosaic_main(instance_names, opts.tile_width, opts.worker)
 	} else {
-		gui_main(opts.instance_name)
+		gui_main(opts.instance_name, opts.worker, opts.preview_width, opts.record)
 	}
 }
@@ -0,0 +1,280 @@
+package main
+import "../../components/cvmmap"
+import "../../components/record"
+import aux "../../lib/aux-img"
+import aux_info "../../lib/aux-img/info"
+import zmq "../../lib/odin-zeromq"
+import "base:intrinsics"
+import "core:c"
+import "core:flags"
+import "core:log"
+import "core:mem"
+import "core:os"
+import "core:strings"
+import "core:sys/posix"
+import "core:thread"
+import "core:time"
+
+// plays a recording of `main -record` back
+//
+//   cvmmap-replay -recording:<path> -instance_name:<name> [-speed:1]
+//                 [-slots:0] [-stamp] [-render:0]
+//
+// frames are published through the cv-mmap protocol, as `cvmmap-synth`
+// does, and pose messages are sent on the aux socket as they were received,
+// at the recorded pace (`-speed` times faster; 0 as fast as possible), so
+// that a client sees the same stream again. With `-stamp`, the first 8 bytes
+// of every frame are its publish time, for `main -cli -bench`.
+//
+// `-render:<threads>` publishes nothing: every frame is composited with the
+// pose message received last before it, as the viewer would, on that many
+// threads at once, i.e. the overlay throughput without the camera's pace.
+
+// same as `BIN_ZEROMQ_ADDR` of the viewer, which binds it
+POSE_ZEROMQ_ADDR :: "ipc:///tmp/tmp_bin"
+
+@(private)
+g_is_running: bool = true
+
+@(private)
+_replay :: proc(reader: ^record.Reader, instance_name: string, speed: f64, n_slots: int, is_stamp: bool) -> bool {
+	// the producer starts with the geometry of the first frame
+	first_frame := -1
+	for entry, i in reader.index {
+		if entry.kind == .Frame && !record.reader_is_torn(reader, i) {
+			first_frame = i
+			break
+		}
+	}
+	if first_frame == -1 {
+		log.error("no frames to replay")
+		return false
+	}
+	info := record.reader_record(reader, first_frame).metadata.info
+	zmq_ctx := zmq.ctx_new()
+	defer zmq.ctx_term(zmq_ctx)
+	producer, err := cvmmap.producer_create(instance_name, info, n_slots, zmq_ctx)
+	if err != nil {
+		log.errorf("failed to create producer: %v", err)
+		return false
+	}
+	defer cvmmap.producer_destroy(producer)
+	pose_sock := zmq.socket(zmq_ctx, zmq.PUB)
+	defer zmq.close(pose_sock)
+	addr_c := strings.clone_to_cstring(POSE_ZEROMQ_ADDR)
+	defer delete(addr_c)
+	if code := zmq.connect(pose_sock, addr_c); code != 0 {
+		log.errorf("failed to connect to %s: %d", POSE_ZEROMQ_ADDR, code)
+		return false
+	}
+	// whatever is published before a subscriber is connected is dropped
+	time.sleep(200 * time.Millisecond)
+
+	n_frames, n_poses, n_bytes := 0, 0, 0
+	first_ns := reader.index[0].received_ns
+	start := time.tick_now()
+	for i in 0 ..< len(reader.index) {
+		if !intrinsics.atomic_load(&g_is_running) {
+			break
+		}
+		// a torn frame is left out, as the client discarded it
+		if record.reader_is_torn(reader, i) {
+			continue
+		}
+		rec := record.reader_record(reader, i)
+		if speed > 0 {
+			due := time.Duration(f64(rec.received_ns - first_ns) / speed)
+			if wait := due - time.tick_since(start); wait > 0 {
+				time.accurate_sleep(wait)
+			}
+		}
+		switch rec.kind {
+		case .Frame:
+			if rec.metadata.info != info {
+				info = rec.metadata.info
+				if err := cvmmap.producer_resize(producer, info); err != nil {
+					log.errorf("failed to resize to %dx%d: %v", info.width, info.height, err)
+					return false
+				}
+			}
+			image := cvmmap.begin_frame(producer, rec.metadata.frame_index)
+			copy(image, rec.payload)
+			if is_stamp && len(image) >= size_of(u64) {
+				ts := cvmmap.now_ns()
+				mem.copy(raw_data(image), &ts, size_of(u64))
+			}
+			if err := cvmmap.publish_frame(producer); err != nil {
+				log.errorf("failed to publish frame %d: %v", rec.metadata.frame_index, err)
+			}
+			n_frames += 1
+		case .Pose:
+			zmq.send(pose_sock, raw_data(rec.payload), c.size_t(len(rec.payload)), 0)
+			n_poses += 1
+		case .Torn, .None:
+		}
+		n_bytes += len(rec.payload)
+	}
+	elapsed := time.duration_seconds(time.tick_since(start))
+	log.infof(
+		"replayed %d frames and %d pose messages in %.2f s: %.1f fps, %.1f MiB/s",
+		n_frames,
+		n_poses,
+		elapsed,
+		f64(n_frames) / elapsed,
+		f64(n_bytes) / (1 << 20) / elapsed,
+	)
+	return true
+}
+
+@(private)
+RenderJob :: struct {
+	frame: int,
+	// the pose message received last before the frame; -1 if none
+	pose:  int,
+}
+
+@(private)
+Render :: struct {
+	reader: ^record.Reader,
+	jobs:   []RenderJob,
+	// atomic
+	next:   int,
+	frames: int,
+}
+
+// frames taken one at a time, each into a buffer of the thread's own
+@(private)
+_render_task :: proc(t: ^thread.Thread) {
+	render := cast(^Render)t.data
+	opts := aux_info.DrawPoseOptions {
+		landmark_radius        = 5,
+		landmark_thickness     = -1,
+		bone_thickness         = 2,
+		bounding_box_thickness = 5,
+		bounding_box_color     = {0, 250, 0},
+		face_min_height        = 64,
+		hand_min_height        = 96,
+		is_cull                = true,
+	}
+	buffer: [dynamic]u8
+	defer delete(buffer)
+	for {
+		k := intrinsics.atomic_add(&render.next, 1)
+		if k >= len(render.jobs) {
+			return
+		}
+		job := render.jobs[k]
+		frame := record.reader_record(render.reader, job.frame)
+		info := frame.metadata.info
+		if len(frame.payload) < int(info.buffer_size) {
+			continue
+		}
+		step := aux.composite_step(info.width, .BGR, true)
+		resize(&buffer, int(step) * int(info.height))
+		mat := aux.SharedMat {
+			raw_data(frame.payload),
+			info.height,
+			info.width,
+			aux.Depth(info.depth),
+			aux.PixelFormat(info.pixel_format),
+		}
+		dst := aux.CompositeTarget{raw_data(buffer), step, .BGR}
+		poses: ^aux_info.PoseInfo = nil
+		pose_info: aux_info.PoseInfo
+		if job.pose != -1 {
+			ok: bool
+			pose_info, ok = aux_info.unmarshal(record.reader_record(render.reader, job.pose).payload)
+			if ok {
+				poses = &pose_info
+			}
+		}
+		aux_info.composite(mat, dst, poses, opts)
+		aux_info.destroy(&pose_info)
+		intrinsics.atomic_add(&render.frames, 1)
+	}
+}
+
+@(private)
+_render :: proc(reader: ^record.Reader, n_threads: int) {
+	jobs := make([dynamic]RenderJob, 0, record.reader_frame_count(reader))
+	defer delete(jobs)
+	pose := -1
+	for entry, i in reader.index {
+		switch entry.kind {
+		case .Pose:
+			pose = i
+		case .Frame:
+			if !record.reader_is_torn(reader, i) {
+				append(&jobs, RenderJob{i, pose})
+			}
+		case .Torn, .None:
+		}
+	}
+	render := Render {
+		reader = reader,
+		jobs   = jobs[:],
+	}
+	threads := make([]^thread.Thread, n_threads)
+	defer delete(threads)
+	start := time.tick_now()
+	for &t in threads {
+		t = thread.create(_render_task)
+		t.data = &render
+		t.init_context = context
+		thread.start(t)
+	}
+	for t in threads {
+		thread.join(t)
+		thread.destroy(t)
+	}
+	elapsed := time.duration_seconds(time.tick_since(start))
+	log.infof(
+		"rendered %d frames on %d threads in %.2f s: %.1f fps",
+		render.frames,
+		n_threads,
+		elapsed,
+		f64(render.frames) / elapsed,
+	)
+}
+
+main :: proc() {
+	Options :: struct {
+		recording:     string `usage:"a file written by main -record"`,
+		instance_name: string `usage:"instance name to publish as, i.e. cvmmap_<name>"`,
+		speed:         f64 `usage:"times the recorded pace (default 1); 0 publishes as fast as possible"`,
+		slots:         int `usage:"ring slots; 0 for the single image layout"`,
+		stamp:         bool `usage:"overwrite the first 8 bytes of every frame with its publish time"`,
+		render:        int `usage:"composite the poses over every frame on this many threads instead of publishing"`,
+	}
+	opts := Options {
+		speed = 1,
+	}
+	flags.parse_or_exit(&opts, os.args, .Odin)
+	context.logger = log.create_console_logger(log.Level.Info)
+	if opts.recording == "" {
+		log.error("-recording is required")
+		os.exit(2)
+	}
+	if opts.render <= 0 && opts.instance_name == "" {
+		log.error("-instance_name is required")
+		os.exit(2)
+	}
+	reader, err := record.reader_open(opts.recording)
+	if err != nil {
+		log.errorf("failed to open %s: %v", opts.recording, err)
+		os.exit(1)
+	}
+	defer record.reader_close(reader)
+	log.infof("%s: %d records, %d frames", opts.recording, len(reader.index), record.reader_frame_count(reader))
+
+	if opts.render > 0 {
+		_render(reader, opts.render)
+		return
+	}
+	posix.signal(posix.Signal.SIGINT, proc "c" (sig: posix.Signal) {
+		intrinsics.atomic_store(&g_is_running, false)
+	})
+	if !_replay(reader, opts.instance_name, opts.speed, opts.slots, opts.stamp) {
+		os.exit(1)
+	}
+}
@@ -0,0 +1,317 @@
+package main
+import "../../components/cvmmap"
+import aux "../../lib/aux-img"
+import zmq "../../lib/odin-zeromq"
+import "base:intrinsics"
+import "core:c"
+import "core:encoding/endian"
+import "core:flags"
+import "core:log"
+import "core:math"
+import "core:mem"
+import "core:os"
+import "core:strings"
+import "core:sys/posix"
+import "core:time"
+
+// a synthetic cv-mmap producer, standing in for the camera
+//
+//   cvmmap-synth -instance_name:<name> [-width:1920] [-height:1080]
+//                [-pixel_format:BGR] [-depth:U8] [-fps:30] [-slots:0]
+//                [-duration:0] [-poses] [-people:4] [-pose_version:2]
+//                [-resize_every:0]
+//
+// frames are filled with a level changing with the frame index, and start
+// with `cvmmap.now_ns()` (u64) so that a client can tell how long the
+// frame took to reach it, see `cli_main -bench` of the viewer. With
+// `-poses`, a pose message is published for every frame on the aux socket,
+// in the format of `info.unmarshal` (v2 as encoded by aux-img, unless
+// `-pose_version:1`). With
+// `-resize_every`, frames start at half the resolution and switch between it
+// and the full one every that many frames, so that a client has to map the
+// grown segment again once.
+
+// same as `BIN_ZEROMQ_ADDR` of the viewer, which binds it
+POSE_ZEROMQ_ADDR :: "ipc:///tmp/tmp_bin"
+NUM_KEYPOINTS :: 133
+
+@(private)
+g_is_running: bool = true
+
+// bytes per pixel of every plane together, times 2 (for the 4:2:0 formats)
+@(private)
+_bytes_per_pixel_x2 :: proc(pixel_format: cvmmap.PixelFormat) -> int {
+	switch pixel_format {
+	case .RGB, .BGR, .YUV:
+		return 6
+	case .RGBA, .BGRA:
+		return 8
+	case .GRAY:
+		return 2
+	case .YUYV:
+		return 4
+	case .NV12, .I420:
+		return 3
+	}
+	return 0
+}
+
+@(private)
+_channels :: proc(pixel_format: cvmmap.PixelFormat) -> u8 {
+	switch pixel_format {
+	case .RGB, .BGR, .YUV:
+		return 3
+	case .RGBA, .BGRA:
+		return 4
+	case .YUYV:
+		return 2
+	case .GRAY, .NV12, .I420:
+		return 1
+	}
+	return 0
+}
+
+@(private)
+_depth_size :: proc(depth: cvmmap.Depth) -> int {
+	switch depth {
+	case .U8, .S8:
+		return 1
+	case .U16, .S16, .F16:
+		return 2
+	case .S32, .F32:
+		return 4
+	case .F64:
+		return 8
+	}
+	return 0
+}
+
+// people on a grid, slowly moving with the frame index, as row major
+// skeletons, confidences and boxes; allocated once
+@(private)
+SynthPoses :: struct {
+	keypoints:   []f32,
+	confidences: []f32,
+	boxes:       []u16,
+	// the message, either version
+	message:     []u8,
+}
+
+@(private)
+_synth_poses_make :: proc(n_people: int, version: int) -> (poses: SynthPoses) {
+	poses.keypoints = make([]f32, n_people * NUM_KEYPOINTS * 2)
+	poses.confidences = make([]f32, n_people * NUM_KEYPOINTS)
+	poses.boxes = make([]u16, n_people * 4)
+	size := 4 + 1 + 1 + n_people * (NUM_KEYPOINTS * 2 * size_of(f32) + 4 * size_of(u16))
+	if version != 1 {
+		size = int(aux.pose_encoded_size(c.size_t(n_people), c.size_t(n_people)))
+	}
+	poses.message = make([]u8, size)
+	return
+}
+
+@(private)
+_synth_poses_destroy :: proc(poses: ^SynthPoses) {
+	delete(poses.keypoints)
+	delete(poses.confidences)
+	delete(poses.boxes)
+	delete(poses.message)
+}
+
+@(private)
+_synth_poses_update :: proc(poses: ^SynthPoses, frame_index: u32, width: f32, height: f32) {
+	n_people := len(poses.boxes) / 4
+	grid := int(math.ceil(math.sqrt(f32(n_people))))
+	box_w := width / f32(grid)
+	box_h := height / f32(grid)
+	phase := f32(frame_index % 120) / 120 * 2 * math.PI
+	for p in 0 ..< n_people {
+		x0 := f32(p % grid) * box_w
+		y0 := f32(p / grid) * box_h
+		skeleton := poses.keypoints[p * NUM_KEYPOINTS * 2:][:NUM_KEYPOINTS * 2]
+		for k in 0 ..< NUM_KEYPOINTS {
+			angle := f32(k) * 0.7 + phase
+			skeleton[k * 2] = x0 + box_w * (0.5 + 0.35 * math.cos(angle))
+			skeleton[k * 2 + 1] = y0 + box_h * (0.5 + 0.35 * math.sin(angle))
+			// waving along the skeleton
+			poses.confidences[p * NUM_KEYPOINTS + k] = 0.5 + 0.5 * math.sin(f32(k + p) * 0.3 + phase)
+		}
+		box := poses.boxes[p * 4:][:4]
+		box[0] = u16(x0)
+		box[1] = u16(y0)
+		box[2] = u16(min(x0 + box_w, width - 1))
+		box[3] = u16(min(y0 + box_h, height - 1))
+	}
+}
+
+// the v1 message of `poses`, which carries no confidences; v2 is encoded by
+// the library, see `aux.pose_encode`
+@(private)
+_write_pose_v1 :: proc(poses: ^SynthPoses, frame_index: u32) -> []u8 {
+	n_people := len(poses.boxes) / 4
+	buffer := poses.message
+	endian.put_u32(buffer[:4], .Little, frame_index)
+	buffer[4] = u8(n_people)
+	buffer[5] = u8(n_people)
+	rest := buffer[6:]
+	for v, i in poses.keypoints {
+		endian.put_f32(rest[i * 4:][:4], .Little, v)
+	}
+	rest = rest[len(poses.keypoints) * size_of(f32):]
+	for v, i in poses.boxes {
+		endian.put_u16(rest[i * 2:][:2], .Little, v)
+	}
+	return buffer
+}
+
+// `poses` for `frame_index`, in the wire format of `info.unmarshal`
+@(private)
+_write_pose_message :: proc(poses: ^SynthPoses, frame_index: u32, width: f32, height: f32, version: int) -> []u8 {
+	_synth_poses_update(poses, frame_index, width, height)
+	if version == 1 {
+		return _write_pose_v1(poses, frame_index)
+	}
+	n_people := c.size_t(len(poses.boxes) / 4)
+	size: c.size_t
+	status := aux.pose_encode(
+		frame_index,
+		raw_data(poses.keypoints),
+		raw_data(poses.confidences),
+		n_people,
+		raw_data(poses.boxes),
+		n_people,
+		raw_data(poses.message),
+		c.size_t(len(poses.message)),
+		&size,
+	)
+	assert(status == .Ok, "pose message too small")
+	return poses.message[:size]
+}
+
+main :: proc() {
+	Options :: struct {
+		instance_name: string `usage:"instance name, i.e. cvmmap_<name>"`,
+		width:         int `usage:"frame width (default 1920)"`,
+		height:        int `usage:"frame height (default 1080)"`,
+		pixel_format:  cvmmap.PixelFormat `usage:"pixel format (default BGR)"`,
+		depth:         cvmmap.Depth `usage:"depth (default U8)"`,
+		fps:           f64 `usage:"frames per second (default 30); 0 publishes as fast as possible"`,
+		slots:         int `usage:"ring slots; 0 for the single image layout"`,
+		duration:      f64 `usage:"seconds to run; 0 runs until SIGINT"`,
+		poses:         bool `usage:"publish pose messages on the aux socket"`,
+		people:        int `usage:"people per pose message (default 4)"`,
+		pose_version:  int `usage:"pose wire format, 1 or 2 (default 2)"`,
+		resize_every:  int `usage:"switch between half and full resolution every this many frames; 0 never does"`,
+	}
+	opts := Options {
+		width        = 1920,
+		height       = 1080,
+		pixel_format = .BGR,
+		depth        = .U8,
+		fps          = 30,
+		people       = 4,
+		pose_version = 2,
+	}
+	flags.parse_or_exit(&opts, os.args, .Odin)
+	context.logger = log.create_console_logger(log.Level.Info)
+	if opts.instance_name == "" {
+		log.error("-instance_name is required")
+		os.exit(2)
+	}
+	if opts.pose_version != 1 && opts.pose_version != 2 {
+		log.error("-pose_version is 1 or 2")
+		os.exit(2)
+	}
+	// the counts are u8 in v1, u16 in v2
+	if max_people := 255 if opts.pose_version == 1 else 65535; opts.people > max_people {
+		log.errorf("-people is at most %d for -pose_version:%d", max_people, opts.pose_version)
+		os.exit(2)
+	}
+
+	posix.signal(posix.Signal.SIGINT, proc "c" (sig: posix.Signal) {
+		intrinsics.atomic_store(&g_is_running, false)
+	})
+
+	frame_info :: proc(width: int, height: int, pixel_format: cvmmap.PixelFormat, depth: cvmmap.Depth) -> cvmmap.FrameInfo {
+		buffer_size := width * height * _bytes_per_pixel_x2(pixel_format) / 2 * _depth_size(depth)
+		return cvmmap.FrameInfo {
+			width        = u16(width),
+			height       = u16(height),
+			channels     = _channels(pixel_format),
+			depth        = depth,
+			buffer_size  = u32(buffer_size),
+			pixel_format = pixel_format,
+		}
+	}
+	full_info := frame_info(opts.width, opts.height, opts.pixel_format, opts.depth)
+	// even, for the 4:2:0 formats
+	half_info := frame_info(opts.width / 4 * 2, opts.height / 4 * 2, opts.pixel_format, opts.depth)
+	info := half_info if opts.resize_every > 0 else full_info
+	zmq_ctx := zmq.ctx_new()
+	defer zmq.ctx_term(zmq_ctx)
+	producer, err := cvmmap.producer_create(opts.instance_name, info, opts.slots, zmq_ctx)
+	if err != nil {
+		log.errorf("failed to create producer: %v", err)
+		os.exit(1)
+	}
+	defer cvmmap.producer_destroy(producer)
+
+	pose_sock: ^zmq.Socket = nil
+	poses: SynthPoses
+	if opts.poses {
+		pose_sock = zmq.socket(zmq_ctx, zmq.PUB)
+		addr_c := strings.clone_to_cstring(POSE_ZEROMQ_ADDR)
+		defer delete(addr_c)
+		if code := zmq.connect(pose_sock, addr_c); code != 0 {
+			log.errorf("failed to connect to %s: %d", POSE_ZEROMQ_ADDR, code)
+			os.exit(1)
+		}
+		poses = _synth_poses_make(opts.people, opts.pose_version)
+	}
+	defer if pose_sock != nil {
+		zmq.close(pose_sock)
+		_synth_poses_destroy(&poses)
+	}
+	log.infof("publishing cvmmap_%s: %v, %d slots, %.1f fps", opts.instance_name, info, opts.slots, opts.fps)
+
+	period := time.Duration(f64(time.Second) / opts.fps) if opts.fps > 0 else 0
+	start := time.tick_now()
+	next := start
+	frame_index: u32 = 0
+	for intrinsics.atomic_load(&g_is_running) {
+		if opts.duration > 0 && time.duration_seconds(time.tick_since(start)) >= opts.duration {
+			break
+		}
+		frame_index += 1
+		if opts.resize_every > 0 && frame_index % u32(opts.resize_every) == 0 {
+			info = full_info if info == half_info else half_info
+			if err := cvmmap.producer_resize(producer, info); err != nil {
+				log.errorf("failed to resize to %dx%d: %v", info.width, info.height, err)
+				break
+			}
+			log.infof("[%d] %dx%d", frame_index, info.width, info.height)
+		}
+		image := cvmmap.begin_frame(producer, frame_index)
+		// a level changing with every frame, then the timestamp
+		mem.set(raw_data(image), u8(frame_index), len(image))
+		if len(image) >= size_of(u64) {
+			ts := cvmmap.now_ns()
+			mem.copy(raw_data(image), &ts, size_of(u64))
+		}
+		if err := cvmmap.publish_frame(producer); err != nil {
+			log.errorf("failed to publish frame %d: %v", frame_index, err)
+		}
+		if pose_sock != nil {
+			msg := _write_pose_message(&poses, frame_index, f32(opts.width), f32(opts.height), opts.pose_version)
+			zmq.send(pose_sock, raw_data(msg), c.size_t(len(msg)), 0)
+		}
+		if period > 0 {
+			next = time.tick_add(next, period)
+			if wait := time.tick_diff(time.tick_now(), next); wait > 0 {
+				time.accurate_sleep(wait)
+			}
+		}
+	}
+	elapsed := time.duration_seconds(time.tick_since(start))
+	log.infof("published %d frames in %.2f s (%.1f fps)", frame_index, elapsed, f64(frame_index) / elapsed)
+}